@@ -0,0 +1,115 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_BENCH_H_
+#define TINCAN_BENCH_H_
+#include "tincan_base.h"
+#include <malloc.h>
+namespace tincan
+{
+/*
+A minimal microbenchmark harness for tincan's hot paths. A benchmark function
+runs its operation state.iterations times and may report the bytes processed
+per iteration. The runner raises the iteration count until a run lasts long
+enough to be timed reliably and reports the time per iteration. Benchmarks
+registered with a list of arguments are run once for each, the argument is in
+state.arg. Setup that should not be timed is done before calling
+state.StartTiming(). A benchmark of a data structure may report the memory it
+holds in state.memory_bytes.
+*/
+struct BenchState
+{
+  BenchState() :
+    iterations(0),
+    arg(0),
+    bytes_per_iteration(0),
+    memory_bytes(0)
+  {}
+  //Restarts the clock, excluding the work done so far from the measurement
+  void StartTiming()
+  {
+    start = steady_clock::now();
+  }
+  uint64_t iterations;
+  uint64_t arg;
+  uint64_t bytes_per_iteration;
+  uint64_t memory_bytes;
+  steady_clock::time_point start;
+};
+
+using BenchFunction = void (*)(BenchState & state);
+
+struct BenchDescriptor
+{
+  string name;
+  BenchFunction fn;
+  vector<uint64_t> args;
+};
+
+vector<BenchDescriptor> & BenchRegistry();
+
+struct BenchRegistration
+{
+  BenchRegistration(
+    const char * name,
+    BenchFunction fn,
+    vector<uint64_t> args = {})
+  {
+    BenchRegistry().push_back({ name, fn, move(args) });
+  }
+};
+
+#define TINCAN_BENCHMARK(fn) \
+  static BenchRegistration fn##_registration(#fn, fn)
+#define TINCAN_BENCHMARK_ARGS(fn, ...) \
+  static BenchRegistration fn##_registration(#fn, fn, { __VA_ARGS__ })
+
+//Keeps the compiler from discarding a result that is otherwise unused
+template<typename T>
+inline void
+DoNotOptimize(
+  const T & value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+//Bytes in use on the heap, the difference across building a structure is the
+//memory it holds including the allocator's overhead
+inline uint64_t
+HeapInUse()
+{
+#if __GLIBC_PREREQ(2, 33)
+  struct mallinfo2 mi = mallinfo2();
+#else
+  struct mallinfo mi = mallinfo();
+#endif
+  return (uint64_t)mi.uordblks + (uint64_t)mi.hblkhd;
+}
+
+//Forces pending writes to memory to be treated as observed
+inline void
+ClobberMemory()
+{
+  asm volatile("" : : : "memory");
+}
+} // namespace tincan
+#endif // TINCAN_BENCH_H_
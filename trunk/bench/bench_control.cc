@@ -0,0 +1,153 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "bench.h"
+#include "tincan_control.h"
+/*
+The control channel's costs for a typical CreateLink request with a full
+candidate address set: parsing and serializing it in the JSON and in the
+binary encoding, and the styled form that is logged for every control.
+*/
+namespace tincan
+{
+static unique_ptr<Json::Value>
+CreateLinkRequest()
+{
+  unique_ptr<Json::Value> req = make_unique<Json::Value>(Json::objectValue);
+  Json::Value & r = *req;
+  r[TincanControl::Command] = "CreateLink";
+  r[TincanControl::TunnelId] = "1f0d4c7e2b9a48a6b3c5d7e9f1a2b3c4";
+  r[TincanControl::LinkId] = "8a7b6c5d4e3f40a1b2c3d4e5f6a7b8c9";
+  r[TincanControl::EncryptionEnabled] = true;
+  Json::Value & peer = r[TincanControl::PeerInfo];
+  peer[TincanControl::UID] = "a1b2c3d4e5f60718293a4b5c6d7e8f90";
+  peer[TincanControl::VIP4] = "10.254.0.12";
+  peer[TincanControl::MAC] = "02:1A:2B:3C:4D:5E";
+  peer[TincanControl::FPR] = "sha-256 4F:2A:91:0C:7D:E3:58:B6:11:AF:36:C9:"
+    "02:8E:D4:67:F0:1B:A5:3C:98:44:7E:D1:0A:6B:C2:59:E8:13:7F:A0";
+  string cas;
+  for(int i = 0; i < 8; i++)
+  {
+    cas.append("candidate:").append(std::to_string(1000 + i))
+      .append(" 1 udp 2122260223 192.168.1.").append(std::to_string(20 + i))
+      .append(" ").append(std::to_string(50000 + i))
+      .append(" typ host generation 0 ufrag 5Ba9 network-id 1 ");
+  }
+  peer[TincanControl::CAS] = cas;
+  r["StunServers"].append("stun.l.google.com:19302");
+  r["StunServers"].append("stun1.l.google.com:19302");
+  Json::Value turn(Json::objectValue);
+  turn["Address"] = "turn.example.org:3478";
+  turn["User"] = "ipop";
+  turn["Password"] = "secret";
+  r["TurnServers"].append(turn);
+  return req;
+}
+
+static string
+SerializedRequest(
+  uint32_t version)
+{
+  TincanControl ctrl(CreateLinkRequest());
+  ctrl.SetProtocolVersion(version);
+  string msg;
+  ctrl.Serialize(msg);
+  return msg;
+}
+
+static void
+ControlParseJson(
+  BenchState & state)
+{
+  string msg = SerializedRequest(TincanParameters::kTincanControlVer);
+  state.bytes_per_iteration = msg.length();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    TincanControl ctrl(msg.c_str(), msg.length());
+    DoNotOptimize(ctrl);
+  }
+}
+TINCAN_BENCHMARK(ControlParseJson);
+
+static void
+ControlParseBinary(
+  BenchState & state)
+{
+  string msg = SerializedRequest(TincanParameters::kTincanControlBinaryVer);
+  state.bytes_per_iteration = msg.length();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    TincanControl ctrl(msg.c_str(), msg.length());
+    DoNotOptimize(ctrl);
+  }
+}
+TINCAN_BENCHMARK(ControlParseBinary);
+
+static void
+ControlSerializeJson(
+  BenchState & state)
+{
+  TincanControl ctrl(CreateLinkRequest());
+  string msg;
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    ctrl.Serialize(msg);
+    DoNotOptimize(msg);
+  }
+  state.bytes_per_iteration = msg.length();
+}
+TINCAN_BENCHMARK(ControlSerializeJson);
+
+static void
+ControlSerializeBinary(
+  BenchState & state)
+{
+  TincanControl ctrl(CreateLinkRequest());
+  ctrl.SetProtocolVersion(TincanParameters::kTincanControlBinaryVer);
+  string msg;
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    ctrl.Serialize(msg);
+    DoNotOptimize(msg);
+  }
+  state.bytes_per_iteration = msg.length();
+}
+TINCAN_BENCHMARK(ControlSerializeBinary);
+
+static void
+ControlStyledString(
+  BenchState & state)
+{
+  TincanControl ctrl(CreateLinkRequest());
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    string styled = ctrl.StyledString();
+    DoNotOptimize(styled);
+  }
+}
+TINCAN_BENCHMARK(ControlStyledString);
+} // namespace tincan
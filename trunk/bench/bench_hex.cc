@@ -0,0 +1,163 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "bench.h"
+#include <random>
+/*
+The hex codecs on a full size ethernet frame, as hex encoded for route
+requests and decoded for injected frames, and on MAC addresses. The stream
+based implementations they replaced are kept here as the baseline.
+*/
+namespace tincan
+{
+static const uint32_t kFrameSize = 1514;
+
+static vector<uint8_t>
+RandomFrame()
+{
+  std::mt19937 rng(kFrameSize);
+  vector<uint8_t> frame(kFrameSize);
+  for(auto & b : frame)
+    b = (uint8_t)rng();
+  return frame;
+}
+
+static string
+StreamEncode(
+  const uint8_t * first,
+  const uint8_t * last)
+{
+  ostringstream oss;
+  oss << std::hex << std::setfill('0') << std::uppercase;
+  while(first != last)
+    oss << std::setw(2) << static_cast<int>(*first++);
+  return oss.str();
+}
+
+static size_t
+StreamDecode(
+  const string & src,
+  uint8_t * first,
+  uint8_t * last)
+{
+  size_t count = 0;
+  istringstream iss(src);
+  char val[3];
+  while(first != last && iss.peek() != istringstream::traits_type::eof())
+  {
+    size_t nb = 0;
+    iss.get(val, 3);
+    (*first++) = (uint8_t)std::stoi(val, &nb, 16);
+    count++;
+  }
+  return count;
+}
+
+static void
+HexEncodeFrame(
+  BenchState & state)
+{
+  vector<uint8_t> frame = RandomFrame();
+  state.bytes_per_iteration = frame.size();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    string hex = ByteArrayToString(frame.data(), frame.data() + frame.size());
+    DoNotOptimize(hex);
+  }
+}
+TINCAN_BENCHMARK(HexEncodeFrame);
+
+static void
+HexEncodeFrameStream(
+  BenchState & state)
+{
+  vector<uint8_t> frame = RandomFrame();
+  state.bytes_per_iteration = frame.size();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    string hex = StreamEncode(frame.data(), frame.data() + frame.size());
+    DoNotOptimize(hex);
+  }
+}
+TINCAN_BENCHMARK(HexEncodeFrameStream);
+
+static void
+HexDecodeFrame(
+  BenchState & state)
+{
+  vector<uint8_t> frame = RandomFrame();
+  string hex = ByteArrayToString(frame.data(), frame.data() + frame.size());
+  state.bytes_per_iteration = frame.size();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    size_t len = StringToByteArray(hex, frame.data(),
+      frame.data() + frame.size());
+    DoNotOptimize(len);
+    ClobberMemory();
+  }
+}
+TINCAN_BENCHMARK(HexDecodeFrame);
+
+static void
+HexDecodeFrameStream(
+  BenchState & state)
+{
+  vector<uint8_t> frame = RandomFrame();
+  string hex = ByteArrayToString(frame.data(), frame.data() + frame.size());
+  state.bytes_per_iteration = frame.size();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    size_t len = StreamDecode(hex, frame.data(), frame.data() + frame.size());
+    DoNotOptimize(len);
+    ClobberMemory();
+  }
+}
+TINCAN_BENCHMARK(HexDecodeFrameStream);
+
+static void
+HexDecodeMac(
+  BenchState & state)
+{
+  const string mac_str("0A1B2C3D4E5F");
+  MacAddressType mac;
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    size_t len = StringToByteArray(mac_str, mac.begin(), mac.end());
+    DoNotOptimize(len);
+    ClobberMemory();
+  }
+}
+TINCAN_BENCHMARK(HexDecodeMac);
+
+static void
+HexEncodeMac(
+  BenchState & state)
+{
+  MacAddressType mac = { 0x0A, 0x1B, 0x2C, 0x3D, 0x4E, 0x5F };
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    string mac_str = ByteArrayToString(mac.begin(), mac.end());
+    DoNotOptimize(mac_str);
+  }
+}
+TINCAN_BENCHMARK(HexEncodeMac);
+} // namespace tincan
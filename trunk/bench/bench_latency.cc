@@ -0,0 +1,69 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "bench.h"
+#include "latency_stats.h"
+/*
+The cost added to each frame when latency stats are enabled: reading the clock
+and recording the time between stages in a histogram.
+*/
+namespace tincan
+{
+static void
+LatencyClockRead(
+  BenchState & state)
+{
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+    DoNotOptimize(LatencyClock());
+}
+TINCAN_BENCHMARK(LatencyClockRead);
+
+static void
+LatencyHistogramRecord(
+  BenchState & state)
+{
+  unique_ptr<LatencyHistogram> hist = make_unique<LatencyHistogram>();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+    hist->Record((i * 2654435761u) & 0xFFFFF);
+  ClobberMemory();
+}
+TINCAN_BENCHMARK(LatencyHistogramRecord);
+
+static void
+LatencyHistogramQuery(
+  BenchState & state)
+{
+  unique_ptr<LatencyHistogram> hist = make_unique<LatencyHistogram>();
+  for(uint64_t i = 0; i < 100000; i++)
+    hist->Record((i * 2654435761u) & 0xFFFFF);
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    Json::Value stats;
+    hist->Query(stats);
+    DoNotOptimize(stats);
+  }
+}
+TINCAN_BENCHMARK(LatencyHistogramQuery);
+} // namespace tincan
@@ -0,0 +1,182 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "bench.h"
+#include <algorithm>
+#include <ctime>
+#include <unistd.h>
+/*
+Runs the registered benchmarks, or those whose name contains the filter, and
+prints the results as a table or as a JSON document for tools that compare
+runs.
+
+  tincan-bench [--filter=TEXT] [--min-time=MS] [--format=text|json]
+*/
+namespace tincan
+{
+TincanParameters tp;
+
+vector<BenchDescriptor> &
+BenchRegistry()
+{
+  static vector<BenchDescriptor> registry;
+  return registry;
+}
+
+struct BenchResult
+{
+  string name;
+  uint64_t iterations;
+  double ns_per_iteration;
+  double mb_per_second;
+  uint64_t memory_bytes;
+};
+
+static BenchResult
+RunBenchmark(
+  const BenchDescriptor & bd,
+  uint64_t arg,
+  bool has_arg,
+  double min_time)
+{
+  BenchResult result;
+  result.name = bd.name;
+  if(has_arg)
+    result.name.append("/").append(std::to_string(arg));
+  BenchState state;
+  state.arg = arg;
+  state.iterations = 1;
+  for(;;)
+  {
+    state.StartTiming();
+    bd.fn(state);
+    double elapsed = std::chrono::duration<double>(
+      steady_clock::now() - state.start).count();
+    if(elapsed >= min_time || state.iterations >= (1ull << 40))
+    {
+      result.iterations = state.iterations;
+      result.memory_bytes = state.memory_bytes;
+      result.ns_per_iteration = elapsed * 1e9 / state.iterations;
+      result.mb_per_second = state.bytes_per_iteration ?
+        state.bytes_per_iteration * state.iterations / elapsed / 1e6 : 0;
+      return result;
+    }
+    //aim past the minimum so the next run is usually the last
+    double scale = elapsed > 0 ? min_time * 1.4 / elapsed : 100;
+    scale = std::min(std::max(scale, 2.0), 100.0);
+    state.iterations = (uint64_t)(state.iterations * scale);
+  }
+}
+
+static void
+PrintTextHeader()
+{
+  printf("%-40s %14s %14s %12s %12s\n", "BENCHMARK", "ITERATIONS",
+    "NS/ITER", "MB/S", "MEMORY KB");
+}
+
+static void
+PrintText(
+  const BenchResult & r)
+{
+  printf("%-40s %14llu %14.1f %12.1f %12.1f\n", r.name.c_str(),
+    (unsigned long long)r.iterations, r.ns_per_iteration, r.mb_per_second,
+    r.memory_bytes / 1024.0);
+  fflush(stdout);
+}
+
+//Benchmark names are identifiers and numbers, they need no escaping
+static void
+PrintJson(
+  const vector<BenchResult> & results)
+{
+  char host[256] = { 0 };
+  gethostname(host, sizeof(host) - 1);
+  char date[32] = { 0 };
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  printf("{\n  \"context\": {\n");
+  printf("    \"version\": \"%d.%d.%d\",\n", tp.kTincanVerMjr, tp.kTincanVerMnr,
+    tp.kTincanVerRev);
+  printf("    \"date\": \"%s\",\n", date);
+  printf("    \"host\": \"%s\"\n  },\n", host);
+  printf("  \"benchmarks\": [");
+  for(size_t i = 0; i < results.size(); i++)
+  {
+    const BenchResult & r = results[i];
+    printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+      "\"ns_per_iteration\": %.2f, \"mb_per_second\": %.2f, "
+      "\"memory_bytes\": %llu}",
+      i ? "," : "", r.name.c_str(), (unsigned long long)r.iterations,
+      r.ns_per_iteration, r.mb_per_second,
+      (unsigned long long)r.memory_bytes);
+  }
+  printf("\n  ]\n}\n");
+}
+} // namespace tincan
+
+using namespace tincan;
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  string filter;
+  double min_time = 0.5;
+  bool json = false;
+  for(int i = 1; i < argc; i++)
+  {
+    if(strncmp(argv[i], "--filter=", 9) == 0)
+      filter = argv[i] + 9;
+    else if(strncmp(argv[i], "--min-time=", 11) == 0)
+      min_time = atof(argv[i] + 11) / 1000;
+    else if(strcmp(argv[i], "--format=json") == 0)
+      json = true;
+    else if(strcmp(argv[i], "--format=text") == 0)
+      json = false;
+    else
+    {
+      fprintf(stderr, "usage: %s [--filter=TEXT] [--min-time=MS] "
+        "[--format=text|json]\n", argv[0]);
+      return 2;
+    }
+  }
+  if(!json)
+    PrintTextHeader();
+  vector<BenchResult> results;
+  for(auto & bd : BenchRegistry())
+  {
+    if(!filter.empty() && bd.name.find(filter) == string::npos)
+      continue;
+    vector<uint64_t> args = bd.args.empty() ? vector<uint64_t>{ 0 } : bd.args;
+    for(auto arg : args)
+    {
+      results.push_back(RunBenchmark(bd, arg, !bd.args.empty(), min_time));
+      if(!json)
+        PrintText(results.back());
+    }
+  }
+  if(json)
+    PrintJson(results);
+  return 0;
+}
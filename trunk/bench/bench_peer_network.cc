@@ -0,0 +1,362 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "bench.h"
+#include <map>
+#include <random>
+#include <sparsepp/spp.h>
+#include "ip4_route_table.h"
+#include "peer_network.h"
+/*
+Forwarding table lookups at increasing table sizes. The peer network has a
+fixed set of adjacent peers and the given number of routes through them, the
+destinations are probed in random order so the cost of cache misses on the
+larger tables is included. The vlinks are never connected.
+
+The TwoMap benchmarks are the baselines the forwarding table replaced. Cache
+misses of a pair can be compared by running each under perf stat. The Find
+benchmarks probe MacTable and the unordered_map and sparsepp tables it is
+compared against, and report the memory each holds at the size.
+*/
+namespace tincan
+{
+static const uint32_t kAdjacentPeers = 16;
+
+static MacAddressType
+MacOf(
+  uint8_t prefix,
+  uint32_t index)
+{
+  return MacAddressType{ prefix, 0x00, (uint8_t)(index >> 24),
+    (uint8_t)(index >> 16), (uint8_t)(index >> 8), (uint8_t)index };
+}
+
+//A peer network with the specified number of routes, built once per size
+struct RoutedPeerNetwork
+{
+  explicit RoutedPeerNetwork(
+    uint32_t routes)
+  {
+    for(uint32_t i = 0; i < kAdjacentPeers; i++)
+    {
+      unique_ptr<VlinkDescriptor> vld = make_unique<VlinkDescriptor>();
+      vld->dtls_enabled = true;
+      vld->uid = "vlink" + std::to_string(i);
+      unique_ptr<PeerDescriptor> pd = make_unique<PeerDescriptor>();
+      pd->uid = "peer" + std::to_string(i);
+      MacAddressType mac = MacOf(0x02, i);
+      pd->mac_address = ByteArrayToString(mac.begin(), mac.end());
+      peer_net.Add(make_shared<VirtualLink>(move(vld), move(pd), &thread,
+        &thread));
+    }
+    vector<RouteUpdate> updates(routes);
+    dests.resize(routes);
+    for(uint32_t i = 0; i < routes; i++)
+    {
+      updates[i].dest = dests[i] = MacOf(0x0A, i);
+      updates[i].path = MacOf(0x02, i % kAdjacentPeers);
+    }
+    peer_net.UpdateRouteTable(updates, true);
+    std::shuffle(dests.begin(), dests.end(), std::mt19937(routes));
+  }
+
+  static RoutedPeerNetwork & Get(
+    uint32_t routes)
+  {
+    static std::map<uint32_t, unique_ptr<RoutedPeerNetwork>> networks;
+    unique_ptr<RoutedPeerNetwork> & pn = networks[routes];
+    if(!pn)
+      pn = make_unique<RoutedPeerNetwork>(routes);
+    return *pn;
+  }
+
+  rtc::Thread thread;
+  PeerNetwork peer_net;
+  vector<MacAddressType> dests;
+};
+
+/*
+The forwarding state as it was before the single forwarding table. Adjacent
+peers and routes were held in separate maps and resolving a destination took
+up to four probes, each under the lock: IsAdjacent then GetVlink, or
+IsRouteExists then GetRoute.
+*/
+struct TwoMapPeerNetwork
+{
+  struct MacAddressHasher
+  {
+    size_t operator()(const MacAddressType& mac) const
+    {
+      size_t h = 0;
+      for(auto e : mac)
+      {
+        h ^= hash<uint8_t>{}(e)+0x9e3779b9 + (h << 6) + (h >> 2);
+      }
+      return h;
+    }
+  };
+  struct HubEx
+  {
+    HubEx() : accessed(steady_clock::now())
+    {}
+    shared_ptr<VirtualLink> vl;
+    steady_clock::time_point accessed;
+  };
+
+  explicit TwoMapPeerNetwork(
+    RoutedPeerNetwork & rpn)
+  {
+    vector<shared_ptr<VirtualLink>> vlinks;
+    rpn.peer_net.QueryVlinks(vlinks);
+    for(auto & vl : vlinks)
+    {
+      MacAddressType mac;
+      StringToByteArray(vl->PeerInfo().mac_address, mac.begin(), mac.end());
+      mac_map_[mac] = vl;
+    }
+    for(uint32_t i = 0; i < rpn.dests.size(); i++)
+    {
+      ForwardingDecision fd = rpn.peer_net.Lookup(rpn.dests[i]);
+      mac_routes_[rpn.dests[i]].vl = fd.vlink;
+    }
+  }
+
+  bool IsAdjacent(
+    const MacAddressType & mac)
+  {
+    lock_guard<mutex> lgm(mac_map_mtx_);
+    return (mac_map_.count(mac) == 1);
+  }
+  shared_ptr<VirtualLink> GetVlink(
+    const MacAddressType & mac)
+  {
+    lock_guard<mutex> lgm(mac_map_mtx_);
+    return mac_map_.at(mac);
+  }
+  //The vlink's validity was also checked here, with only kAdjacentPeers
+  //vlinks that is a cache hit and is left out
+  bool IsRouteExists(
+    const MacAddressType & mac)
+  {
+    lock_guard<mutex> lgm(mac_map_mtx_);
+    return (mac_routes_.count(mac) == 1 && mac_routes_.at(mac).vl);
+  }
+  shared_ptr<VirtualLink> GetRoute(
+    const MacAddressType & mac)
+  {
+    lock_guard<mutex> lgm(mac_map_mtx_);
+    HubEx & hux = mac_routes_.at(mac);
+    hux.accessed = steady_clock::now();
+    return hux.vl;
+  }
+  //The sequence of the TAP read path
+  shared_ptr<VirtualLink> Lookup(
+    const MacAddressType & mac)
+  {
+    if(IsAdjacent(mac))
+      return GetVlink(mac);
+    if(IsRouteExists(mac))
+      return GetRoute(mac);
+    return nullptr;
+  }
+
+  static TwoMapPeerNetwork & Get(
+    uint32_t routes)
+  {
+    static std::map<uint32_t, unique_ptr<TwoMapPeerNetwork>> networks;
+    unique_ptr<TwoMapPeerNetwork> & pn = networks[routes];
+    if(!pn)
+      pn = make_unique<TwoMapPeerNetwork>(RoutedPeerNetwork::Get(routes));
+    return *pn;
+  }
+
+  mutex mac_map_mtx_;
+  spp::sparse_hash_map<MacAddressType, shared_ptr<VirtualLink>,
+    MacAddressHasher> mac_map_;
+  unordered_map<MacAddressType, HubEx, MacAddressHasher> mac_routes_;
+};
+
+static void
+PeerNetworkLookup(
+  BenchState & state)
+{
+  RoutedPeerNetwork & rpn = RoutedPeerNetwork::Get((uint32_t)state.arg);
+  size_t n = rpn.dests.size();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    ForwardingDecision fd = rpn.peer_net.Lookup(rpn.dests[i % n]);
+    DoNotOptimize(fd);
+  }
+}
+TINCAN_BENCHMARK_ARGS(PeerNetworkLookup, 1000, 10000, 100000);
+
+//The baseline of PeerNetworkLookup, routed destinations take all four probes
+static void
+TwoMapLookup(
+  BenchState & state)
+{
+  RoutedPeerNetwork & rpn = RoutedPeerNetwork::Get((uint32_t)state.arg);
+  TwoMapPeerNetwork & tmpn = TwoMapPeerNetwork::Get((uint32_t)state.arg);
+  size_t n = rpn.dests.size();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    shared_ptr<VirtualLink> vl = tmpn.Lookup(rpn.dests[i % n]);
+    DoNotOptimize(vl);
+  }
+}
+TINCAN_BENCHMARK_ARGS(TwoMapLookup, 1000, 10000, 100000);
+
+//The lookup through the data path's flow cache, mostly misses on large tables
+static void
+PeerNetworkLookupCached(
+  BenchState & state)
+{
+  RoutedPeerNetwork & rpn = RoutedPeerNetwork::Get((uint32_t)state.arg);
+  size_t n = rpn.dests.size();
+  unique_ptr<FlowCache> cache = make_unique<FlowCache>();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    ForwardingDecision fd = rpn.peer_net.Lookup(rpn.dests[i % n], *cache);
+    DoNotOptimize(fd);
+  }
+}
+TINCAN_BENCHMARK_ARGS(PeerNetworkLookupCached, 1000, 10000, 100000);
+
+//The same lookup repeated, as for the frames of a single flow
+static void
+PeerNetworkLookupCachedHit(
+  BenchState & state)
+{
+  RoutedPeerNetwork & rpn = RoutedPeerNetwork::Get((uint32_t)state.arg);
+  unique_ptr<FlowCache> cache = make_unique<FlowCache>();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    ForwardingDecision fd = rpn.peer_net.Lookup(rpn.dests[i & 7], *cache);
+    DoNotOptimize(fd);
+  }
+}
+TINCAN_BENCHMARK_ARGS(PeerNetworkLookupCachedHit, 1000, 100000);
+
+//Memory held by a baseline table, measured on the heap
+template<typename Table>
+static uint64_t
+TableMemory(
+  const Table &,
+  uint64_t heap_used)
+{
+  return heap_used;
+}
+
+template<typename T>
+static uint64_t
+TableMemory(
+  const MacTable<T> & table,
+  uint64_t)
+{
+  return table.MemoryUsage();
+}
+
+//The bare hash table probe, without the lock and the group selection
+template<typename Table>
+static void
+TableFind(
+  BenchState & state)
+{
+  uint32_t size = (uint32_t)state.arg;
+  vector<MacAddressType> keys(size);
+  uint64_t heap = HeapInUse();
+  Table table;
+  for(uint32_t i = 0; i < size; i++)
+    table[keys[i] = MacOf(0x0A, i)] = i;
+  state.memory_bytes = TableMemory(table, HeapInUse() - heap);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(size));
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    auto itr = table.find(keys[i % size]);
+    DoNotOptimize(itr->second);
+  }
+}
+
+static void
+MacTableFind(
+  BenchState & state)
+{
+  TableFind<MacTable<uint32_t>>(state);
+}
+TINCAN_BENCHMARK_ARGS(MacTableFind, 1000, 10000, 100000);
+
+//The node based table that MacTable replaced
+static void
+UnorderedMapFind(
+  BenchState & state)
+{
+  TableFind<unordered_map<MacAddressType, uint32_t,
+    TwoMapPeerNetwork::MacAddressHasher>>(state);
+}
+TINCAN_BENCHMARK_ARGS(UnorderedMapFind, 1000, 10000, 100000);
+
+static void
+SparseHashMapFind(
+  BenchState & state)
+{
+  TableFind<spp::sparse_hash_map<MacAddressType, uint32_t,
+    TwoMapPeerNetwork::MacAddressHasher>>(state);
+}
+TINCAN_BENCHMARK_ARGS(SparseHashMapFind, 1000, 10000, 100000);
+
+//Longest prefix match over the given number of random /24 subnets
+static void
+Ip4RouteLookup(
+  BenchState & state)
+{
+  uint32_t size = (uint32_t)state.arg;
+  std::mt19937 rng(size);
+  vector<Ip4RouteUpdate> updates(size);
+  vector<IP4AddressType> addrs(size);
+  for(uint32_t i = 0; i < size; i++)
+  {
+    uint32_t prefix = (uint32_t)rng() & 0xFFFFFF00;
+    updates[i].prefix = prefix;
+    updates[i].length = 24;
+    updates[i].path = MacOf(0x02, i % kAdjacentPeers);
+    updates[i].remove = false;
+    addrs[i] = IP4AddressType{ (uint8_t)(prefix >> 24),
+      (uint8_t)(prefix >> 16), (uint8_t)(prefix >> 8), (uint8_t)rng() };
+  }
+  Ip4RouteTable table;
+  table.Update(updates, true);
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    MacAddressType path;
+    bool found = table.Lookup(addrs[i % size], path);
+    DoNotOptimize(found);
+    DoNotOptimize(path);
+  }
+}
+TINCAN_BENCHMARK_ARGS(Ip4RouteLookup, 1000, 100000);
+} // namespace tincan
@@ -0,0 +1,151 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "bench.h"
+#include "tap_frame.h"
+/*
+The per frame costs of the data path that are independent of the network:
+allocating and filling a frame from a received buffer, handing a frame over by
+move or by copy, and the header checks made to classify every frame.
+*/
+namespace tincan
+{
+static const uint32_t kFrameSize = 1514;
+static const uint8_t kPeerMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+
+//A tincan frame of the given type, carrying an ethernet frame of kFrameSize
+static vector<uint8_t>
+MakeFrame(
+  uint16_t magic,
+  const uint8_t * dest_mac,
+  uint16_t eth_type,
+  uint8_t arp_op)
+{
+  vector<uint8_t> buf(tp.kTapHeaderSize + kFrameSize, 0);
+  memcpy(buf.data(), &magic, tp.kTapHeaderSize);
+  uint8_t * eth = buf.data() + tp.kTapHeaderSize;
+  static const uint8_t src_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  memcpy(eth, dest_mac, 6);
+  memcpy(eth + 6, src_mac, 6);
+  eth[12] = (uint8_t)(eth_type >> 8);
+  eth[13] = (uint8_t)eth_type;
+  uint8_t * l3 = eth + tp.kEthHeaderSize;
+  if(eth_type == 0x0800)
+  {
+    static const uint8_t ip4[20] = { 0x45, 0, 0x05, 0xDC, 0, 0, 0x40, 0, 64,
+      17, 0, 0, 10, 1, 0, 1, 10, 1, 0, 2 };
+    memcpy(l3, ip4, sizeof(ip4));
+    l3[20] = 0x30; l3[21] = 0x39; l3[22] = 0x01; l3[23] = 0xBB;
+  }
+  else
+    l3[7] = arp_op;
+  return buf;
+}
+
+static void
+TapFrameFromBuffer(
+  BenchState & state)
+{
+  vector<uint8_t> buf = MakeFrame(tp.kDtfMagic, kPeerMac, 0x0800, 0);
+  state.bytes_per_iteration = buf.size();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    TapFrame tf(buf.data(), (uint32_t)buf.size());
+    DoNotOptimize(tf);
+  }
+}
+TINCAN_BENCHMARK(TapFrameFromBuffer);
+
+static void
+TapFrameCopy(
+  BenchState & state)
+{
+  vector<uint8_t> buf = MakeFrame(tp.kDtfMagic, kPeerMac, 0x0800, 0);
+  TapFrame src(buf.data(), (uint32_t)buf.size());
+  state.bytes_per_iteration = buf.size();
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    TapFrame tf(src);
+    DoNotOptimize(tf);
+  }
+}
+TINCAN_BENCHMARK(TapFrameCopy);
+
+//One move construction and one move assignment per iteration
+static void
+TapFrameMove(
+  BenchState & state)
+{
+  vector<uint8_t> buf = MakeFrame(tp.kDtfMagic, kPeerMac, 0x0800, 0);
+  TapFrame tf(buf.data(), (uint32_t)buf.size());
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    TapFrame moved(move(tf));
+    DoNotOptimize(moved);
+    tf = move(moved);
+  }
+  DoNotOptimize(tf);
+}
+TINCAN_BENCHMARK(TapFrameMove);
+
+/*
+The classification done on frames received from a vlink and read from the TAP,
+over a mix of unicast IPv4, ARP request, broadcast and ICC frames.
+*/
+static void
+TapFrameClassify(
+  BenchState & state)
+{
+  static const uint8_t bcast_mac[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  vector<unique_ptr<TapFrame>> frames;
+  vector<vector<uint8_t>> bufs = {
+    MakeFrame(tp.kDtfMagic, kPeerMac, 0x0800, 0),
+    MakeFrame(tp.kDtfMagic, bcast_mac, 0x0806, 1),
+    MakeFrame(tp.kFwdMagic, kPeerMac, 0x0800, 0),
+    MakeFrame(tp.kIccMagic, kPeerMac, 0x0800, 0),
+  };
+  for(auto & buf : bufs)
+    frames.push_back(make_unique<TapFrame>(buf.data(), (uint32_t)buf.size()));
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+  {
+    TapFrameProperties fp(*frames[i & 3]);
+    uint32_t cls = 0;
+    if(fp.IsIccMsg())
+      cls = 1;
+    else if(fp.IsFwdMsg() || fp.IsDtfMsg())
+    {
+      if(fp.IsEthernetBroadcast())
+        cls = fp.IsArpRequest() ? 2 : 3;
+      else if(fp.IsIp4())
+        cls = fp.FlowHash() ^ fp.DestinationIp4Address()[3];
+      else
+        cls = fp.DestinationMac()[5];
+    }
+    DoNotOptimize(cls);
+  }
+}
+TINCAN_BENCHMARK(TapFrameClassify);
+} // namespace tincan
@@ -0,0 +1,90 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "bench.h"
+#include "webrtc/base/event.h"
+#include "webrtc/base/thread.h"
+/*
+The cost of handing work to another rtc::Thread, as the TAP threads do for
+every frame posted to the network worker. Post measures the throughput of a
+stream of messages, Invoke the round trip of a blocking call.
+*/
+namespace tincan
+{
+using rtc::Message;
+using rtc::MessageHandler;
+
+class CountingHandler :
+  public MessageHandler
+{
+public:
+  CountingHandler(
+    uint64_t target) :
+    count_(0),
+    target_(target),
+    done_(false, false)
+  {}
+  void OnMessage(Message * msg) override
+  {
+    if(++count_ == target_)
+      done_.Set();
+  }
+  void Wait()
+  {
+    done_.Wait(rtc::Event::kForever);
+  }
+private:
+  uint64_t count_;
+  uint64_t target_;
+  rtc::Event done_;
+};
+
+static void
+ThreadPost(
+  BenchState & state)
+{
+  rtc::Thread worker;
+  worker.Start();
+  CountingHandler handler(state.iterations);
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+    worker.Post(RTC_FROM_HERE, &handler);
+  handler.Wait();
+  worker.Stop();
+}
+TINCAN_BENCHMARK(ThreadPost);
+
+static void
+ThreadInvoke(
+  BenchState & state)
+{
+  rtc::Thread worker;
+  worker.Start();
+  uint64_t count = 0;
+  state.StartTiming();
+  for(uint64_t i = 0; i < state.iterations; i++)
+    worker.Invoke<void>(RTC_FROM_HERE, [&count]() { count++; });
+  worker.Stop();
+  DoNotOptimize(count);
+}
+TINCAN_BENCHMARK(ThreadInvoke);
+} // namespace tincan
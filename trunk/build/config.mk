@@ -17,6 +17,8 @@ EXT_INC_DIR = ../../external/include
 
 SRC_DIR = ../src
 SRC_DIR_LNX = $(SRC_DIR)/linux
+TOOLS_DIR = ../tools
+BENCH_DIR = ../bench
 
 EXT_LIB_DIR = ../../external/3rd-Party-Libs/$(OPT)
 OUT = ../out
@@ -25,6 +27,9 @@ BIN_DIR = $(OUT)/$(OPT)/$(ARCH)
 
 BINARY = ipop-tincan
 TARGET = $(patsubst %,$(BIN_DIR)/%,$(BINARY))
+STATS_TOOL = $(BIN_DIR)/tincan-stats
+BENCH_TARGET = $(BIN_DIR)/tincan-bench
+LOOPBACK_TOOL = $(BIN_DIR)/tincan-loopback
 
 defines = -DLINUX -D_IPOP_LINUX -DWEBRTC_POSIX -DWEBRTC_LINUX -D_GLIBCXX_USE_CXX11_ABI=0
 
@@ -38,3 +43,8 @@ OBJ_FILES = $(patsubst $(SRC_DIR)/%.cc, $(OBJ_DIR)/%.o, $(SRC_FILES))
 
 LSRC_FILES = $(wildcard $(SRC_DIR_LNX)/*.cc)
 LOBJ_FILES = $(patsubst $(SRC_DIR_LNX)/%.cc, $(OBJ_DIR)/%.o, $(LSRC_FILES))
+
+BENCH_SRC_FILES = $(wildcard $(BENCH_DIR)/*.cc)
+BENCH_OBJ_FILES = $(filter-out $(OBJ_DIR)/tincan_main.o, $(OBJ_FILES)) $(LOBJ_FILES)
+BENCH_ARGS ?=
+LOOPBACK_ARGS ?=
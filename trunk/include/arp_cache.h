@@ -0,0 +1,84 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_ARP_CACHE_H_
+#define TINCAN_ARP_CACHE_H_
+#include "tincan_base.h"
+namespace tincan
+{
+/*
+Maps the IPv4 addresses of the overlay to the MAC addresses of the peers that
+own them. Static bindings come from the peer descriptors of the tunnel's vlinks
+and last as long as the vlink, learned bindings are gleaned from ARP packets
+received over the vlinks and age out unless they are observed again. Time is
+measured in ticks of the peer network's coarse clock.
+*/
+class ArpCache
+{
+public:
+  ArpCache();
+  ~ArpCache() = default;
+  void AddStatic(
+    const IP4AddressType & ip4,
+    const MacAddressType & mac);
+  //Removes all the static bindings to the MAC
+  void RemoveStatic(
+    const MacAddressType & mac);
+  //Records a binding observed at the specified tick, static bindings are not
+  //overridden by learned ones.
+  void Learn(
+    const IP4AddressType & ip4,
+    const MacAddressType & mac,
+    uint32_t now);
+  bool Resolve(
+    const IP4AddressType & ip4,
+    MacAddressType & mac);
+  //Removes the learned bindings that have not been refreshed within the TTL
+  void Expire(
+    uint32_t now);
+  void Clear();
+  size_t Size();
+  uint64_t Hits();
+  uint64_t Misses();
+
+  static const uint32_t kLearnedTtl = 300; //ticks
+private:
+  struct ArpEntry
+  {
+    MacAddressType mac;
+    uint32_t learned;
+    bool is_static;
+  };
+  static uint32_t Key(
+    const IP4AddressType & ip4)
+  {
+    uint32_t key;
+    memcpy(&key, ip4.data(), sizeof(key));
+    return key;
+  }
+  mutex mtx_;
+  unordered_map<uint32_t, ArpEntry> entries_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+} // namespace tincan
+#endif // TINCAN_ARP_CACHE_H_
@@ -36,6 +36,8 @@
 #include "webrtc/base/json.h"
 #include "async_io.h"
 #include "controller_handle.h"
+#include "latency_stats.h"
+#include "link_stats_monitor.h"
 #include "peer_network.h"
 #include "tapdev.h"
 #include "tap_frame.h"
@@ -45,6 +47,22 @@
 
 namespace tincan
 {
+class StatsRegion;
+struct TunnelStatsSlot;
+struct LinkStatsSlot;
+//Totals of the frames through the TAP device, written by the TAP threads
+struct TapCounters
+{
+  TapCounters() :
+    frames_in(0), bytes_in(0), frames_out(0), bytes_out(0), errors(0)
+  {}
+  std::atomic<uint64_t> frames_in;
+  std::atomic<uint64_t> bytes_in;
+  std::atomic<uint64_t> frames_out;
+  std::atomic<uint64_t> bytes_out;
+  std::atomic<uint64_t> errors;
+};
+
 class BasicTunnel :
   public sigslot::has_slots<>,
   public MessageHandler
@@ -55,9 +73,16 @@ public:
     MSGID_TRANSMIT,
     MSGID_SEND_ICC,
     MSGID_QUERY_NODE_INFO,
+    MSGID_QUERY_LINKS_INFO,
     MSGID_FWD_FRAME,
     MSGID_FWD_FRAME_RD,
     MSGID_DISC_LINK,
+    MSGID_REPLICATE,
+    MSGID_REPLICATE_RD,
+    MSGID_STATS_CONFIG,
+    MSGID_STATS_TICK,
+    MSGID_STATS_PUSH,
+    MSGID_STATS_PUBLISH,
   };
   class TransmitMsgData : public MessageData
   {
@@ -65,6 +90,13 @@ public:
     shared_ptr<VirtualLink> vl;
     unique_ptr<TapFrame> frm;
   };
+  //A single frame to be transmitted on each of the vlinks
+  class ReplicateMsgData : public MessageData
+  {
+  public:
+    vector<shared_ptr<VirtualLink>> vls;
+    unique_ptr<TapFrame> frm;
+  };
   class LinkInfoMsgData : public MessageData
   {
   public:
@@ -74,6 +106,27 @@ public:
     LinkInfoMsgData() : info(Json::arrayValue), msg_event(false, false) {}
     ~LinkInfoMsgData() = default;
   };
+  class StatsConfigMsgData : public MessageData
+  {
+  public:
+    uint32_t interval;
+    uint32_t threshold;
+  };
+  class StatsPushMsgData : public MessageData
+  {
+  public:
+    unique_ptr<TincanControl> ctrl;
+  };
+  //The stats of all of the vlinks, collected in one task on the net thread
+  class LinksInfoMsgData : public MessageData
+  {
+  public:
+    vector<shared_ptr<VirtualLink>> vls;
+    Json::Value info;
+    rtc::Event msg_event;
+    LinksInfoMsgData() : info(Json::objectValue), msg_event(false, false) {}
+    ~LinksInfoMsgData() = default;
+  };
   class LinkMsgData : public MessageData
   {
   public:
@@ -84,9 +137,11 @@ public:
     ~LinkMsgData() = default;
   };
 
+  //The tunnel uses the platform's TAP device unless another one is specified
   BasicTunnel(
     unique_ptr<TunnelDescriptor> descriptor,
-    IpopControllerLink * ctrl_handle);
+    IpopControllerLink * ctrl_handle,
+    unique_ptr<TapDevInf> tdev = nullptr);
 
   virtual ~BasicTunnel();
 
@@ -94,6 +149,9 @@ public:
     unique_ptr<TapDescriptor> tap_desc,
     const vector<string>& ignored_list);
 
+  virtual void ConfigureReplication(
+    const Json::Value & rp_descr) = 0;
+
   virtual shared_ptr<VirtualLink> CreateVlink(
     unique_ptr<VlinkDescriptor> vlink_desc,
     unique_ptr<PeerDescriptor> peer_desc) = 0;
@@ -105,6 +163,11 @@ public:
   virtual void InjectFame(
     string && data);
 
+  //Writes a raw ethernet frame to the TAP device
+  virtual void InjectFrame(
+    const uint8_t * data,
+    uint32_t len);
+
   virtual string Name();
 
   virtual string MacAddress();
@@ -119,6 +182,10 @@ public:
     const string & vlink_id,
     Json::Value & vlink_info) = 0;
 
+  //Reports every vlink keyed by its id, as QueryLinkInfo does for one
+  virtual void QueryLinksInfo(
+    Json::Value & links_info);
+
   virtual void QueryLinkCas(
     const string & vlink_id,
     Json::Value & cas_info) = 0;
@@ -135,11 +202,42 @@ public:
 
   virtual void StopIo() {}
 
+  //Starts, changes or ends the periodic push of the vlinks' stats
+  virtual void SubscribeLinkStats(
+    const Json::Value & sub_desc);
+
+  //Turns the timing of frames through the tunnel on or off
+  virtual void ConfigureLatencyStats(
+    const Json::Value & cfg_desc);
+
+  //Reports the latency of each pipeline stage for the tunnel and its vlinks
+  virtual void QueryLatencyStats(
+    bool reset,
+    Json::Value & stats);
+
+  //Publishes the tunnel's counters to the shared stats region, must be set
+  //before the tunnel is started
+  void SetStatsRegion(
+    StatsRegion * stats_region);
+
+  //ICCs from the vlinks are passed to the controller over this link while it
+  //is attached, must be set before the tunnel is started
+  void SetIccLink(
+    IccLink * icc_link);
+
   virtual void RemoveLink(
     const string & vlink_id) = 0;
 
   virtual void UpdateRouteTable(
-    const Json::Value & rt_descr) = 0;
+    const Json::Value & rt_descr,
+    Json::Value & rt_info) = 0;
+
+  virtual void UpdateIp4RouteTable(
+    const Json::Value & rt_descr,
+    Json::Value & rt_info) = 0;
+
+  virtual void UpdateBroadcastTree(
+    const Json::Value & bct_descr) = 0;
 
   //
   //FrameHandler implementation
@@ -169,15 +267,65 @@ protected:
     string vlink_id);
   virtual void VLinkDown(
     string vlink_id);
-  unique_ptr<TapDev> tdev_;
+  //Appends every vlink of the tunnel
+  virtual void QueryVlinks(
+    vector<shared_ptr<VirtualLink>> & vlinks) = 0;
+  void PushLinkStats();
+  //Hands an ICC received on the vlink to the controller
+  void DeliverIcc(
+    TapFrame & frame,
+    VirtualLink & vlink);
+  //Frames held awaiting a route, and those discarded, by the forwarding logic
+  virtual void QueueStats(
+    uint64_t & pending,
+    uint64_t & dropped);
+  void PublishStats();
+  void ReleaseStatsSlots();
+  //The time a frame entered the current stage when latency stats are
+  //enabled, otherwise zero
+  uint64_t LatencyStamp() const
+  {
+    return latency_enabled_.load(std::memory_order_relaxed) ?
+      LatencyClock() : 0;
+  }
+  //Starts timing a frame read from the TAP
+  void StampTapRead(
+    TapFrame & frame)
+  {
+    uint64_t now = LatencyStamp();
+    frame.Timestamp(now, now);
+  }
+  //Records a frame received from the vlink at the specified time that is
+  //about to be written to the TAP
+  void RecordVlinkToTap(
+    TapFrame & frame,
+    VirtualLink & vlink,
+    uint64_t received);
+  //Records a timed frame whose TAP write completed
+  void RecordTapWrite(
+    TapFrame & frame);
+  static const uint32_t kStatsRttRefresh = 10; //publishes
+  unique_ptr<TapDevInf> tdev_;
   unique_ptr<TapDescriptor> tap_desc_;
   unique_ptr<TunnelDescriptor> descriptor_;
   //shared_ptr<IpopControllerLink> ctrl_link_;
   IpopControllerLink * ctrl_link_;
+  IccLink * icc_link_;
   unique_ptr<rtc::SSLIdentity> sslid_;
   unique_ptr<rtc::SSLFingerprint> local_fingerprint_;
   rtc::Thread net_worker_;
   rtc::Thread sig_worker_;
+  //the stats subscription, only used on net_worker_
+  LinkStatsMonitor stats_monitor_;
+  bool stats_tick_pending_;
+  TapCounters tap_counters_;
+  //the shared stats region and this tunnel's slots in it, net_worker_ only
+  StatsRegion * stats_region_;
+  TunnelStatsSlot * tnl_stats_slot_;
+  map<string, LinkStatsSlot *> link_stats_slots_;
+  uint32_t stats_publishes_;
+  std::atomic<bool> latency_enabled_;
+  StageLatencies latencies_;
   rtc::BasicNetworkManager net_manager_;
 };
 }  // namespace tincan
@@ -0,0 +1,95 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_BROADCAST_TREE_H_
+#define TINCAN_BROADCAST_TREE_H_
+#include "tincan_base.h"
+namespace tincan
+{
+struct BroadcastTreeStats
+{
+  uint64_t originated;
+  uint64_t forwarded;
+  uint64_t delivered;
+  uint64_t duplicates;
+};
+/*
+The tunnel's position in the overlay's broadcast distribution tree, as
+installed by the controller. Group addressed frames are flooded along the tree
+edges, a frame received from one tree neighbor is delivered locally and passed
+on to all the other tree neighbors, so each node sees a single copy and the
+cost of a broadcast follows the fan-out of the tree.
+Each broadcast carries the MAC of the node that originated it and a sequence
+number from that node. The recent sequence numbers of every origin are
+remembered so that the copies from transient loops while the tree is being
+reconfigured are dropped, while a frame that is legitimately sent again, such
+as an ARP retry, is a new broadcast and is delivered.
+*/
+class BroadcastTree
+{
+public:
+  BroadcastTree();
+  ~BroadcastTree() = default;
+  //Installs the tree edges of this node, without a parent it is the root
+  void Install(
+    bool has_parent,
+    const MacAddressType & parent,
+    const vector<MacAddressType> & children);
+  void Clear();
+  bool IsInstalled();
+  //MACs of the parent and children
+  vector<MacAddressType> Neighbors();
+  //Sequence number for the next broadcast originated by this node
+  uint32_t NextSequence();
+  //Returns true the first time the origin's sequence number is seen
+  bool FirstSeen(
+    const MacAddressType & origin,
+    uint32_t seq);
+  void Originated();
+  void Forwarded(
+    size_t copies);
+  void Delivered();
+  BroadcastTreeStats Stats();
+
+  static const uint32_t kSeqWindow = 64;
+  static const uint32_t kOriginExpiry = 60000; //ms
+  static const uint32_t kMaxOrigins = 4096;
+private:
+  //Highest sequence seen from an origin and a bitmap of the ones before it
+  struct SeqWindow
+  {
+    uint32_t highest;
+    uint64_t seen;
+    steady_clock::time_point last_seen;
+  };
+  void ExpireOrigins(
+    steady_clock::time_point now);
+  mutex mtx_;
+  bool has_parent_;
+  MacAddressType parent_;
+  vector<MacAddressType> children_;
+  uint32_t next_seq_;
+  map<MacAddressType, SeqWindow> origins_;
+  BroadcastTreeStats stats_;
+};
+} // namespace tincan
+#endif // TINCAN_BROADCAST_TREE_H_
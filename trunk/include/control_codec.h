@@ -0,0 +1,100 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_CONTROL_CODEC_H_
+#define TINCAN_CONTROL_CODEC_H_
+#include "tincan_base.h"
+#include "webrtc/base/json.h"
+
+namespace tincan
+{
+/*
+The compact binary encoding of a control. A control starts with a fixed little
+endian header, the magic bytes, the protocol version, the control type, the
+length of the body that follows and the transaction id. The body holds the
+request and the response of the control, each present when flagged, as tagged
+values. Integers and lengths are varints and object keys that are part of the
+control schema are sent as their index into the key table, other keys are sent
+inline. The key table is append only, entries must never be reordered.
+*/
+struct ControlHeader
+{
+  ControlHeader() : version(0), type(0), tag(0)
+  {}
+  uint8_t version;
+  uint8_t type;
+  uint64_t tag;
+};
+
+class ControlCodec
+{
+public:
+  //Returns true if the data is a binary encoded control, JSON never starts
+  //with the magic bytes
+  static bool IsBinary(
+    const char * data,
+    size_t len);
+
+  static void Encode(
+    const ControlHeader & hdr,
+    const Json::Value * req,
+    const Json::Value * resp,
+    string & out);
+
+  //Throws if the data is truncated or malformed, or if the lengths in the
+  //header and the body disagree
+  static void Decode(
+    const char * data,
+    size_t len,
+    ControlHeader & hdr,
+    Json::Value & req,
+    Json::Value & resp);
+
+  static const uint8_t kMagic[2];
+  static const size_t kHeaderSize = 16;
+private:
+  enum TAG
+  {
+    TAG_NULL,
+    TAG_FALSE,
+    TAG_TRUE,
+    TAG_INT,
+    TAG_UINT,
+    TAG_REAL,
+    TAG_STRING,
+    TAG_ARRAY,
+    TAG_OBJECT,
+  };
+  static const uint8_t kHasRequest = 0x01;
+  static const uint8_t kHasResponse = 0x02;
+  static const uint32_t kMaxDepth = 64;
+  static void EncodeValue(
+    const Json::Value & val,
+    string & out);
+  static void DecodeValue(
+    const uint8_t *& pos,
+    const uint8_t * end,
+    uint32_t depth,
+    Json::Value & val);
+};
+} // namespace tincan
+#endif // TINCAN_CONTROL_CODEC_H_
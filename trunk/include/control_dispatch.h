@@ -27,6 +27,7 @@
 #include "webrtc/base/logsinks.h"
 #include "webrtc/base/fileutils.h"
 #include "webrtc/base/pathutils.h"
+#include "webrtc/base/thread.h"
 #include <map>
 #include <memory>
 #include <mutex>
@@ -39,37 +40,54 @@ using rtc::FileRotatingLogSink;
 using rtc::LogMessage;
 using rtc::Filesystem;
 using rtc::Pathname;
-class ControlDispatch
+using rtc::Message;
+using rtc::MessageData;
+using rtc::MessageHandler;
+using rtc::Thread;
+/*
+Executes the controls received by the listener. Controls that operate on a
+tunnel are queued to one of a pool of workers, chosen by the tunnel id, so the
+controls of a tunnel run in the order received while different tunnels, and the
+listener itself, proceed independently. Controls that are not bound to a tunnel
+are brief and run on the calling thread.
+*/
+class ControlDispatch :
+  public MessageHandler
 {
 public:
   ControlDispatch();
   ~ControlDispatch();
   void operator () (TincanControl & control);
+  //
+  //MessageHandler overrides
+  void OnMessage(Message * msg) override;
   void SetDispatchToTincanInf(TincanDispatchInterface * dtot);
   void SetDispatchToListenerInf(DispatchToListenerInf * dtol);
 
 private:
+  void ConfigureLatencyStats(TincanControl & control);
   void ConfigureLogging(TincanControl & control);
+  void ConfigureReplication(TincanControl & control);
   void CreateLink(TincanControl & control);
+  void CreateLinks(TincanControl & control);
   void CreateIpopControllerRespLink(TincanControl & control);
   void CreateTunnel(TincanControl & control);
   void Echo(TincanControl & control);
   void InjectFrame(TincanControl & control);
+  void QueryLatencyStats(TincanControl & control);
   void QueryLinkStats(TincanControl & control);
   void QueryTunnelInfo(TincanControl & control);
   void QueryCandidateAddressSet(TincanControl & control);
   void RemoveLink(TincanControl & control);
+  void RemoveLinks(TincanControl & control);
   void RemoveTunnel(TincanControl & control);
   void UpdateRouteTable(TincanControl & control);
+  void UpdateIp4RouteTable(TincanControl & control);
+  void UpdateBroadcastTree(TincanControl & control);
   LoggingSeverity GetLogLevel(const string & log_level);
   void SendIcc(TincanControl & control);
+  void SubscribeLinkStats(TincanControl & control);
 
-  map<string, void (ControlDispatch::*)(TincanControl & control)>control_map_;
-  DispatchToListenerInf * dtol_;
-  TincanDispatchInterface * tincan_;
-  IpopControllerLink * ctrl_link_;
-  mutex disp_mutex_;
-  unique_ptr<FileRotatingLogSink> log_sink_;
   class DisconnectedControllerHandle : virtual public IpopControllerLink {
   public:
     DisconnectedControllerHandle() {
@@ -89,6 +107,33 @@ private:
     }
     string msg_;
   };
+  enum MSG_ID
+  {
+    MSGID_CONTROL,
+  };
+  class ControlMsgData : public MessageData
+  {
+  public:
+    ControlMsgData(TincanControl && control) : ctrl(move(control))
+    {}
+    TincanControl ctrl;
+  };
+  void Execute(TincanControl & control);
+  Thread & WorkerFor(const string & tnl_id);
+  IpopControllerLink & ControllerLink()
+  {
+    return *ctrl_link_.load();
+  }
+
+  static const uint32_t kWorkerCount = 4;
+  map<string, void (ControlDispatch::*)(TincanControl & control)>control_map_;
+  DispatchToListenerInf * dtol_;
+  TincanDispatchInterface * tincan_;
+  DisconnectedControllerHandle disc_link_;
+  //replaced by the controller's link once it is created, read by the workers
+  std::atomic<IpopControllerLink *> ctrl_link_;
+  vector<unique_ptr<Thread>> workers_;
+  unique_ptr<FileRotatingLogSink> log_sink_;
 }; // ControlDispatch
 }  // namespace tincan
 #endif  // TINCAN_CONTROL_DISPATCH_H_
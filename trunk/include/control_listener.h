@@ -78,6 +78,9 @@ private:
   unique_ptr<SocketAddress> ctrl_addr_;      //Address for Listener Controller Module
   PacketOptions packet_options_;
   std::mutex skt_mutex_;
+  //protocol version of the latest control from the controller, used for the
+  //controls tincan originates
+  std::atomic<uint32_t> proto_ver_;
 };
 }  // namespace tincan
 #endif  // TINCAN_CONTROL_LISTENER_H_
@@ -37,6 +37,20 @@ namespace tincan {
       unique_ptr<TincanControl> ctrl_resp) = 0;
   };
 
+  //A path for ICC payloads to the controller that bypasses the controls
+  class IccLink
+  {
+  public:
+    virtual ~IccLink() = default;
+    //Returns false if no controller is attached, the ICC must then be
+    //delivered as a control
+    virtual bool DeliverIcc(
+      const string & tnl_id,
+      const string & link_id,
+      const uint8_t * data,
+      uint32_t len) = 0;
+  };
+
   class DispatchToListenerInf
   {
   public:
@@ -51,6 +65,9 @@ namespace tincan {
   public:
     virtual ~TincanDispatchInterface() = default;
 
+    virtual void ConfigureReplication(
+      const Json::Value & rp_desc) = 0;
+
     virtual void CreateTunnel(
       const Json::Value & tnl_desc,
       Json::Value & tnl_info) = 0;
@@ -59,9 +76,22 @@ namespace tincan {
       const Json::Value & link_desc,
       const TincanControl & control) = 0;
 
+    virtual void CreateVlinks(
+      const Json::Value & links_desc,
+      const TincanControl & control) = 0;
+
     virtual void InjectFrame(
       const Json::Value & frame_desc) = 0;
 
+    //Writes raw ethernet frames to the tunnel's TAP device
+    virtual void InjectFrames(
+      const string & tnl_id,
+      const vector<pair<const uint8_t *, uint32_t>> & frames) = 0;
+
+    virtual void QueryLatencyStats(
+      const Json::Value & tnl_desc,
+      Json::Value & stats) = 0;
+
     virtual void QueryLinkStats(
       const Json::Value & link_desc,
       Json::Value & node_info) = 0;
@@ -80,14 +110,37 @@ namespace tincan {
     virtual void RemoveVlink(
       const Json::Value & link_desc) = 0;
 
+    virtual void RemoveVlinks(
+      const Json::Value & links_desc,
+      Json::Value & links_info) = 0;
+
     virtual void SendIcc(
       const Json::Value & icc_desc) = 0;
 
+    virtual void SendIcc(
+      const string & tnl_id,
+      const string & link_id,
+      const string & data) = 0;
+
+    virtual void SubscribeLinkStats(
+      const Json::Value & sub_desc) = 0;
+
+    virtual void ConfigureLatencyStats(
+      const Json::Value & cfg_desc) = 0;
+
     virtual void SetIpopControllerLink(
       IpopControllerLink * ctrl_link) = 0;
 
     virtual void UpdateRouteTable(
-      const Json::Value & rts_desc) = 0;
+      const Json::Value & rts_desc,
+      Json::Value & rts_info) = 0;
+
+    virtual void UpdateIp4RouteTable(
+      const Json::Value & rts_desc,
+      Json::Value & rts_info) = 0;
+
+    virtual void UpdateBroadcastTree(
+      const Json::Value & bct_desc) = 0;
 };
 }  // namespace tincan
 #endif  // TINCAN_CONTROLLER_HANDLE_H_
@@ -0,0 +1,100 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_FRAME_REPLICATOR_H_
+#define TINCAN_FRAME_REPLICATOR_H_
+#include "tincan_base.h"
+namespace tincan
+{
+//A token bucket that admits rate frames per second with bursts of up to burst
+class TokenBucket
+{
+public:
+  TokenBucket(
+    double rate = 0,
+    double burst = 0);
+  bool Consume();
+private:
+  double rate_;
+  double burst_;
+  double tokens_;
+  steady_clock::time_point last_;
+};
+
+struct ReplicationPolicy
+{
+  ReplicationPolicy() : rate(kDefaultRate), burst(kDefaultBurst)
+  {}
+  //MACs of the adjacent peers that receive copies, empty for all of them
+  vector<MacAddressType> peers;
+  double rate;  //frames per second
+  double burst; //frames
+  static const uint32_t kDefaultRate = 200;
+  static const uint32_t kDefaultBurst = 50;
+};
+
+struct ReplicationStats
+{
+  uint64_t frames;
+  uint64_t copies;
+  uint64_t rate_limited;
+};
+/*
+Decides which adjacent peers receive a copy of a broadcast or multicast frame
+read from the TAP. Each configured group address has its own policy and rate
+limit, frames to any other group address share the default policy. Until it is
+enabled the replicator admits nothing and group frames are left to the
+controller.
+*/
+class FrameReplicator
+{
+public:
+  FrameReplicator();
+  ~FrameReplicator() = default;
+  void Configure(
+    bool enabled,
+    const ReplicationPolicy & default_policy,
+    const map<MacAddressType, ReplicationPolicy> & groups);
+  bool IsEnabled();
+  //Charges a frame to the group's rate limit. Returns false if it exceeds the
+  //limit, otherwise peers is set to the group's configured peers.
+  bool Admit(
+    const MacAddressType & group,
+    vector<MacAddressType> & peers);
+  //Records the number of copies made of an admitted frame
+  void Replicated(
+    size_t copies);
+  ReplicationStats Stats();
+private:
+  struct ReplicationGroup
+  {
+    ReplicationPolicy policy;
+    TokenBucket bucket;
+  };
+  mutex mtx_;
+  bool enabled_;
+  ReplicationGroup default_group_;
+  map<MacAddressType, ReplicationGroup> groups_;
+  ReplicationStats stats_;
+};
+} // namespace tincan
+#endif // TINCAN_FRAME_REPLICATOR_H_
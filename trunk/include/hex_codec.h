@@ -0,0 +1,56 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_HEX_CODEC_H_
+#define TINCAN_HEX_CODEC_H_
+#include <cstddef>
+#include <cstdint>
+namespace tincan
+{
+/*
+Conversion between bytes and their hex representation for contiguous buffers,
+used by ByteArrayToString and StringToByteArray. Runs of 16 bytes are handled
+with SSE2 where it is available and the remainder through lookup tables.
+*/
+//Writes the 2 * len hex digits of src to dst, which is not nul terminated
+void HexEncode(
+  const uint8_t * src,
+  size_t len,
+  char * dst,
+  bool uppercase);
+
+//Decodes pairs of hex digits from src into at most dst_len bytes, stopping at
+//the first pair that is not valid. A single digit left at the end of src is
+//decoded as a byte of its own. Returns the number of bytes written.
+size_t HexDecode(
+  const char * src,
+  size_t src_len,
+  uint8_t * dst,
+  size_t dst_len);
+
+//The value of a hex digit, or -1 if the character is not one
+extern const int8_t kHexDigitValue[256];
+//The two hex digits of each byte value
+extern const char kHexPairsUpper[513];
+extern const char kHexPairsLower[513];
+} // namespace tincan
+#endif // TINCAN_HEX_CODEC_H_
@@ -0,0 +1,112 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_ICC_CHANNEL_H_
+#define TINCAN_ICC_CHANNEL_H_
+#if !defined(_IPOP_WIN)
+#include "tincan_base.h"
+#include "controller_handle.h"
+#include "unix_stream_server.h"
+
+namespace tincan
+{
+using namespace rtc;
+/*
+Carries ICC payloads between the vlinks and the controller on a unix domain
+stream socket, without wrapping them in controls. Both directions use the same
+framing, all integers are big endian:
+
+  u32  length of the remainder of the frame
+  u8   type, kIccFrame or kInjectFrame
+  u8   tunnel id length
+  u8   link id length, 0 for kInjectFrame
+  u8   reserved, 0
+       tunnel id, link id, payload
+
+The controller also sends kInjectFrame frames, whose payload is a raw ethernet
+frame to be written to the tunnel's TAP device. Consecutive injections to a
+tunnel that arrive in one read are passed to it as a single batch.
+
+ICCs received on the vlinks are appended to a send buffer by the tunnels'
+network threads and the channel thread writes out everything that accumulated
+since its last write in one call. ICCs from the controller are read in bulk
+and handed to their tunnels. While no controller is connected the tunnels
+deliver ICCs as controls instead. A single controller is served, a new
+connection replaces the previous one.
+*/
+class IccChannel :
+  public UnixStreamServer,
+  public IccLink,
+  public MessageHandler,
+  public Runnable
+{
+public:
+  IccChannel(
+    TincanDispatchInterface & tincan,
+    const string & socket_path);
+  ~IccChannel();
+  //
+  //IccLink interface
+  bool DeliverIcc(
+    const string & tnl_id,
+    const string & link_id,
+    const uint8_t * data,
+    uint32_t len) override;
+  //
+  //MessageHandler overrides
+  void OnMessage(
+    Message * msg) override;
+  //
+  //Runnable
+  void Run(
+    Thread * thread) override;
+
+  static const uint8_t kIccFrame = 1;
+  static const uint8_t kInjectFrame = 2;
+  static const uint32_t kFrameHeaderSize = 8;
+  static const uint32_t kMaxFrameSize =
+    4 + 255 + 255 + TincanParameters::kEthernetSize;
+  //ICCs are dropped rather than buffered beyond this
+  static const uint32_t kMaxPending = 4 * 1024 * 1024;
+private:
+  enum MSG_ID
+  {
+    MSGID_FLUSH,
+  };
+  //Passes each complete ICC and run of injections to its tunnel
+  void OnReceived(
+    string & rcv_buf) override;
+  void OnClosed() override;
+  void Flush();
+  void InjectFrames(
+    const string & tnl_id,
+    vector<pair<const uint8_t *, uint32_t>> & frames);
+
+  TincanDispatchInterface & tincan_;
+  Thread * thread_;
+  //frames awaiting the next flush, guarded by conn_mutex_
+  string snd_buf_;
+  uint64_t dropped_;
+};
+}  // namespace tincan
+#endif  // !_IPOP_WIN
+#endif  // TINCAN_ICC_CHANNEL_H_
@@ -0,0 +1,118 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_IP4_ROUTE_TABLE_H_
+#define TINCAN_IP4_ROUTE_TABLE_H_
+#include "tincan_base.h"
+namespace tincan
+{
+struct Ip4RouteUpdate
+{
+  //network prefix in host byte order, host bits are ignored
+  uint32_t prefix;
+  uint8_t length;
+  //MAC of the adjacent peer the subnet is reached through
+  MacAddressType path;
+  bool remove;
+};
+
+struct Ip4RouteUpdateStats
+{
+  uint32_t added;
+  uint32_t removed;
+  uint32_t rejected;
+  uint32_t routes;
+  std::chrono::microseconds build_time;
+};
+/*
+Longest prefix match table for the IPv4 subnets that are reachable through
+peers. Lookups use a DIR-16-8-8 layout: the upper 16 bits of the address index
+a flat table whose entries are either the final result or refer to a group of
+256 entries for the next 8 bits, and likewise for the last 8 bits. A lookup is
+at most three dependent loads. The lookup structure is immutable, updates
+rebuild it from the route set off to the side and publish it with an atomic
+pointer swap so readers never block.
+*/
+class Ip4RouteTable
+{
+public:
+  Ip4RouteTable();
+  ~Ip4RouteTable() = default;
+  //Applies a batch of additions and removals, or replaces all routes with the
+  //additions in the batch.
+  Ip4RouteUpdateStats Update(
+    const vector<Ip4RouteUpdate> & updates,
+    bool replace);
+  //Finds the path for the longest prefix that contains the address
+  bool Lookup(
+    const IP4AddressType & ip4,
+    MacAddressType & path) const;
+  void Clear();
+  size_t Size();
+private:
+  class Lpm
+  {
+  public:
+    Lpm(
+      const map<pair<uint32_t, uint8_t>, MacAddressType> & routes);
+    //Returns 1 + index of the next hop, or 0 when no prefix matches
+    uint32_t Lookup(
+      uint32_t addr) const
+    {
+      uint32_t ent = tbl16_[addr >> 16];
+      if(ent & kGroup)
+      {
+        ent = tbl8_[((ent & ~kGroup) << 8) | ((addr >> 8) & 0xFF)];
+        if(ent & kGroup)
+          ent = tbl8_[((ent & ~kGroup) << 8) | (addr & 0xFF)];
+      }
+      return ent;
+    }
+    const MacAddressType & NextHop(
+      uint32_t ent) const
+    {
+      return next_hops_[ent - 1];
+    }
+  private:
+    //marks an entry that holds the index of a group of 256 entries
+    static const uint32_t kGroup = 0x80000000;
+    //Converts the entry at idx of tbl into a group of 256 entries initialized
+    //with its current result, if it is not one already. Returns the group.
+    uint32_t Expand(
+      vector<uint32_t> & tbl,
+      size_t idx);
+    void Fill(
+      vector<uint32_t> & tbl,
+      size_t first,
+      size_t count,
+      uint32_t val);
+    vector<uint32_t> tbl16_;
+    vector<uint32_t> tbl8_;
+    vector<MacAddressType> next_hops_;
+  };
+  //serializes updates, the lookup structure itself is published atomically
+  mutex update_mtx_;
+  map<pair<uint32_t, uint8_t>, MacAddressType> routes_;
+  shared_ptr<const Lpm> lpm_;
+};
+} // namespace tincan
+#endif // TINCAN_IP4_ROUTE_TABLE_H_
@@ -0,0 +1,153 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_LATENCY_STATS_H_
+#define TINCAN_LATENCY_STATS_H_
+#include "tincan_base.h"
+#include "webrtc/base/json.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+namespace tincan
+{
+/*
+The hops of a frame through a tunnel. Egress frames are read from the TAP,
+posted to the network thread and sent on a vlink with DTLS, ingress frames are
+received from a vlink in its OnReadPacket handler and written to the TAP.
+*/
+enum PIPELINE_STAGE
+{
+  PS_TAP_TO_NET,   //TAP read completed to dequeued on the network thread
+  PS_DTLS_SEND,    //the vlink's send, DTLS protection and the socket write
+  PS_VLINK_TO_TAP, //received from the vlink to the TAP write being queued
+  PS_TAP_WRITE,    //TAP write queued to completed
+  PS_EGRESS,       //TAP read completed to sent on the vlink
+  PS_INGRESS,      //received from the vlink to TAP write completed
+  PS_COUNT
+};
+
+extern const char * const kPipelineStageNames[PS_COUNT];
+
+//The monotonic clock frames are timestamped with, in nanoseconds. Never zero,
+//which marks a frame that is not timed.
+inline uint64_t
+LatencyClock()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    steady_clock::now().time_since_epoch()).count() | 1;
+}
+
+/*
+A histogram of durations in the style of HdrHistogram. Values are counted in
+buckets of logarithmically growing width, kSubBuckets to each power of two,
+which bounds the error of a reported value to 1/kSubBuckets of it while a
+few kilobytes cover 1ns to kMaxValue. Larger values are counted as kMaxValue.
+
+Each histogram has a single writer, the data path thread of its stage, so
+recording needs no locked instructions. Any thread may read it. A reset is
+requested by the reader and carried out by the writer with its next record,
+until then the histogram reads as empty.
+*/
+class LatencyHistogram
+{
+public:
+  LatencyHistogram();
+  void Record(
+    uint64_t value)
+  {
+    if(reset_.load(std::memory_order_relaxed))
+      Clear();
+    if(value > kMaxValue)
+      value = kMaxValue;
+    Increment(counts_[BucketIndex((uint32_t)value)], 1);
+    Increment(sum_, value);
+  }
+  void Reset()
+  {
+    reset_.store(true, std::memory_order_relaxed);
+  }
+  //Reports the count, mean, min, max and the 50th, 90th, 99th and 99.9th
+  //percentiles, all in nanoseconds
+  void Query(
+    Json::Value & stats) const;
+
+  static const uint32_t kSubBucketBits = 4;
+  static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+  static const uint32_t kMaxValueBits = 32;
+  static const uint64_t kMaxValue = (1ull << kMaxValueBits) - 1;
+  static const uint32_t kBucketCount =
+    (kMaxValueBits - kSubBucketBits + 1) * kSubBuckets;
+private:
+  static void Increment(
+    std::atomic<uint64_t> & counter,
+    uint64_t count)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + count,
+      std::memory_order_relaxed);
+  }
+  static uint32_t HighestBit(
+    uint32_t value)
+  {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse(&idx, value);
+    return (uint32_t)idx;
+#else
+    return 31 - (uint32_t)__builtin_clz(value);
+#endif
+  }
+  //Values below kSubBuckets have a bucket each, above that each power of two
+  //is split into kSubBuckets buckets
+  static uint32_t BucketIndex(
+    uint32_t value)
+  {
+    if(value < kSubBuckets)
+      return value;
+    uint32_t shift = HighestBit(value) - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + ((value >> shift) - kSubBuckets);
+  }
+  //The largest value counted in the bucket
+  static uint64_t BucketValue(
+    uint32_t index);
+  void Clear();
+  array<std::atomic<uint64_t>, kBucketCount> counts_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<bool> reset_;
+};
+
+//A histogram for each stage of the pipeline
+struct StageLatencies
+{
+  void Record(
+    PIPELINE_STAGE stage,
+    uint64_t value)
+  {
+    stages[stage].Record(value);
+  }
+  void Reset();
+  //Reports the stages that have been recorded, keyed by their name
+  void Query(
+    Json::Value & stats) const;
+  array<LatencyHistogram, PS_COUNT> stages;
+};
+} // namespace tincan
+#endif // TINCAN_LATENCY_STATS_H_
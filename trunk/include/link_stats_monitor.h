@@ -0,0 +1,97 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_LINK_STATS_MONITOR_H_
+#define TINCAN_LINK_STATS_MONITOR_H_
+#include "tincan_base.h"
+#include <algorithm>
+#include "webrtc/base/json.h"
+#include "virtual_link.h"
+namespace tincan
+{
+/*
+Tracks the vlinks of a tunnel for a stats subscription. Each check takes a
+fresh sample of every vlink, derives the transfer rates from the previous
+sample and reports the vlinks whose state changed significantly since they
+were last reported. Every interval all of the vlinks are reported. Only used
+from the tunnel's network thread.
+*/
+class LinkStatsMonitor
+{
+public:
+  LinkStatsMonitor();
+  //An interval of 0 ends the subscription
+  void Configure(
+    uint32_t interval,
+    uint32_t threshold,
+    int64_t now);
+  bool IsEnabled() const
+  {
+    return interval_ != 0;
+  }
+  //Time to the next check, in milliseconds
+  uint32_t CheckInterval() const
+  {
+    return std::min(interval_, kCheckInterval);
+  }
+  //Appends the vlinks to report to links, returns true if there are any. The
+  //full flag is set when the update is the periodic report of all vlinks.
+  bool Update(
+    const vector<pair<string, LinkStatsSample>> & samples,
+    int64_t now,
+    Json::Value & links,
+    bool & full);
+
+  static const uint32_t kCheckInterval = 1000;   //ms
+  static const uint32_t kDefaultThreshold = 25;  //percent
+  static const uint64_t kRateFloor = 1024;       //bytes per second
+private:
+  struct LinkState
+  {
+    LinkState() : at(0), sent_rate(0), recv_rate(0), reported_sent_rate(0),
+      reported_recv_rate(0)
+    {}
+    LinkStatsSample last;
+    LinkStatsSample reported;
+    int64_t at;
+    uint64_t sent_rate;
+    uint64_t recv_rate;
+    uint64_t reported_sent_rate;
+    uint64_t reported_recv_rate;
+  };
+  bool Differs(
+    uint64_t reported,
+    uint64_t current,
+    uint64_t floor) const;
+  bool HasChanged(
+    const LinkState & ls) const;
+  void Report(
+    const string & link_id,
+    LinkState & ls,
+    Json::Value & links);
+  uint32_t interval_;
+  uint32_t threshold_;
+  int64_t next_full_;
+  map<string, LinkState> links_;
+};
+} // namespace tincan
+#endif // TINCAN_LINK_STATS_MONITOR_H_
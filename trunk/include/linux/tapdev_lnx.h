@@ -58,8 +58,6 @@ class TapDevLnx :
 public:
   TapDevLnx();
   virtual ~TapDevLnx();
-  sigslot::signal1<AsyncIo *> read_completion_;
-  sigslot::signal1<AsyncIo *> write_completion_;
   void Open(
     const TapDescriptor & tap_desc) override;
   void Close() override;
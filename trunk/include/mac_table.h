@@ -0,0 +1,466 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_MAC_TABLE_H_
+#define TINCAN_MAC_TABLE_H_
+#include "tincan_base.h"
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TINCAN_MAC_TABLE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+namespace tincan
+{
+/*
+A flat open addressing hash table keyed by MAC address. The slots are arranged
+in groups of 16, each with a control byte holding 7 bits of the key's hash, so
+a probe compares a whole group of control bytes at once (with SSE2 where it is
+available) and only touches the keys whose tag matches. Keys are packed into 8
+bytes and stored apart from the values, a miss or a hit on a small value never
+leaves the control and key arrays. Erased slots are tombstoned and reclaimed
+when the table is rehashed. Not thread safe, the owner serializes access.
+*/
+template<typename ValueType>
+class MacTable
+{
+  static const size_t kGroupWidth = 16;
+  static const int8_t kEmpty = -128;
+  static const int8_t kDeleted = -2;
+  using Slot = std::pair<MacAddressType, ValueType>;
+
+  template<bool kConst>
+  class Iterator
+  {
+  public:
+    using TableType = typename std::conditional<kConst,
+      const MacTable, MacTable>::type;
+    using Reference = typename std::conditional<kConst,
+      const Slot &, Slot &>::type;
+    using Pointer = typename std::conditional<kConst,
+      const Slot *, Slot *>::type;
+    Iterator(TableType * table, size_t index) :
+      table_(table),
+      index_(index)
+    {
+      SkipFree();
+    }
+    Iterator(const Iterator<false> & rhs) :
+      table_(rhs.table_),
+      index_(rhs.index_)
+    {}
+    Reference operator*() const
+    {
+      return table_->slots_[index_];
+    }
+    Pointer operator->() const
+    {
+      return &table_->slots_[index_];
+    }
+    Iterator & operator++()
+    {
+      index_++;
+      SkipFree();
+      return *this;
+    }
+    bool operator==(const Iterator & rhs) const
+    {
+      return index_ == rhs.index_;
+    }
+    bool operator!=(const Iterator & rhs) const
+    {
+      return index_ != rhs.index_;
+    }
+  private:
+    friend class MacTable;
+    template<bool> friend class Iterator;
+    void SkipFree()
+    {
+      while(index_ < table_->capacity_ && table_->ctrl_[index_] < 0)
+        index_++;
+    }
+    TableType * table_;
+    size_t index_;
+  };
+
+public:
+  using iterator = Iterator<false>;
+  using const_iterator = Iterator<true>;
+
+  MacTable() :
+    ctrl_(nullptr),
+    keys_(nullptr),
+    slots_(nullptr),
+    capacity_(0),
+    size_(0),
+    growth_left_(0)
+  {}
+
+  MacTable(const MacTable & rhs) :
+    MacTable()
+  {
+    *this = rhs;
+  }
+
+  MacTable & operator=(const MacTable & rhs)
+  {
+    if(this == &rhs)
+      return *this;
+    clear();
+    reserve(rhs.size_);
+    for(auto & i : rhs)
+      (*this)[i.first] = i.second;
+    return *this;
+  }
+
+  ~MacTable()
+  {
+    Release();
+  }
+
+  iterator begin()
+  {
+    return iterator(this, 0);
+  }
+  iterator end()
+  {
+    return iterator(this, capacity_);
+  }
+  const_iterator begin() const
+  {
+    return const_iterator(this, 0);
+  }
+  const_iterator end() const
+  {
+    return const_iterator(this, capacity_);
+  }
+  size_t size() const
+  {
+    return size_;
+  }
+  bool empty() const
+  {
+    return size_ == 0;
+  }
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+  //Bytes allocated for the control bytes, keys and slots
+  size_t MemoryUsage() const
+  {
+    return capacity_ == 0 ? 0 :
+      capacity_ * (sizeof(int8_t) + sizeof(uint64_t) + sizeof(Slot));
+  }
+
+  iterator find(
+    const MacAddressType & mac)
+  {
+    return iterator(this, Find(mac));
+  }
+
+  const_iterator find(
+    const MacAddressType & mac) const
+  {
+    return const_iterator(this, Find(mac));
+  }
+
+  size_t count(
+    const MacAddressType & mac) const
+  {
+    return Find(mac) == capacity_ ? 0 : 1;
+  }
+
+  ValueType & at(
+    const MacAddressType & mac)
+  {
+    size_t i = Find(mac);
+    if(i == capacity_)
+      throw out_of_range("The MAC address is not in the table");
+    return slots_[i].second;
+  }
+
+  //Returns the value for the MAC, default constructing it if not present
+  ValueType & operator[](
+    const MacAddressType & mac)
+  {
+    uint64_t key = Pack(mac);
+    uint64_t h = Hash(key);
+    size_t i = Find(key, h);
+    if(i != capacity_)
+      return slots_[i].second;
+    if(growth_left_ == 0)
+      Grow();
+    i = FindFree(h);
+    if(ctrl_[i] == kEmpty)
+      growth_left_--;
+    ctrl_[i] = H2(h);
+    keys_[i] = key;
+    new(&slots_[i]) Slot(mac, ValueType());
+    size_++;
+    return slots_[i].second;
+  }
+
+  void erase(
+    iterator itr)
+  {
+    size_t i = itr.index_;
+    slots_[i].~Slot();
+    ctrl_[i] = kDeleted;
+    size_--;
+  }
+
+  size_t erase(
+    const MacAddressType & mac)
+  {
+    size_t i = Find(mac);
+    if(i == capacity_)
+      return 0;
+    erase(iterator(this, i));
+    return 1;
+  }
+
+  void clear()
+  {
+    for(size_t i = 0; i < capacity_; i++)
+    {
+      if(ctrl_[i] >= 0)
+        slots_[i].~Slot();
+    }
+    if(capacity_)
+      memset(ctrl_, kEmpty, capacity_);
+    size_ = 0;
+    growth_left_ = MaxLoad(capacity_);
+  }
+
+  //Sizes the table to hold count entries without rehashing
+  void reserve(
+    size_t count)
+  {
+    size_t cap = capacity_ ? capacity_ : kGroupWidth;
+    while(MaxLoad(cap) < count)
+      cap *= 2;
+    if(cap != capacity_)
+      Rehash(cap);
+  }
+
+  void swap(
+    MacTable & rhs)
+  {
+    std::swap(ctrl_, rhs.ctrl_);
+    std::swap(keys_, rhs.keys_);
+    std::swap(slots_, rhs.slots_);
+    std::swap(capacity_, rhs.capacity_);
+    std::swap(size_, rhs.size_);
+    std::swap(growth_left_, rhs.growth_left_);
+  }
+
+private:
+  static uint64_t Pack(
+    const MacAddressType & mac)
+  {
+    uint64_t key = 0;
+    memcpy(&key, mac.data(), mac.size());
+    return key;
+  }
+  //The OUI makes the leading bytes of local MACs alike, so the packed key is
+  //mixed before it is split into the group index and the tag
+  static uint64_t Hash(
+    uint64_t key)
+  {
+    key *= 0x9E3779B97F4A7C15ull;
+    key ^= key >> 32;
+    key *= 0xD6E8FEB86659FD93ull;
+    key ^= key >> 29;
+    return key;
+  }
+  static size_t H1(
+    uint64_t h)
+  {
+    return (size_t)(h >> 7);
+  }
+  static int8_t H2(
+    uint64_t h)
+  {
+    return (int8_t)(h & 0x7F);
+  }
+  static size_t MaxLoad(
+    size_t capacity)
+  {
+    return capacity - capacity / 8;
+  }
+  static uint32_t LowestBit(
+    uint32_t mask)
+  {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (uint32_t)idx;
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+  }
+  //Bit i of the result is set if control byte i of the group equals tag
+  static uint32_t Match(
+    const int8_t * group,
+    int8_t tag)
+  {
+#if defined(TINCAN_MAC_TABLE_SSE2)
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < kGroupWidth; i++)
+      mask |= (uint32_t)(group[i] == tag) << i;
+    return mask;
+#endif
+  }
+  //Bit i of the result is set if slot i of the group is empty or deleted
+  static uint32_t MatchFree(
+    const int8_t * group)
+  {
+#if defined(TINCAN_MAC_TABLE_SSE2)
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(ctrl);
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < kGroupWidth; i++)
+      mask |= (uint32_t)(group[i] < 0) << i;
+    return mask;
+#endif
+  }
+
+  size_t Find(
+    const MacAddressType & mac) const
+  {
+    uint64_t key = Pack(mac);
+    return Find(key, Hash(key));
+  }
+
+  //Returns the slot holding the key or capacity_ if it is not present. Groups
+  //are visited in triangular order, which covers all of them as the number of
+  //groups is a power of two, and the search stops at the first group that has
+  //never been full.
+  size_t Find(
+    uint64_t key,
+    uint64_t h) const
+  {
+    if(size_ == 0)
+      return capacity_;
+    const size_t gmask = capacity_ / kGroupWidth - 1;
+    size_t g = H1(h) & gmask;
+    for(size_t step = 1; ; step++)
+    {
+      const int8_t * group = ctrl_ + g * kGroupWidth;
+      for(uint32_t m = Match(group, H2(h)); m != 0; m &= m - 1)
+      {
+        size_t i = g * kGroupWidth + LowestBit(m);
+        if(keys_[i] == key)
+          return i;
+      }
+      if(Match(group, kEmpty) != 0 || step > gmask)
+        return capacity_;
+      g = (g + step) & gmask;
+    }
+  }
+
+  size_t FindFree(
+    uint64_t h) const
+  {
+    const size_t gmask = capacity_ / kGroupWidth - 1;
+    size_t g = H1(h) & gmask;
+    for(size_t step = 1; ; step++)
+    {
+      uint32_t m = MatchFree(ctrl_ + g * kGroupWidth);
+      if(m != 0)
+        return g * kGroupWidth + LowestBit(m);
+      g = (g + step) & gmask;
+    }
+  }
+
+  //Doubles the table, or only clears out the tombstones when they are what
+  //exhausted it
+  void Grow()
+  {
+    if(capacity_ == 0)
+      Rehash(kGroupWidth);
+    else if(size_ <= MaxLoad(capacity_) / 2)
+      Rehash(capacity_);
+    else
+      Rehash(capacity_ * 2);
+  }
+
+  void Rehash(
+    size_t new_capacity)
+  {
+    int8_t * old_ctrl = ctrl_;
+    uint64_t * old_keys = keys_;
+    Slot * old_slots = slots_;
+    size_t old_capacity = capacity_;
+    ctrl_ = new int8_t[new_capacity];
+    memset(ctrl_, kEmpty, new_capacity);
+    keys_ = new uint64_t[new_capacity];
+    slots_ = std::allocator<Slot>().allocate(new_capacity);
+    capacity_ = new_capacity;
+    growth_left_ = MaxLoad(new_capacity) - size_;
+    for(size_t i = 0; i < old_capacity; i++)
+    {
+      if(old_ctrl[i] < 0)
+        continue;
+      uint64_t h = Hash(old_keys[i]);
+      size_t j = FindFree(h);
+      ctrl_[j] = H2(h);
+      keys_[j] = old_keys[i];
+      new(&slots_[j]) Slot(std::move(old_slots[i]));
+      old_slots[i].~Slot();
+    }
+    delete[] old_ctrl;
+    delete[] old_keys;
+    if(old_slots)
+      std::allocator<Slot>().deallocate(old_slots, old_capacity);
+  }
+
+  void Release()
+  {
+    clear();
+    delete[] ctrl_;
+    delete[] keys_;
+    if(slots_)
+      std::allocator<Slot>().deallocate(slots_, capacity_);
+    ctrl_ = nullptr;
+    keys_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = 0;
+    growth_left_ = 0;
+  }
+
+  int8_t * ctrl_;
+  uint64_t * keys_;
+  Slot * slots_;
+  size_t capacity_;
+  size_t size_;
+  size_t growth_left_;
+};
+} // namespace tincan
+#endif // TINCAN_MAC_TABLE_H_
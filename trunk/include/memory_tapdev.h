@@ -0,0 +1,94 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_MEMORY_TAPDEV_H_
+#define TINCAN_MEMORY_TAPDEV_H_
+#include "tincan_base.h"
+#include <deque>
+#include <mutex>
+#include "async_io.h"
+#include "tapdev_inf.h"
+#include "webrtc/base/sigslot.h"
+#include "webrtc/base/thread.h"
+
+namespace tincan
+{
+/*
+A TAP device backed by memory rather than the kernel, for driving the data
+path of a tunnel without privileges. Frames injected by the host side are
+returned by the tunnel's reads, and frames the tunnel writes are raised with
+SignalFrameWritten. As with the platform devices the completions are raised on
+the device's reader and writer threads, which run while the device is up.
+Injected frames are queued while no read is pending and dropped once the queue
+is full, as a TAP's transmit queue does.
+*/
+class MemoryTapDev :
+  public TapDevInf,
+  public MessageHandler
+{
+public:
+  MemoryTapDev();
+  ~MemoryTapDev() override;
+  void Open(
+    const TapDescriptor & tap_desc) override;
+  void Close() override;
+  uint32_t Read(AsyncIo & aio_rd) override;
+  uint32_t Write(AsyncIo & aio_wr) override;
+  uint16_t Mtu() override;
+  void Up() override;
+  void Down() override;
+  MacAddressType MacAddress() override;
+  IP4AddressType Ip4() override;
+  //Queues an ethernet frame for the tunnel to read, returns false if the
+  //frame was dropped because the device is down or its queue is full
+  bool Inject(
+    const uint8_t * frame,
+    uint32_t len);
+  uint64_t Dropped() const
+  {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+  //Raised on the writer thread with each ethernet frame written by the tunnel
+  sigslot::signal2<const uint8_t *, uint32_t> SignalFrameWritten;
+
+  static const size_t kMaxQueued = 4096;
+protected:
+  void OnMessage(Message * msg) override;
+private:
+  void CompleteRead(
+    AsyncIo & aio_rd,
+    const uint8_t * frame,
+    uint32_t len);
+  unique_ptr<rtc::Thread> reader_;
+  unique_ptr<rtc::Thread> writer_;
+  //guards the device state and both queues
+  mutex io_mtx_;
+  bool is_good_;
+  std::deque<vector<uint8_t>> rx_queue_;
+  std::deque<AsyncIo *> pending_reads_;
+  std::atomic<uint64_t> dropped_;
+  MacAddressType mac_;
+  IP4AddressType ip4_;
+  uint16_t mtu_;
+};
+}  // namespace tincan
+#endif  // TINCAN_MEMORY_TAPDEV_H_
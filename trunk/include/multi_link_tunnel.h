@@ -23,7 +23,12 @@
 #ifndef TINCAN_VIRTUAL_NETWORK_H_
 #define TINCAN_VIRTUAL_NETWORK_H_
 #include "tincan_base.h"
+#include "arp_cache.h"
 #include "basic_tunnel.h"
+#include "broadcast_tree.h"
+#include "frame_replicator.h"
+#include "ip4_route_table.h"
+#include "pending_route_queue.h"
 namespace tincan
 {
 class MultiLinkTunnel :
@@ -33,10 +38,14 @@ public:
   //ctor
    MultiLinkTunnel(
      unique_ptr<TunnelDescriptor> descriptor,
-     IpopControllerLink * ctrl_handle);
+     IpopControllerLink * ctrl_handle,
+     unique_ptr<TapDevInf> tdev = nullptr);
 
   ~MultiLinkTunnel();
 
+  void ConfigureReplication(
+    const Json::Value & rp_descr) override;
+
   shared_ptr<VirtualLink> CreateVlink(
     unique_ptr<VlinkDescriptor> vlink_desc,
     unique_ptr<PeerDescriptor> peer_desc) override;
@@ -67,7 +76,15 @@ public:
     const string & vlink_id) override;
 
   void UpdateRouteTable(
-    const Json::Value & rt_descr) override;
+    const Json::Value & rt_descr,
+    Json::Value & rt_info) override;
+
+  void UpdateIp4RouteTable(
+    const Json::Value & rt_descr,
+    Json::Value & rt_info) override;
+
+  void UpdateBroadcastTree(
+    const Json::Value & bct_descr) override;
   //
   //FrameHandler implementation
   void VlinkReadComplete(
@@ -81,9 +98,61 @@ public:
   void TapWriteComplete(
     AsyncIo * aio_wr) override;
   //
+protected:
+  void VLinkUp(
+    string vlink_id) override;
+  void QueryVlinks(
+    vector<shared_ptr<VirtualLink>> & vlinks) override;
+  void QueueStats(
+    uint64_t & pending,
+    uint64_t & dropped) override;
 private:
+  //Buffers the frame and requests a route from the controller when needed
+  void RequestRoute(
+    const MacAddressType & dest,
+    unique_ptr<TapFrame> frame);
+  //Sends the pending frames whose destinations have become reachable
+  void FlushPendingRoutes();
+  void PeerNetworkTick(
+    uint32_t now);
+  //Answers an ARP request from the local stack if the target is a known peer
+  bool ProxyArp(
+    TapFrame & frame);
+  //Records the sender binding of an ARP packet received over a vlink
+  void LearnArp(
+    TapFrame & frame);
+  //Copies a group addressed frame to the adjacent peers selected for it
+  void ReplicateFrame(
+    TapFrame * frame);
+  //Sends a group addressed frame from the TAP along the broadcast tree
+  void BroadcastFrame(
+    TapFrame * frame);
+  //Ready vlinks to the broadcast tree neighbors, other than the ingress vlink
+  void TreeVlinks(
+    const VirtualLink * ingress,
+    vector<shared_ptr<VirtualLink>> & vlinks);
+  //Learns the location of the frame's source from the vlink it arrived on,
+  //releasing any frames that were waiting for a route to it
+  void LearnSource(
+    TapFrame & frame,
+    VirtualLink & vlink,
+    bool bridged);
+  //Forwarding decision for an IPv4 destination in a subnet behind a peer
+  ForwardingDecision LookupIp4(
+    const IP4AddressType & ip4);
   unique_ptr<PeerNetwork> peer_network_;
-  rtc::Thread peer_net_thread_;
+  //Frames to destinations that the controller has been asked to resolve
+  PendingRouteQueue pending_routes_;
+  ArpCache arp_cache_;
+  Ip4RouteTable ip4_routes_;
+  FrameReplicator replicator_;
+  BroadcastTree bcast_tree_;
+  //Forwarding decisions for frames read from the TAP, TAP read thread only
+  FlowCache tap_flow_cache_;
+  //Forwarding decisions for FWD frames from vlinks, network thread only
+  FlowCache vlink_flow_cache_;
+  //Sources learned from frames off the vlinks, network thread only
+  LearnCache learn_cache_;
 };
 }  // namespace tincan
 #endif  // TINCAN_VIRTUAL_NETWORK_H_
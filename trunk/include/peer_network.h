@@ -23,68 +23,306 @@
 #if !defined(_TINCAN_PEER_NETWORK_H_)
 #define _TINCAN_PEER_NETWORK_H_
 #include "tincan_base.h"
+#include "mac_table.h"
+#include "timing_wheel.h"
 #include "virtual_link.h"
-#include <sparsepp/spp.h>
-
-using spp::sparse_hash_map;
 
 namespace tincan
 {
+enum FWD_TYPE
+{
+  FWD_UNKNOWN,
+  FWD_ADJACENT,
+  FWD_ROUTED,
+  //a device bridged to the TAP of an adjacent peer, reached with DTF frames
+  FWD_BRIDGED,
+};
+//The concurrent vlinks to one adjacent peer. Groups are immutable once
+//published, a change of paths replaces the group.
+using VlinkGroup = vector<shared_ptr<VirtualLink>>;
+/*
+The result of a single probe of the forwarding table. It identifies how the
+destination is reached, the vlinks to transmit on and the tincan header the
+frame must carry. The vlink is the preferred path of the group and is used
+where a frame is not associated with a flow.
+*/
+struct ForwardingDecision
+{
+  ForwardingDecision() : type(FWD_UNKNOWN), header(0)
+  {}
+  //Picks the vlink for a flow. Flows are spread over the ready vlinks of the
+  //group and move to the next ready vlink when their own one is not writable.
+  shared_ptr<VirtualLink> SelectVlink(
+    uint32_t flow_hash) const;
+  FWD_TYPE type;
+  shared_ptr<VirtualLink> vlink;
+  shared_ptr<const VlinkGroup> vlinks;
+  uint16_t header;
+};
+
+struct RouteUpdate
+{
+  RouteUpdate() : remove(false)
+  {}
+  MacAddressType dest;
+  MacAddressType path;
+  bool remove;
+};
+
+struct RouteUpdateStats
+{
+  RouteUpdateStats() : added(0), removed(0), rejected(0), routes(0)
+  {}
+  uint32_t added;
+  uint32_t removed;
+  uint32_t rejected;
+  uint32_t routes;
+  std::chrono::microseconds build_time;
+  std::chrono::microseconds swap_time;
+};
+
+/*
+A small direct mapped cache of forwarding decisions. Each instance must only be
+used by a single data path thread. Entries are tagged with the generation of
+the PeerNetwork they were resolved from and become stale as soon as the peer
+network is modified. The vlinks are only weakly referenced, so a slot that is
+never probed again does not keep a removed vlink alive.
+*/
+class FlowCache
+{
+public:
+  FlowCache();
+  bool Find(
+    const MacAddressType & mac,
+    uint32_t generation,
+    ForwardingDecision & fd);
+  void Insert(
+    const MacAddressType & mac,
+    uint32_t generation,
+    const ForwardingDecision & fd);
+  uint64_t Hits() const
+  {
+    return hits_.load(std::memory_order_relaxed);
+  }
+  uint64_t Misses() const
+  {
+    return misses_.load(std::memory_order_relaxed);
+  }
+private:
+  static const uint32_t kSlotBits = 8;
+  struct Slot
+  {
+    Slot() : generation(0), type(FWD_UNKNOWN), header(0)
+    {}
+    MacAddressType mac;
+    uint32_t generation;
+    FWD_TYPE type;
+    uint16_t header;
+    weak_ptr<VirtualLink> vlink;
+    weak_ptr<const VlinkGroup> vlinks;
+  };
+  static uint32_t SlotIndex(const MacAddressType & mac);
+  array<Slot, 1 << kSlotBits> slots_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+};
+
+/*
+Remembers the source MACs recently learned from one data path thread, so the
+forwarding table is consulted at most once per source, ingress vlink and tick
+while the peer network is unchanged.
+*/
+class LearnCache
+{
+public:
+  //Returns true if the same observation was already made, otherwise records it
+  bool Seen(
+    const MacAddressType & src,
+    const VirtualLink * ingress,
+    uint32_t generation,
+    uint32_t tick);
+private:
+  static const uint32_t kSlotBits = 8;
+  struct Slot
+  {
+    Slot() : ingress(nullptr), generation(0), tick(0)
+    {}
+    MacAddressType mac;
+    const VirtualLink * ingress;
+    uint32_t generation;
+    uint32_t tick;
+  };
+  array<Slot, 1 << kSlotBits> slots_;
+};
+
 class PeerNetwork :
-  public Runnable
+  public MessageHandler
 {
 public:
   PeerNetwork();
   ~PeerNetwork();
   void Add(shared_ptr<VirtualLink> vlink);
   void Clear();
-  shared_ptr<VirtualLink> GetRoute(const MacAddressType & mac);
+  //Current value of the coarse clock, in ticks since the peer net started
+  uint32_t Now() const
+  {
+    return tick_.load(std::memory_order_relaxed);
+  }
   shared_ptr<VirtualLink> GetVlink(const string & mac);
   shared_ptr<VirtualLink> GetVlink(const MacAddressType & mac);
   shared_ptr<VirtualLink> GetVlinkById(const string & link_id);
   bool Exists(const string & link_id);
   bool IsAdjacent(const string & mac);
   bool IsAdjacent(const MacAddressType& mac);
-  bool IsRouteExists(const MacAddressType& mac);
+  ForwardingDecision Lookup(const MacAddressType& mac);
+  ForwardingDecision Lookup(const MacAddressType& mac, FlowCache & cache);
+  //Learns that the source MAC is reached through the peer of the ingress
+  //vlink, bridged to its TAP or routed beyond it. Returns true if the
+  //forwarding table changed.
+  bool Learn(
+    const MacAddressType & src,
+    VirtualLink & ingress,
+    bool bridged,
+    LearnCache & cache);
+  uint32_t LearnedCount() const
+  {
+    return learned_count_.load(std::memory_order_relaxed);
+  }
   vector<string> QueryVlinks();
+  void QueryVlinks(
+    vector<shared_ptr<VirtualLink>> & vlinks);
+  //Appends one vlink for each adjacent peer, a ready one where possible
+  void AdjacentVlinks(
+    vector<shared_ptr<VirtualLink>> & vlinks);
   void Remove(const string & link_id);
-  void UpdateRouteTable(MacAddressType & dest, MacAddressType & route);
+  RouteUpdateStats UpdateRouteTable(
+    const vector<RouteUpdate> & updates,
+    bool replace);
+  //Starts the coarse clock, its ticks are serviced on the specified thread
+  void Start(Thread * timer_thread);
+  void Stop();
+  //
+  //MessageHandler overrides
+  void OnMessage(Message * msg) override;
+  //Raised on the timer thread after each tick has been serviced
+  sigslot::signal1<uint32_t> SignalTick;
+
+  static const uint32_t kTickInterval = 1000; //ms
+  static const uint32_t kRouteExpiry = 360;   //ticks
+  static const uint32_t kCacheRefresh = 60;   //ticks
+  static const uint32_t kLearnedExpiry = 300; //ticks
+  static const uint32_t kMaxLearned = 4096;
+  static const uint32_t kTimerBatch = 1024;
 private:
-  struct MacAddressHasher
+  enum MSG_ID
   {
-    size_t operator()(const MacAddressType& mac) const
-    {
-      size_t h = 0;
-      for(auto e : mac)
-      {
-        h ^= hash<uint8_t>{}(e)+0x9e3779b9 + (h << 6) + (h >> 2);
-      }
-      return h;
-    }
+    MSGID_TICK,
   };
-  struct Width6t8
+  //An adjacent peer or a route through one, keyed by the destination MAC
+  struct FwdEntry
   {
-    size_t operator()(const MacAddressType& mac) const
+    FwdEntry() :
+      type(FWD_UNKNOWN), path{ 0 }, accessed(0), expired(false), timer_id(0)
+    {}
+    FwdEntry(const FwdEntry & rhs) :
+      type(rhs.type),
+      vlinks(rhs.vlinks),
+      path(rhs.path),
+      accessed(rhs.accessed.load(std::memory_order_relaxed)),
+      expired(rhs.expired.load(std::memory_order_relaxed)),
+      timer_id(rhs.timer_id)
+    {}
+    FwdEntry & operator=(const FwdEntry & rhs)
     {
-      size_t h = 0;
-      memcpy(&h, mac.data(), 6);
-      return h;
+      type = rhs.type;
+      vlinks = rhs.vlinks;
+      path = rhs.path;
+      accessed.store(rhs.accessed.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+      expired.store(rhs.expired.load(std::memory_order_relaxed),
+        std::memory_order_relaxed);
+      timer_id = rhs.timer_id;
+      return *this;
     }
+    FWD_TYPE type;
+    //the vlinks of the adjacent peer, shared by the routes through it and
+    //empty once the peer is no longer adjacent
+    shared_ptr<const VlinkGroup> vlinks;
+    //the adjacent peer of a route
+    MacAddressType path;
+    //tick of the last lookup, refreshed by the data path without the lock
+    mutable std::atomic<uint32_t> accessed;
+    //set when a route in a published table expires, the entry is dropped
+    //when the next table is built
+    mutable std::atomic<bool> expired;
+    //identifies the route's current timer in the expiry wheel
+    uint32_t timer_id;
   };
-  struct HubEx
+  //A pending route expiry, the timer id discards it if the route was replaced
+  struct RouteTimer
   {
-    HubEx() : accessed(steady_clock::now())
-    {}
-    shared_ptr<VirtualLink> vl;
-    steady_clock::time_point accessed;
+    MacAddressType mac;
+    uint32_t timer_id;
   };
+  using FwdTable = MacTable<FwdEntry>;
+  //Serializes the building of new forwarding tables and is held for the whole
+  //build. Neither the data path nor the timer ever take it. Acquired before
+  //update_mtx_, which is only held briefly and is acquired before
+  //mac_map_mtx_, the lock of the state in use by the data path.
+  mutex rebuild_mtx_;
+  mutex update_mtx_;
   mutex mac_map_mtx_;
+  //bumped on every modification, invalidates the flow caches
+  std::atomic<uint32_t> generation_;
   unordered_map<string, shared_ptr<VirtualLink>> link_map_;
-  //unordered_map<MacAddressType, shared_ptr<VirtualLink>, MacAddressHasher> mac_map_;
-  sparse_hash_map<MacAddressType, shared_ptr<VirtualLink>, MacAddressHasher>mac_map_;
-  unordered_map<MacAddressType, HubEx, MacAddressHasher> mac_routes_;
-  void Run(Thread* thread) override;
-  milliseconds const scavenge_interval;
+  //The adjacent peers and the installed routes. A published table is never
+  //modified apart from the access times and expiry marks of its entries,
+  //changes are made to a copy that is then swapped in, so the data path never
+  //waits on a copy.
+  shared_ptr<const FwdTable> fwd_table_;
+  //The MACs learned from the data path, few and modified in place
+  FwdTable learned_;
+  std::atomic<uint32_t> tick_;
+  std::atomic<uint32_t> learned_count_;
+  //installed route expiries, guarded by update_mtx_
+  TimingWheel<RouteTimer> route_timers_;
+  //learned MAC expiries, guarded by mac_map_mtx_
+  TimingWheel<RouteTimer> learned_timers_;
+  std::atomic<uint32_t> next_timer_id_;
+  //Set while a new table is being built. The routes that expire in the
+  //meantime are recorded so they are also dropped from the new table. Both
+  //are guarded by update_mtx_.
+  bool building_;
+  vector<RouteTimer> build_expiries_;
+  Thread * timer_thread_;
+  void ExpireRoutes(uint32_t now);
+  //Runs with rebuild_mtx_ held. Returns the published table to build the
+  //new one from and starts recording expiries.
+  shared_ptr<const FwdTable> BeginBuild();
+  //Runs with rebuild_mtx_ and update_mtx_ held. Drops the routes that expired
+  //during the build from the new table and stops recording expiries.
+  void EndBuild(
+    FwdTable & table);
+  //A copy of the published table without its expired routes, and with only
+  //the adjacent peers if adjacent_only is set
+  static shared_ptr<FwdTable> CopyTable(
+    const FwdTable & table,
+    bool adjacent_only);
+  //Publishes the new vlink group of an adjacent peer to its entry and to all
+  //the routes through it, removing the entry if the group is empty.
+  static void UpdatePaths(
+    FwdTable & table,
+    const MacAddressType & mac,
+    shared_ptr<const VlinkGroup> vlinks);
+  //Runs with mac_map_mtx_ held, the learned MACs' counterpart of UpdatePaths
+  void UpdateLearnedPaths(
+    const MacAddressType & mac,
+    shared_ptr<const VlinkGroup> vlinks);
+  //Runs with update_mtx_ and mac_map_mtx_ held. Swaps in the new table and
+  //drops the learned MACs it now has an entry for, the old table is returned
+  //in table.
+  void Publish(
+    shared_ptr<const FwdTable> & table);
 };
 
 } // namespace tincan
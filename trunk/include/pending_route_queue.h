@@ -0,0 +1,93 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_PENDING_ROUTE_QUEUE_H_
+#define TINCAN_PENDING_ROUTE_QUEUE_H_
+#include "tincan_base.h"
+#include "tap_frame.h"
+#include <functional>
+namespace tincan
+{
+struct PendingRouteStats
+{
+  uint64_t requests;
+  uint64_t suppressed;
+  uint64_t buffered;
+  uint64_t flushed;
+  uint64_t dropped;
+  uint32_t pending;
+};
+/*
+Holds frames addressed to MACs that have no route while the controller is
+asked to resolve them. Only the first few frames to a MAC are kept and a single
+route request is made for it per request interval. A MAC that remains
+unresolved past the timeout is negatively cached, its frames are discarded and
+no further requests are made for it until the negative entry ages out. Time is
+measured in ticks of the peer network's coarse clock.
+*/
+class PendingRouteQueue
+{
+public:
+  PendingRouteQueue();
+  ~PendingRouteQueue() = default;
+  //Takes ownership of a frame to an unresolved destination. Returns true when
+  //a route request should be sent to the controller for the destination, the
+  //hex encoded frame to accompany the request is then returned in data.
+  bool Enqueue(
+    const MacAddressType & dest,
+    unique_ptr<TapFrame> frame,
+    uint32_t now,
+    string & data);
+  //Removes the frames queued to each destination the predicate reports as
+  //resolved and appends them, in arrival order, to frames.
+  void Release(
+    const std::function<bool(const MacAddressType &)> & resolved,
+    vector<unique_ptr<TapFrame>> & frames);
+  //Times out unanswered requests and ages out the negative entries
+  void Expire(
+    uint32_t now);
+  void Clear();
+  PendingRouteStats Stats();
+
+  static const uint32_t kMaxFrames = 4;
+  static const uint32_t kMaxPending = 128;
+  static const uint32_t kRequestInterval = 2; //ticks
+  static const uint32_t kResolveTimeout = 6;  //ticks
+  static const uint32_t kNegativeTtl = 10;    //ticks
+private:
+  struct PendingRoute
+  {
+    PendingRoute() : requested(0), expiry(0), negative(false)
+    {}
+    vector<unique_ptr<TapFrame>> frames;
+    //tick of the last route request
+    uint32_t requested;
+    //tick when the request times out, or the negative entry is removed
+    uint32_t expiry;
+    bool negative;
+  };
+  mutex mtx_;
+  map<MacAddressType, PendingRoute> pending_;
+  PendingRouteStats stats_;
+};
+} // namespace tincan
+#endif // TINCAN_PENDING_ROUTE_QUEUE_H_
@@ -33,9 +33,13 @@ class SingleLinkTunnel :
 public:
   SingleLinkTunnel(
     unique_ptr<TunnelDescriptor> descriptor,
-    IpopControllerLink * ctrl_handle);
+    IpopControllerLink * ctrl_handle,
+    unique_ptr<TapDevInf> tdev = nullptr);
   virtual ~SingleLinkTunnel() = default;
 
+  void ConfigureReplication(
+    const Json::Value & rp_descr) override;
+
   shared_ptr<VirtualLink> CreateVlink(
     unique_ptr<VlinkDescriptor> vlink_desc,
     unique_ptr<PeerDescriptor> peer_desc) override;
@@ -70,7 +74,15 @@ public:
     const string & vlink_id) override;
 
   void UpdateRouteTable(
-    const Json::Value & rt_descr) override;
+    const Json::Value & rt_descr,
+    Json::Value & rt_info) override;
+
+  void UpdateIp4RouteTable(
+    const Json::Value & rt_descr,
+    Json::Value & rt_info) override;
+
+  void UpdateBroadcastTree(
+    const Json::Value & bct_descr) override;
 
   //
   //FrameHandler implementation
@@ -85,6 +97,9 @@ public:
   void TapWriteComplete(
     AsyncIo * aio_wr) override;
 
+protected:
+  void QueryVlinks(
+    vector<shared_ptr<VirtualLink>> & vlinks) override;
 private:
   shared_ptr<VirtualLink> vlink_;
 };
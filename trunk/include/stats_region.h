@@ -0,0 +1,376 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_STATS_REGION_H_
+#define TINCAN_STATS_REGION_H_
+#if !defined(_IPOP_WIN)
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+/*
+Layout of the shared memory stats region, version 1.
+
+Tincan creates the region as a file, sized once at startup, and maps it shared.
+Readers map the same file read only and never need to send a control. All
+fields are in host byte order.
+
+  offset 0             StatsRegionHeader, header_size bytes
+  header_size          tunnel_slots TunnelStatsSlots of tunnel_slot_size bytes
+  after tunnel slots   link_slots LinkStatsSlots of link_slot_size bytes
+
+Every slot has a single writer, the network thread of the tunnel that owns it,
+and is guarded by its seq counter. The writer makes seq odd, updates the slot
+and makes seq even again. A reader copies the slot between two loads of seq
+and retries if seq was odd or has changed. A slot with in_use of 0 is free and
+its contents are meaningless. Counters are totals since the slot was taken,
+gauges are the value at the last publish and updated_ms is the time of that
+publish, CLOCK_MONOTONIC in milliseconds. Readers must check magic and
+version, and step through the slots by the sizes in the header as later
+versions only append to the slots.
+*/
+namespace tincan
+{
+enum TUNNEL_COUNTER
+{
+  TC_TAP_FRAMES_IN,     //frames read from the TAP device
+  TC_TAP_BYTES_IN,
+  TC_TAP_FRAMES_OUT,    //frames written to the TAP device
+  TC_TAP_BYTES_OUT,
+  TC_TAP_ERRORS,        //failed TAP writes
+  TC_DROPPED,           //frames discarded unrouted or over a rate limit
+  TC_PENDING_FRAMES,    //gauge, frames buffered awaiting a route
+  TC_NET_QUEUE,         //gauge, messages queued to the network thread
+  TC_UPDATED_MS,
+  TC_COUNT,
+};
+
+enum LINK_COUNTER
+{
+  LC_FRAMES_IN,         //frames received on the vlink
+  LC_BYTES_IN,
+  LC_FRAMES_OUT,        //frames sent on the vlink
+  LC_BYTES_OUT,
+  LC_SEND_FAILURES,
+  LC_RTT,               //gauge, ms on the best connection, refreshed every 1s
+  LC_ONLINE,            //gauge, 1 if the vlink is connected
+  LC_UPDATED_MS,
+  LC_COUNT,
+};
+
+static const uint32_t kStatsRegionMagic = 0x54534349; //"ICST"
+static const uint16_t kStatsRegionVersion = 1;
+static const size_t kStatsIdSize = 64;  //nul terminated, longer ids are cut
+
+struct StatsRegionHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t header_size;
+  uint32_t tunnel_slots;
+  uint32_t tunnel_slot_size;
+  uint32_t link_slots;
+  uint32_t link_slot_size;
+  uint32_t publish_interval; //ms
+  uint32_t pid;
+  uint64_t created_ms;       //wall clock, ms since the epoch
+  uint8_t reserved[24];
+};
+
+struct TunnelStatsSlot
+{
+  std::atomic<uint32_t> seq;
+  std::atomic<uint32_t> in_use;
+  char tunnel_id[kStatsIdSize];
+  std::atomic<uint64_t> values[TC_COUNT];
+};
+
+struct LinkStatsSlot
+{
+  std::atomic<uint32_t> seq;
+  std::atomic<uint32_t> in_use;
+  char tunnel_id[kStatsIdSize];
+  char link_id[kStatsIdSize];
+  std::atomic<uint64_t> values[LC_COUNT];
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == 4 &&
+  sizeof(std::atomic<uint64_t>) == 8, "Atomics must be plain integers");
+static_assert(sizeof(StatsRegionHeader) == 64, "Header layout changed");
+static_assert(sizeof(TunnelStatsSlot) == 144, "Tunnel slot layout changed");
+static_assert(sizeof(LinkStatsSlot) == 200, "Link slot layout changed");
+
+//A consistent copy of a slot taken by a reader
+struct TunnelStatsView
+{
+  std::string tunnel_id;
+  uint64_t values[TC_COUNT];
+};
+
+struct LinkStatsView
+{
+  std::string tunnel_id;
+  std::string link_id;
+  uint64_t values[LC_COUNT];
+};
+
+template<typename SlotType>
+void
+BeginSlotWrite(
+  SlotType & slot)
+{
+  slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1,
+    std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+template<typename SlotType>
+void
+EndSlotWrite(
+  SlotType & slot)
+{
+  slot.seq.store(slot.seq.load(std::memory_order_relaxed) + 1,
+    std::memory_order_release);
+}
+
+//Publishes a complete set of values to a slot owned by the calling thread
+template<typename SlotType, size_t N>
+void
+PublishSlot(
+  SlotType & slot,
+  const uint64_t (&values)[N])
+{
+  static_assert(N == sizeof(slot.values) / sizeof(slot.values[0]),
+    "Value count does not match the slot");
+  BeginSlotWrite(slot);
+  for(size_t i = 0; i < N; i++)
+    slot.values[i].store(values[i], std::memory_order_relaxed);
+  EndSlotWrite(slot);
+}
+
+/*
+The writer's side of the region. The tunnels take their slots from here and
+publish to them directly, only taking and releasing a slot is serialized.
+*/
+class StatsRegion
+{
+public:
+  //Creates the region file, replacing any existing file at the path
+  StatsRegion(
+    const std::string & path,
+    uint32_t tunnel_slots = kTunnelSlots,
+    uint32_t link_slots = kLinkSlots);
+  ~StatsRegion();
+  //Returns nullptr when all the slots are taken
+  TunnelStatsSlot * AcquireTunnelSlot(
+    const std::string & tnl_id);
+  LinkStatsSlot * AcquireLinkSlot(
+    const std::string & tnl_id,
+    const std::string & link_id);
+  void Release(
+    TunnelStatsSlot * slot);
+  void Release(
+    LinkStatsSlot * slot);
+
+  static const uint32_t kTunnelSlots = 16;
+  static const uint32_t kLinkSlots = 4096;
+  static const uint32_t kPublishInterval = 100; //ms
+private:
+  TunnelStatsSlot * TunnelSlot(
+    uint32_t index);
+  LinkStatsSlot * LinkSlot(
+    uint32_t index);
+  std::string path_;
+  uint8_t * base_;
+  size_t size_;
+  StatsRegionHeader * hdr_;
+  std::mutex mtx_;
+  std::vector<uint32_t> free_tunnels_;
+  std::vector<uint32_t> free_links_;
+};
+
+/*
+Maps a region read only and takes consistent copies of its slots. Depends only
+on the standard library and POSIX so tools can use it outside of tincan.
+*/
+class StatsRegionReader
+{
+public:
+  StatsRegionReader() : base_(nullptr), size_(0)
+  {}
+  ~StatsRegionReader()
+  {
+    Close();
+  }
+  StatsRegionReader(const StatsRegionReader &) = delete;
+  StatsRegionReader & operator=(const StatsRegionReader &) = delete;
+
+  //Returns false, with a description in err, if the file is not a region of a
+  //supported version
+  bool Open(
+    const std::string & path,
+    std::string & err)
+  {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+      err = std::string("Failed to open ") + path + ": " + strerror(errno);
+      return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StatsRegionHeader))
+    {
+      close(fd);
+      err = "Not a stats region, the file is too small";
+      return false;
+    }
+    void * base = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd,
+      0);
+    close(fd);
+    if(base == MAP_FAILED)
+    {
+      err = std::string("Failed to map the region: ") + strerror(errno);
+      return false;
+    }
+    base_ = (const uint8_t*)base;
+    size_ = (size_t)st.st_size;
+    const StatsRegionHeader & hdr = Header();
+    if(hdr.magic != kStatsRegionMagic)
+      err = "Not a stats region, bad magic";
+    else if(hdr.version != kStatsRegionVersion)
+      err = "Unsupported stats region version " + std::to_string(hdr.version);
+    else if(hdr.header_size < sizeof(StatsRegionHeader) ||
+      hdr.tunnel_slot_size < sizeof(TunnelStatsSlot) ||
+      hdr.link_slot_size < sizeof(LinkStatsSlot) ||
+      size_ < (size_t)hdr.header_size +
+        (size_t)hdr.tunnel_slots * hdr.tunnel_slot_size +
+        (size_t)hdr.link_slots * hdr.link_slot_size)
+      err = "Malformed stats region header";
+    else
+      return true;
+    Close();
+    return false;
+  }
+
+  void Close()
+  {
+    if(base_)
+      munmap((void*)base_, size_);
+    base_ = nullptr;
+    size_ = 0;
+  }
+
+  const StatsRegionHeader & Header() const
+  {
+    return *(const StatsRegionHeader*)base_;
+  }
+
+  uint32_t TunnelSlots() const
+  {
+    return Header().tunnel_slots;
+  }
+
+  uint32_t LinkSlots() const
+  {
+    return Header().link_slots;
+  }
+
+  //Returns false if the slot is free or is being rewritten too often to copy
+  bool ReadTunnel(
+    uint32_t index,
+    TunnelStatsView & view) const
+  {
+    const StatsRegionHeader & hdr = Header();
+    const TunnelStatsSlot & slot = *(const TunnelStatsSlot*)(base_ +
+      hdr.header_size + (size_t)index * hdr.tunnel_slot_size);
+    char tnl_id[kStatsIdSize];
+    for(uint32_t attempt = 0; attempt < kMaxRetries; attempt++)
+    {
+      uint32_t seq = slot.seq.load(std::memory_order_acquire);
+      if(seq & 1)
+        continue;
+      uint32_t in_use = slot.in_use.load(std::memory_order_relaxed);
+      memcpy(tnl_id, slot.tunnel_id, kStatsIdSize);
+      for(size_t i = 0; i < TC_COUNT; i++)
+        view.values[i] = slot.values[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(slot.seq.load(std::memory_order_relaxed) != seq)
+        continue;
+      if(!in_use)
+        return false;
+      tnl_id[kStatsIdSize - 1] = 0;
+      view.tunnel_id = tnl_id;
+      return true;
+    }
+    return false;
+  }
+
+  bool ReadLink(
+    uint32_t index,
+    LinkStatsView & view) const
+  {
+    const StatsRegionHeader & hdr = Header();
+    const LinkStatsSlot & slot = *(const LinkStatsSlot*)(base_ +
+      hdr.header_size + (size_t)hdr.tunnel_slots * hdr.tunnel_slot_size +
+      (size_t)index * hdr.link_slot_size);
+    char tnl_id[kStatsIdSize], link_id[kStatsIdSize];
+    for(uint32_t attempt = 0; attempt < kMaxRetries; attempt++)
+    {
+      uint32_t seq = slot.seq.load(std::memory_order_acquire);
+      if(seq & 1)
+        continue;
+      uint32_t in_use = slot.in_use.load(std::memory_order_relaxed);
+      memcpy(tnl_id, slot.tunnel_id, kStatsIdSize);
+      memcpy(link_id, slot.link_id, kStatsIdSize);
+      for(size_t i = 0; i < LC_COUNT; i++)
+        view.values[i] = slot.values[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(slot.seq.load(std::memory_order_relaxed) != seq)
+        continue;
+      if(!in_use)
+        return false;
+      tnl_id[kStatsIdSize - 1] = 0;
+      link_id[kStatsIdSize - 1] = 0;
+      view.tunnel_id = tnl_id;
+      view.link_id = link_id;
+      return true;
+    }
+    return false;
+  }
+
+  static const uint32_t kMaxRetries = 1000;
+private:
+  const uint8_t * base_;
+  size_t size_;
+};
+} // namespace tincan
+#endif // !_IPOP_WIN
+#endif // TINCAN_STATS_REGION_H_
@@ -27,13 +27,16 @@
 namespace tincan
 {
   extern TincanParameters tp;
+  struct StageLatencies;
 /*
 The TapFrameBuffer (TFB) is the byte container for a tincan frame's data. This
 includes the tincan specific headers as well as the payload data received from
 the TAP device or tincan link. A TFB facilitates
-decoupling of the raw data from the meta-data required to manage it.
+decoupling of the raw data from the meta-data required to manage it. Room is
+left after a full payload for the trailer of frames on the broadcast tree.
 */
-using TapFrameBuffer = array<uint8_t, tp.kTapBufferSize>;
+using TapFrameBuffer =
+  array<uint8_t, tp.kTapBufferSize + tp.kBctTrailerSize>;
 /*
 A TapFrame encapsulates a TapFrameBuffer and defines the control and access
 semantics for that type. A single TapFrame can own and manage multiple TFBs
@@ -104,9 +107,40 @@ public:
   uint32_t PayloadCapacity();
 
   void Dump(const string & label);
+  //When the frame entered the tunnel and when it entered its current stage,
+  //in LatencyClock() nanoseconds. Zero if the frame is not being timed.
+  uint64_t EntryTime() const
+  {
+    return entry_ns_;
+  }
+  uint64_t StageTime() const
+  {
+    return stage_ns_;
+  }
+  void Timestamp(
+    uint64_t entry_ns,
+    uint64_t stage_ns)
+  {
+    entry_ns_ = entry_ns;
+    stage_ns_ = stage_ns;
+  }
+  //The latencies of the vlink a timed frame was received on, the stages of
+  //its TAP write are recorded there as well as for the tunnel
+  const shared_ptr<StageLatencies> & VlinkLatencies() const
+  {
+    return vlink_latencies_;
+  }
+  void VlinkLatencies(
+    shared_ptr<StageLatencies> latencies)
+  {
+    vlink_latencies_ = move(latencies);
+  }
  protected:
    TapFrameBuffer * tfb_;
    uint32_t pl_len_;
+   uint64_t entry_ns_;
+   uint64_t stage_ns_;
+   shared_ptr<StageLatencies> vlink_latencies_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -163,6 +197,11 @@ public:
     uint16_t magic = tp.kDtfMagic;
     return memcmp(tf_.Begin(), &magic, tp.kTapHeaderSize) == 0;
   }
+  bool IsBctMsg() const
+  {
+    uint16_t magic = tp.kBctMagic;
+    return memcmp(tf_.Begin(), &magic, tp.kTapHeaderSize) == 0;
+  }
   bool IsIp4()
   {
     EthOffsets eth = tf_.Payload();
@@ -235,6 +274,42 @@ public:
     return *(MacAddressType *)(eth.SourceMac());
   }
 
+  //Hash of the flow the frame belongs to. It covers the IPv4 addresses,
+  //protocol and the TCP/UDP ports of unfragmented packets, and the MAC
+  //addresses of all other frames.
+  uint32_t FlowHash()
+  {
+    EthOffsets eth = tf_.Payload();
+    uint64_t key[2] = { 0, 0 };
+    if(tf_.PayloadLength() >= tp.kEthHeaderSize + 20U && IsIp4())
+    {
+      uint8_t * ip = eth.Payload();
+      uint32_t ihl = (ip[0] & 0x0F) * 4;
+      memcpy(&key[0], &ip[12], 8);
+      key[1] = ip[9];
+      bool unfragmented = ((ip[6] & 0x3F) | ip[7]) == 0;
+      if((ip[9] == 6 || ip[9] == 17) && unfragmented &&
+        tf_.PayloadLength() >= tp.kEthHeaderSize + ihl + 4)
+      {
+        uint32_t ports;
+        memcpy(&ports, &ip[ihl], 4);
+        key[1] |= (uint64_t)ports << 8;
+      }
+    }
+    else
+    {
+      memcpy(&key[0], eth.DestinationMac(), 6);
+      memcpy(&key[1], eth.SourceMac(), 6);
+    }
+    uint64_t h = key[0] * 0x9E3779B97F4A7C15ull ^ key[1];
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return (uint32_t)h;
+  }
+
 private:
   TapFrame & tf_;
 };
@@ -25,6 +25,7 @@
 #include "tincan_base.h"
 #include "async_io.h"
 #include "tap_frame.h"
+#include "webrtc/base/sigslot.h"
 #include "webrtc/base/thread.h"
 
 namespace tincan
@@ -59,6 +60,9 @@ public:
   };
 
   virtual ~TapDevInf() = default;
+  //Raised on the device's IO threads as each read or write completes
+  sigslot::signal1<AsyncIo *> read_completion_;
+  sigslot::signal1<AsyncIo *> write_completion_;
   virtual void Open(
     const TapDescriptor & tap_desc) = 0;
 
@@ -0,0 +1,139 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_TIMING_WHEEL_H_
+#define TINCAN_TIMING_WHEEL_H_
+#include "tincan_base.h"
+namespace tincan
+{
+/*
+A two level hierarchical timing wheel measured in ticks of a coarse clock. The
+inner wheel has one slot per tick and the outer wheel has one slot per
+revolution of the inner wheel, items further out than the outer wheel can
+represent are parked in its last slot and rescheduled when they cascade.
+Advancing the wheel only visits the slots that have come due, so the cost is
+proportional to the number of expiring items and not to the number scheduled.
+Not thread safe, the owner serializes access.
+*/
+template<typename ItemType, uint32_t kSlotBits = 6>
+class TimingWheel
+{
+public:
+  TimingWheel(uint32_t now = 0) :
+    current_(now),
+    count_(0)
+  {}
+
+  //Schedules the item to be returned by Advance() once the clock reaches
+  //expiry. An expiry that is not in the future fires on the next tick.
+  void Schedule(
+    const ItemType & item,
+    uint32_t expiry)
+  {
+    Place(Timer{ item, expiry });
+    count_++;
+  }
+
+  //Moves the wheel forward to now, appending all items that have come due.
+  void Advance(
+    uint32_t now,
+    vector<ItemType> & expired)
+  {
+    while((int32_t)(now - current_) > 0)
+    {
+      current_++;
+      if((current_ & kMask) == 0)
+        Cascade();
+      vector<Timer> & slot = inner_[current_ & kMask];
+      for(auto & tmr : slot)
+        expired.push_back(tmr.item);
+      count_ -= slot.size();
+      slot.clear();
+    }
+  }
+
+  void Clear()
+  {
+    for(auto & slot : inner_)
+      slot.clear();
+    for(auto & slot : outer_)
+      slot.clear();
+    count_ = 0;
+  }
+
+  uint32_t Now() const
+  {
+    return current_;
+  }
+
+  size_t Size() const
+  {
+    return count_;
+  }
+
+private:
+  static const uint32_t kSlots = 1 << kSlotBits;
+  static const uint32_t kMask = kSlots - 1;
+  struct Timer
+  {
+    ItemType item;
+    uint32_t expiry;
+  };
+
+  void Place(
+    const Timer & tmr)
+  {
+    int32_t delta = (int32_t)(tmr.expiry - current_);
+    if(delta <= 0)
+      inner_[(current_ + 1) & kMask].push_back(tmr);
+    else if((uint32_t)delta < kSlots - (current_ & kMask))
+      inner_[tmr.expiry & kMask].push_back(tmr);
+    else
+    {
+      uint32_t at = tmr.expiry;
+      if((uint32_t)delta >= (kSlots - 1) * kSlots)
+        at = current_ + (kSlots - 1) * kSlots;
+      outer_[(at >> kSlotBits) & kMask].push_back(tmr);
+    }
+  }
+
+  //Redistributes the outer slot for the revolution that is starting
+  void Cascade()
+  {
+    vector<Timer> slot;
+    slot.swap(outer_[(current_ >> kSlotBits) & kMask]);
+    for(auto & tmr : slot)
+    {
+      if((int32_t)(tmr.expiry - current_) <= 0)
+        inner_[current_ & kMask].push_back(tmr);
+      else
+        Place(tmr);
+    }
+  }
+
+  uint32_t current_;
+  size_t count_;
+  array<vector<Timer>, kSlots> inner_;
+  array<vector<Timer>, kSlots> outer_;
+};
+} // namespace tincan
+#endif // TINCAN_TIMING_WHEEL_H_
@@ -26,12 +26,16 @@
 #include "webrtc/base/event.h"
 #include "control_listener.h"
 #include "control_dispatch.h"
+#include "icc_channel.h"
+#include "unix_control_listener.h"
 #include "single_link_tunnel.h"
 #include "multi_link_tunnel.h"
+#include "stats_region.h"
 
 namespace tincan {
 class Tincan :
   public TincanDispatchInterface,
+  public rtc::MessageHandler,
   public sigslot::has_slots<>
 {
 public:
@@ -40,10 +44,17 @@ public:
   //
   //TincanDispatchInterface interface
 
+  void ConfigureReplication(
+    const Json::Value & rp_desc) override;
+
   void CreateVlink(
     const Json::Value & link_desc,
     const TincanControl & control) override;
 
+  void CreateVlinks(
+    const Json::Value & links_desc,
+    const TincanControl & control) override;
+
   void CreateTunnel(
     const Json::Value & tnl_desc,
     Json::Value & tnl_info) override;
@@ -51,6 +62,14 @@ public:
   void InjectFrame(
     const Json::Value & frame_desc) override;
 
+  void InjectFrames(
+    const string & tnl_id,
+    const vector<pair<const uint8_t *, uint32_t>> & frames) override;
+
+  void QueryLatencyStats(
+    const Json::Value & tnl_desc,
+    Json::Value & stats) override;
+
   void QueryLinkStats(
     const Json::Value & link_desc,
     Json::Value & node_info) override;
@@ -65,14 +84,37 @@ public:
   void RemoveVlink(
     const Json::Value & link_desc) override;
 
+  void RemoveVlinks(
+    const Json::Value & links_desc,
+    Json::Value & links_info) override;
+
   void SendIcc(
     const Json::Value & icc_desc) override;
 
+  void SendIcc(
+    const string & tnl_id,
+    const string & link_id,
+    const string & data) override;
+
+  void SubscribeLinkStats(
+    const Json::Value & sub_desc) override;
+
+  void ConfigureLatencyStats(
+    const Json::Value & cfg_desc) override;
+
   void SetIpopControllerLink(
     IpopControllerLink * ctrl_handle) override;
 
   void UpdateRouteTable(
-    const Json::Value & rts_desc) override;
+    const Json::Value & rts_desc,
+    Json::Value & rts_info) override;
+
+  void UpdateIp4RouteTable(
+    const Json::Value & rts_desc,
+    Json::Value & rts_info) override;
+
+  void UpdateBroadcastTree(
+    const Json::Value & bct_desc) override;
 //
 //
   void OnLocalCasUpdated(
@@ -84,11 +126,60 @@ public:
     Json::Value & cas_info);
 
   void Run();
+  //
+  //MessageHandler overrides
+  void OnMessage(
+    Message * msg) override;
+
+  //a CreateLinks control is answered once this has elapsed, with the vlinks
+  //that are still gathering reported as failed
+  static const uint32_t kBatchTimeout = 30000; //ms
 private:
+  enum MSG_ID
+  {
+    MSGID_BATCH_TIMEOUT,
+  };
+  //A CreateLinks control awaiting the candidates of its vlinks
+  struct LinkBatch
+  {
+    unique_ptr<TincanControl> ctrl;
+    uint32_t pending;
+  };
+  struct BatchedLink
+  {
+    shared_ptr<LinkBatch> batch;
+    Json::ArrayIndex index;
+    string tnl_id;
+  };
+  class BatchMsgData : public MessageData
+  {
+  public:
+    shared_ptr<LinkBatch> batch;
+  };
+  //Records the outcome of a vlink of a batch and responds once it is the last
+  //one outstanding. Returns false if the vlink is not part of a batch.
+  bool CompleteBatchedLink(
+    const string & link_id,
+    bool success,
+    const string & data);
+
+  void EndBatch(
+    shared_ptr<LinkBatch> batch);
+  //Fails the selected vlinks of batches that will not see their candidates,
+  //as they were removed or timed out, so their batches are still answered
+  void FailBatchedLinks(
+    const std::function<bool(const string &, const BatchedLink &)> & select,
+    const string & reason);
+
+  static unique_ptr<PeerDescriptor> ParsePeerInfo(
+    const Json::Value & peer_info);
+
   bool IsTunnelExisit(
     const string & tnl_id);
 
-  BasicTunnel & TunnelFromId(
+  //The tunnel remains valid for as long as the reference is held, even if it
+  //is removed concurrently
+  shared_ptr<BasicTunnel> TunnelFromId(
     const string & tnl_id);
 
   void OnStop();
@@ -99,14 +190,23 @@ private:
     DWORD CtrlType);
 #endif // _IPOP_WIN
 
-  vector<unique_ptr<BasicTunnel>> tunnels_;
-  IpopControllerLink * ctrl_link_;
+#if !defined(_IPOP_WIN)
+  unique_ptr<StatsRegion> stats_region_; //must outlive the tunnels
+#endif // !_IPOP_WIN
+  vector<shared_ptr<BasicTunnel>> tunnels_;
+  //set on the listener thread, read by the dispatch workers
+  std::atomic<IpopControllerLink *> ctrl_link_;
   map<string, unique_ptr<TincanControl>> inprogess_controls_;
+  map<string, BatchedLink> batched_links_;
   Thread ctl_thread_;
-  shared_ptr<ControlListener> ctrl_listener_; //must be destroyed before ctl_thread
+  shared_ptr<Runnable> ctrl_listener_; //must be destroyed before ctl_thread
+#if !defined(_IPOP_WIN)
+  Thread icc_thread_;
+  shared_ptr<IccChannel> icc_channel_; //must be destroyed before icc_thread_
+#endif // !_IPOP_WIN
   static Tincan * self_;
   std::mutex tunnels_mutex_;
-  std::mutex inprogess_controls_mutex_;
+  std::mutex inprogess_controls_mutex_; //also guards batched_links_
   rtc::Event exit_event_;
 
 };
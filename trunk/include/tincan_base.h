@@ -29,10 +29,12 @@
 #include <cstdlib>
 #include <cstdint>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <exception>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <list>
 #include <map>
 #include <memory>
@@ -40,9 +42,11 @@
 #include <sstream>
 #include <stack>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <unordered_map>
 #include <vector>
+#include "hex_codec.h"
 namespace tincan
 {
   using MacAddressType = std::array<uint8_t, 6>;
@@ -76,6 +80,7 @@ namespace tincan
   using std::unique_ptr;
   using std::unordered_map;
   using std::vector;
+  using std::weak_ptr;
 
 
   struct TincanParameters
@@ -143,6 +148,35 @@ namespace tincan
             }
           }
         }
+#if !defined(_IPOP_WIN)
+        else if (strncmp(args[i], "-s=", 3) == 0)
+        {
+          kCtrlSocketPath.assign(args[i] + 3);
+          if (kCtrlSocketPath.empty())
+          {
+            kNeedsHelp = true;
+            break;
+          }
+        }
+        else if (strncmp(args[i], "-c=", 3) == 0)
+        {
+          kIccSocketPath.assign(args[i] + 3);
+          if (kIccSocketPath.empty())
+          {
+            kNeedsHelp = true;
+            break;
+          }
+        }
+        else if (strncmp(args[i], "-m=", 3) == 0)
+        {
+          kStatsRegionPath.assign(args[i] + 3);
+          if (kStatsRegionPath.empty())
+          {
+            kNeedsHelp = true;
+            break;
+          }
+        }
+#endif // !_IPOP_WIN
         else if (strncmp(args[i], "-v", 2) == 0)
         {
           kVersionCheck = true;
@@ -158,18 +192,24 @@ namespace tincan
     static const uint16_t kTincanVerMnr = 0;
     static const uint16_t kTincanVerRev = 0;
     static const uint8_t kTincanControlVer = 5;
+    //controls of this version are exchanged in the binary encoding
+    static const uint8_t kTincanControlBinaryVer = 6;
     static const uint8_t kTincanLinkVer = 1;
     static const uint16_t kMaxMtuSize = 1500;
     static const uint16_t kTapHeaderSize = 2;
     static const uint16_t kEthHeaderSize = 14;
     static const uint16_t kEthernetSize = kEthHeaderSize + kMaxMtuSize;
     static const uint16_t kTapBufferSize = kTapHeaderSize + kEthernetSize;
+    //origin MAC and sequence number appended to frames on the broadcast tree
+    static const uint16_t kBctTrailerSize = 10;
     static const uint8_t kFT_DTF = 0x0A;
     static const uint8_t kFT_FWD = 0x0B;
     static const uint8_t kFT_ICC = 0x0C;
+    static const uint8_t kFT_BCT = 0x0D;
     static const uint16_t kDtfMagic = 0x0A01;
     static const uint16_t kFwdMagic = 0x0B01;
     static const uint16_t kIccMagic = 0x0C01;
+    static const uint16_t kBctMagic = 0x0D01;
     static const char kCandidateDelim = ':';
     const char * const kIceUfrag = "_001IPOPICEUFRAG";
     const char * const kIcePwd = "_00000001IPOPICEPASSWORD";
@@ -178,9 +218,67 @@ namespace tincan
     bool kVersionCheck;
     bool kNeedsHelp;
     uint16_t kUdpPort;
+    //controls are received on this unix socket instead of the UDP port
+    string kCtrlSocketPath;
+    //ICC payloads are exchanged with the controller on this unix socket
+    string kIccSocketPath;
+    //the data path counters are published to a shared memory file at this path
+    string kStatsRegionPath;
     uint8_t kLinkConcurrentAIO;
   };
   ///////////////////////////////////////////////////////////////////////////////
+  //Iterators known to address contiguous storage, pointers and those of
+  //vector and string
+  template<typename Iter>
+  struct IsContiguousIterator
+  {
+    using ValueType = typename std::remove_cv<
+      typename std::iterator_traits<Iter>::value_type>::type;
+    static const bool value = std::is_pointer<Iter>::value ||
+      std::is_same<Iter, typename vector<ValueType>::iterator>::value ||
+      std::is_same<Iter, typename vector<ValueType>::const_iterator>::value ||
+      std::is_same<Iter, string::iterator>::value ||
+      std::is_same<Iter, string::const_iterator>::value;
+  };
+
+  template<typename InputIter>
+  void HexEncodeRange(
+    InputIter first,
+    InputIter last,
+    char * dst,
+    bool use_uppercase,
+    std::false_type)
+  {
+    const char * pairs = use_uppercase ? kHexPairsUpper : kHexPairsLower;
+    for(; first != last; first++, dst += 2)
+      memcpy(dst, pairs + 2 * (uint8_t)*first, 2);
+  }
+  template<typename InputIter>
+  void HexEncodeRange(
+    InputIter first,
+    InputIter last,
+    char * dst,
+    bool use_uppercase,
+    std::true_type)
+  {
+    static_assert(sizeof(*first) == 1, "Only byte ranges can be encoded");
+    if(first != last)
+      HexEncode((const uint8_t*)&*first, (size_t)(last - first), dst,
+        use_uppercase);
+  }
+  //Hex digits of the bytes in [first, last) written to dst, through the block
+  //codec when the iterators are contiguous ones and byte by byte otherwise
+  template<typename InputIter>
+  void HexEncodeRange(
+    InputIter first,
+    InputIter last,
+    char * dst,
+    bool use_uppercase)
+  {
+    HexEncodeRange(first, last, dst, use_uppercase,
+      std::integral_constant<bool, IsContiguousIterator<InputIter>::value>());
+  }
+
   template<typename InputIter>
   string ByteArrayToString(
     InputIter first,
@@ -191,43 +289,84 @@ namespace tincan
     bool use_uppercase = true)
   {
     assert(sizeof(*first) == 1);
-    ostringstream oss;
-    oss << std::hex << std::setfill('0');
-    if(use_uppercase)
-      oss << std::uppercase;
-    int i = 0;
+    size_t count = (size_t)std::distance(first, last);
+    if(!use_sep && !line_breaks)
+    {
+      string hex(2 * count, '\0');
+      HexEncodeRange(first, last, &hex[0], use_uppercase);
+      return hex;
+    }
+    const char * pairs = use_uppercase ? kHexPairsUpper : kHexPairsLower;
+    string hex;
+    hex.reserve(3 * count + (line_breaks ? count / line_breaks : 0));
+    uint32_t i = 0;
     while(first != last)
     {
-      oss << std::setw(2) << static_cast<int>(*first++);
+      hex.append(pairs + 2 * (uint8_t)*first++, 2);
       if(use_sep && first != last)
-        oss << sep;
-      if(line_breaks && !(++i % line_breaks)) oss << endl;
+        hex.push_back(sep);
+      if(line_breaks && !(++i % line_breaks))
+        hex.push_back('\n');
     }
-    return oss.str();
+    return hex;
   }
-  //Fixme: Doesn't handle line breaks
+
+  //Decodes pairs of hex digits into [first, last), optionally separated by a
+  //single character, until the input, the output or the valid digits run
+  //out. Returns the number of bytes written.
   template<typename OutputIter>
-  size_t StringToByteArray(
+  size_t HexDecodeRange(
     const string & src,
     OutputIter first,
     OutputIter last,
-    bool sep_present = false)
+    bool sep_present)
   {
-    assert(sizeof(*first) == 1);
     size_t count = 0;
-    istringstream iss(src);
-    char val[3];
-    while(first != last && iss.peek() != std::istringstream::traits_type::eof())
+    size_t step = sep_present ? 3 : 2;
+    size_t pos = 0;
+    for(; first != last && pos + 2 <= src.length(); pos += step)
+    {
+      int8_t hi = kHexDigitValue[(uint8_t)src[pos]];
+      int8_t lo = kHexDigitValue[(uint8_t)src[pos + 1]];
+      if(hi < 0 || lo < 0)
+        return count;
+      *first++ = (uint8_t)(hi << 4 | lo);
+      count++;
+    }
+    if(first != last && pos + 1 == src.length() &&
+      kHexDigitValue[(uint8_t)src[pos]] >= 0)
     {
-      size_t nb = 0;
-      iss.get(val, 3);
-      (*first++) = (uint8_t)std::stoi(val, &nb, 16);
+      *first = (uint8_t)kHexDigitValue[(uint8_t)src[pos]];
       count++;
-      if(sep_present)
-        iss.get();
     }
     return count;
   }
+  template<typename ByteType>
+  size_t HexDecodeRange(
+    const string & src,
+    ByteType * first,
+    ByteType * last,
+    bool sep_present)
+  {
+    static_assert(sizeof(ByteType) == 1, "Only byte ranges can be decoded");
+    if(sep_present)
+      return HexDecodeRange<uint8_t*>(src, (uint8_t*)first, (uint8_t*)last,
+        true);
+    return HexDecode(src.data(), src.length(), (uint8_t*)first,
+      last - first);
+  }
+
+  //Fixme: Doesn't handle line breaks
+  template<typename OutputIter>
+  size_t StringToByteArray(
+    const string & src,
+    OutputIter first,
+    OutputIter last,
+    bool sep_present = false)
+  {
+    assert(sizeof(*first) == 1);
+    return HexDecodeRange(src, first, last, sep_present);
+  }
   ///////////////////////////////////////////////////////////////////////////////
   //ArpOffset
   class ArpOffsets
@@ -248,10 +387,18 @@ namespace tincan
     {
       return &pkt_[6];
     }
+    uint8_t* SourceMac()
+    {
+      return &pkt_[8];
+    }
     uint8_t* SourceIp()
     {
       return &pkt_[14];
     }
+    uint8_t* DestinationMac()
+    {
+      return &pkt_[18];
+    }
     uint8_t* DestinationIp()
     {
       return &pkt_[24];
@@ -67,7 +67,13 @@ const array<const char*, 3> ControlTypeStrings = { {"TincanRequest", "TincanResp
   ControlTypeEnum GetControlType() const;
   void SetControlType(ControlTypeEnum type);
 
+  uint32_t GetProtocolVersion() const;
+  void SetProtocolVersion(uint32_t ver);
+
   string StyledString();
+  //Encodes the control for the wire, in binary or as compact JSON as
+  //selected by its protocol version
+  void Serialize(string & msg) const;
 
   static uint64_t NextTagValue()
   {
@@ -0,0 +1,85 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_UNIX_CONTROL_LISTENER_H_
+#define TINCAN_UNIX_CONTROL_LISTENER_H_
+#if !defined(_IPOP_WIN)
+#include "tincan_base.h"
+#include "controller_handle.h"
+#include "control_dispatch.h"
+#include "unix_stream_server.h"
+
+namespace tincan
+{
+using namespace rtc;
+/*
+Receives controls on a unix domain stream socket and sends the responses and
+notifications back on the same connection. Each control is preceded by its
+length as a 4 byte big endian value, so message size is not bound by a
+datagram. A single controller is served, a new connection replaces the
+previous one. The sockets are serviced by the control thread's socket server
+and writes are serialized by the connection mutex.
+*/
+class UnixControlListener :
+  public UnixStreamServer,
+  public IpopControllerLink,
+  public DispatchToListenerInf,
+  public Runnable
+{
+public:
+  UnixControlListener(
+    unique_ptr<ControlDispatch> control_dispatch,
+    const string & socket_path);
+  ~UnixControlListener();
+  //
+  //IpopControllerLink interface
+  void Deliver(
+    TincanControl & ctrl_resp) override;
+  void Deliver(
+    unique_ptr<TincanControl> ctrl_resp) override;
+  //
+  //DispatchtoListener interface implementation
+  void CreateIpopControllerLink(
+    unique_ptr<SocketAddress> controller_addr) override;
+  IpopControllerLink & GetIpopControllerLink() override
+  {
+    return *this;
+  }
+  //
+  //Runnable
+  void Run(Thread* thread) override;
+
+  static const uint32_t kMaxControlSize = 64 * 1024 * 1024;
+private:
+  //Dispatches every complete control that has been received
+  void OnReceived(
+    string & rcv_buf) override;
+  void HandleControl(
+    const char * data,
+    size_t len);
+
+  unique_ptr<ControlDispatch> ctrl_dispatch_;
+  std::atomic<uint32_t> proto_ver_;
+};
+}  // namespace tincan
+#endif  // !_IPOP_WIN
+#endif  // TINCAN_UNIX_CONTROL_LISTENER_H_
@@ -0,0 +1,118 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#ifndef TINCAN_UNIX_STREAM_SERVER_H_
+#define TINCAN_UNIX_STREAM_SERVER_H_
+#if !defined(_IPOP_WIN)
+#include "tincan_base.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/physicalsocketserver.h"
+#include "webrtc/base/thread.h"
+
+namespace tincan
+{
+using namespace rtc;
+/*
+Serves a single controller connection on a unix domain stream socket. The
+sockets are serviced by the server thread's socket server, a new connection
+replaces the previous one. Reads are drained without blocking and passed to
+the derived class, which consumes the complete messages from the receive
+buffer. Writes block, bounded by the send timeout. A write that fails leaves
+the stream out of frame, so the connection is shut down on any send error.
+*/
+class UnixStreamServer
+{
+public:
+  UnixStreamServer(
+    const string & socket_path);
+  virtual ~UnixStreamServer();
+
+  static const uint32_t kSendTimeout = 5; //seconds
+protected:
+  //Binds the socket path and services it on the thread's socket server
+  void Listen(
+    Thread * thread);
+  //Consumes the complete messages at the front of the receive buffer, on the
+  //server thread
+  virtual void OnReceived(
+    string & rcv_buf) = 0;
+  //Releases the state of the connection, called with conn_mutex_ held
+  virtual void OnClosed()
+  {}
+  //Server thread only
+  void CloseConnection();
+  //Writes all of the data to the connection, the caller holds conn_mutex_ or
+  //is on the server thread. On failure the connection is shut down and the
+  //server thread closes it.
+  bool Send(
+    const char * data,
+    size_t len);
+
+  string socket_path_;
+  //the controller connection, only replaced on the server thread and under
+  //conn_mutex_
+  int conn_fd_;
+  std::mutex conn_mutex_;
+private:
+  //Adapts a socket descriptor to the socket server's event loop
+  class SocketDispatcher :
+    public Dispatcher
+  {
+  public:
+    SocketDispatcher(
+      UnixStreamServer & server,
+      int fd) :
+      server_(server),
+      fd_(fd)
+    {}
+    uint32_t GetRequestedEvents() override
+    {
+      return DE_READ;
+    }
+    void OnPreEvent(uint32_t) override
+    {}
+    void OnEvent(uint32_t ff, int err) override;
+    int GetDescriptor() override
+    {
+      return fd_;
+    }
+    bool IsDescriptorClosed() override
+    {
+      return false;
+    }
+  private:
+    UnixStreamServer & server_;
+    int fd_;
+  };
+  void OnAcceptable();
+  void OnReadable();
+
+  PhysicalSocketServer * socket_server_;
+  int listen_fd_;
+  unique_ptr<SocketDispatcher> listen_disp_;
+  unique_ptr<SocketDispatcher> conn_disp_;
+  unique_ptr<SocketDispatcher> closed_disp_;
+  string rcv_buf_;
+};
+}  // namespace tincan
+#endif  // !_IPOP_WIN
+#endif  // TINCAN_UNIX_STREAM_SERVER_H_
@@ -34,6 +34,7 @@
 #include "webrtc/p2p/base/packettransportinterface.h"
 #include "webrtc/p2p/base/p2ptransportchannel.h"
 #include "webrtc/p2p/client/basicportallocator.h"
+#include "latency_stats.h"
 #include "tap_frame.h"
 #include "peer_descriptor.h"
 #include "turn_descriptor.h"
@@ -55,6 +56,44 @@ struct  VlinkDescriptor
   string uid;
   vector<string> stun_servers;
   vector<TurnDescriptor> turn_descs;
+  //gathers candidates on loopback interfaces, which are normally ignored
+  bool allow_loopback;
+};
+
+//The totals of one ICE connection, identified by its static key
+struct ConnectionBytes
+{
+  const void * key;
+  uint64_t sent_bytes;
+  uint64_t recv_bytes;
+};
+
+//The condensed state of a vlink's connection, byte counts are totals over all
+//of its ICE connections and the rest is from the best connection
+struct LinkStatsSample
+{
+  LinkStatsSample() :
+    online(false), writable(false), rtt(0), sent_bytes(0), recv_bytes(0)
+  {}
+  bool online;
+  bool writable;
+  uint64_t rtt;
+  uint64_t sent_bytes;
+  uint64_t recv_bytes;
+  vector<ConnectionBytes> connections;
+};
+
+//Totals of the frames carried by a vlink, written only on the network thread
+struct LinkCounters
+{
+  LinkCounters() :
+    frames_in(0), bytes_in(0), frames_out(0), bytes_out(0), send_failures(0)
+  {}
+  std::atomic<uint64_t> frames_in;
+  std::atomic<uint64_t> bytes_in;
+  std::atomic<uint64_t> frames_out;
+  std::atomic<uint64_t> bytes_out;
+  std::atomic<uint64_t> send_failures;
 };
 
 class VirtualLink :
@@ -101,6 +140,24 @@ public:
     return vlink_desc_->uid;
   }
   void GetStats(Json::Value & infos);
+  //Must be called on the network thread
+  void GetStats(LinkStatsSample & sample);
+
+  const LinkCounters & Counters() const
+  {
+    return counters_;
+  }
+
+  //The pipeline stages timed by the tunnel for the frames of this vlink
+  StageLatencies & Latencies()
+  {
+    return *latencies_;
+  }
+  //Held by the frames of this vlink until their TAP write completes
+  shared_ptr<StageLatencies> SharedLatencies()
+  {
+    return latencies_;
+  }
 
   cricket::IceRole IceRole()
   {
@@ -166,6 +223,8 @@ private:
   unique_ptr<cricket::TransportController> transport_ctlr_;
 
   cricket::IceGatheringState gather_state_;
+  LinkCounters counters_;
+  shared_ptr<StageLatencies> latencies_;
   bool is_valid_;
   rtc::Thread* signaling_thread_;
   rtc::Thread* network_thread_;
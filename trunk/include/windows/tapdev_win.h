@@ -181,8 +181,6 @@ public:
 
   uint32_t MediaStatus();
 
-  sigslot::signal1<AsyncIo *> read_completion_;
-  sigslot::signal1<AsyncIo *> write_completion_;
 protected:
   void NetDeviceNameToGuid(
     const string & name,
@@ -0,0 +1,137 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "arp_cache.h"
+#include "webrtc/base/logging.h"
+namespace tincan
+{
+ArpCache::ArpCache() :
+  hits_(0),
+  misses_(0)
+{}
+
+void
+ArpCache::AddStatic(
+  const IP4AddressType & ip4,
+  const MacAddressType & mac)
+{
+  lock_guard<mutex> lg(mtx_);
+  ArpEntry & ent = entries_[Key(ip4)];
+  ent.mac = mac;
+  ent.learned = 0;
+  ent.is_static = true;
+}
+
+void
+ArpCache::RemoveStatic(
+  const MacAddressType & mac)
+{
+  lock_guard<mutex> lg(mtx_);
+  for(auto itr = entries_.begin(); itr != entries_.end();)
+  {
+    if(itr->second.is_static && itr->second.mac == mac)
+      itr = entries_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+void
+ArpCache::Learn(
+  const IP4AddressType & ip4,
+  const MacAddressType & mac,
+  uint32_t now)
+{
+  lock_guard<mutex> lg(mtx_);
+  auto res = entries_.emplace(Key(ip4), ArpEntry{ mac, now, false });
+  ArpEntry & ent = res.first->second;
+  if(res.second || ent.is_static)
+    return;
+  if(ent.mac != mac)
+  {
+    LOG(LS_INFO) << "ARP binding for " << (int)ip4[0] << "." << (int)ip4[1]
+      << "." << (int)ip4[2] << "." << (int)ip4[3] << " moved to "
+      << ByteArrayToString(mac.begin(), mac.end());
+    ent.mac = mac;
+  }
+  ent.learned = now;
+}
+
+bool
+ArpCache::Resolve(
+  const IP4AddressType & ip4,
+  MacAddressType & mac)
+{
+  lock_guard<mutex> lg(mtx_);
+  auto itr = entries_.find(Key(ip4));
+  if(itr == entries_.end())
+  {
+    misses_++;
+    return false;
+  }
+  hits_++;
+  mac = itr->second.mac;
+  return true;
+}
+
+void
+ArpCache::Expire(
+  uint32_t now)
+{
+  lock_guard<mutex> lg(mtx_);
+  for(auto itr = entries_.begin(); itr != entries_.end();)
+  {
+    if(!itr->second.is_static && now - itr->second.learned >= kLearnedTtl)
+      itr = entries_.erase(itr);
+    else
+      ++itr;
+  }
+}
+
+void
+ArpCache::Clear()
+{
+  lock_guard<mutex> lg(mtx_);
+  entries_.clear();
+}
+
+size_t
+ArpCache::Size()
+{
+  lock_guard<mutex> lg(mtx_);
+  return entries_.size();
+}
+
+uint64_t
+ArpCache::Hits()
+{
+  lock_guard<mutex> lg(mtx_);
+  return hits_;
+}
+
+uint64_t
+ArpCache::Misses()
+{
+  lock_guard<mutex> lg(mtx_);
+  return misses_;
+}
+} // namespace tincan
@@ -22,18 +22,27 @@
 */
 #include "basic_tunnel.h"
 #include "webrtc/base/base64.h"
+#include "stats_region.h"
 #include "tincan_control.h"
 namespace tincan
 {
   extern TincanParameters tp;
   BasicTunnel::BasicTunnel(
   unique_ptr<TunnelDescriptor> descriptor,
-  IpopControllerLink * ctrl_handle) :
-  tdev_(nullptr),
+  IpopControllerLink * ctrl_handle,
+  unique_ptr<TapDevInf> tdev) :
+  tdev_(move(tdev)),
   descriptor_(move(descriptor)),
-  ctrl_link_(ctrl_handle)
+  ctrl_link_(ctrl_handle),
+  icc_link_(nullptr),
+  stats_tick_pending_(false),
+  stats_region_(nullptr),
+  tnl_stats_slot_(nullptr),
+  stats_publishes_(0),
+  latency_enabled_(false)
 {
-  tdev_ = make_unique<TapDev>();
+  if(!tdev_)
+    tdev_ = make_unique<TapDev>();
 }
 
 BasicTunnel::~BasicTunnel()
@@ -66,11 +75,23 @@ BasicTunnel::Start()
   sig_worker_.Start();
   tdev_->read_completion_.connect(this, &BasicTunnel::TapReadComplete);
   tdev_->write_completion_.connect(this, &BasicTunnel::TapWriteComplete);
+  if(stats_region_)
+    net_worker_.Post(RTC_FROM_HERE, this, MSGID_STATS_PUBLISH);
 }
 
 void
 BasicTunnel::Shutdown()
 {
+  if(stats_region_)
+  {
+    //the slots are released on the thread that publishes to them
+    net_worker_.Invoke<void>(RTC_FROM_HERE, [this]()
+    {
+      net_worker_.Clear(this, MSGID_STATS_PUBLISH);
+      ReleaseStatsSlots();
+      stats_region_ = nullptr;
+    });
+  }
   net_worker_.Quit();
   sig_worker_.Quit();
   tdev_->Down();
@@ -185,7 +206,18 @@ void BasicTunnel::OnMessage(Message * msg)
   {
     unique_ptr<TapFrame> frame = move(((TransmitMsgData*)msg->pdata)->frm);
     shared_ptr<VirtualLink> vl = ((TransmitMsgData*)msg->pdata)->vl;
+    uint64_t dequeued = frame->EntryTime() ? LatencyClock() : 0;
     vl->Transmit(*frame);
+    if(dequeued)
+    {
+      uint64_t sent = LatencyClock();
+      for(StageLatencies * sl : { &latencies_, &vl->Latencies() })
+      {
+        sl->Record(PS_TAP_TO_NET, dequeued - frame->EntryTime());
+        sl->Record(PS_DTLS_SEND, sent - dequeued);
+        sl->Record(PS_EGRESS, sent - frame->EntryTime());
+      }
+    }
     delete msg->pdata;
     frame->Initialize(frame->Payload(), frame->PayloadCapacity());
     if(0 == tdev_->Read(*frame))
@@ -209,6 +241,31 @@ void BasicTunnel::OnMessage(Message * msg)
     ((LinkInfoMsgData*)msg->pdata)->msg_event.Set();
   }
   break;
+  case MSGID_QUERY_LINKS_INFO:
+  {
+    LinksInfoMsgData * md = (LinksInfoMsgData*)msg->pdata;
+    for(auto & vl : md->vls)
+    {
+      Json::Value & vlink_info = md->info[vl->Id()];
+      if(vl->IceRole() == cricket::ICEROLE_CONTROLLING)
+        vlink_info[TincanControl::IceRole] = TincanControl::Controlling;
+      else
+        vlink_info[TincanControl::IceRole] = TincanControl::Controlled;
+      if(vl->IsReady())
+      {
+        vlink_info[TincanControl::Stats] = Json::Value(Json::arrayValue);
+        vl->GetStats(vlink_info[TincanControl::Stats]);
+        vlink_info[TincanControl::Status] = "ONLINE";
+      }
+      else
+      {
+        vlink_info[TincanControl::Status] = "OFFLINE";
+        vlink_info[TincanControl::Stats] = Json::Value(Json::objectValue);
+      }
+    }
+    md->msg_event.Set();
+  }
+  break;
   case MSGID_FWD_FRAME:
   case MSGID_FWD_FRAME_RD:
   {
@@ -232,7 +289,336 @@ void BasicTunnel::OnMessage(Message * msg)
     ((LinkInfoMsgData*)msg->pdata)->msg_event.Set();
   }
   break;
+  case MSGID_REPLICATE:
+  case MSGID_REPLICATE_RD:
+  {
+    unique_ptr<TapFrame> frame = move(((ReplicateMsgData*)msg->pdata)->frm);
+    for(auto & vl : ((ReplicateMsgData*)msg->pdata)->vls)
+      vl->Transmit(*frame);
+    delete msg->pdata;
+    if(msg->message_id == MSGID_REPLICATE_RD)
+    {
+      frame->Initialize(frame->Payload(), frame->PayloadCapacity());
+      if(0 == tdev_->Read(*frame))
+        frame.release();
+    }
+  }
+  break;
+  case MSGID_STATS_CONFIG:
+  {
+    StatsConfigMsgData * md = (StatsConfigMsgData*)msg->pdata;
+    stats_monitor_.Configure(md->interval, md->threshold, rtc::TimeMillis());
+    delete md;
+    if(stats_monitor_.IsEnabled() && !stats_tick_pending_)
+    {
+      stats_tick_pending_ = true;
+      net_worker_.Post(RTC_FROM_HERE, this, MSGID_STATS_TICK);
+    }
+  }
+  break;
+  case MSGID_STATS_TICK:
+  {
+    stats_tick_pending_ = false;
+    if(stats_monitor_.IsEnabled())
+    {
+      PushLinkStats();
+      stats_tick_pending_ = true;
+      net_worker_.PostDelayed(RTC_FROM_HERE, stats_monitor_.CheckInterval(),
+        this, MSGID_STATS_TICK);
+    }
+  }
+  break;
+  case MSGID_STATS_PUSH:
+  {
+    StatsPushMsgData * md = (StatsPushMsgData*)msg->pdata;
+    ctrl_link_->Deliver(move(md->ctrl));
+    delete md;
+  }
+  break;
+#if !defined(_IPOP_WIN)
+  case MSGID_STATS_PUBLISH:
+  {
+    if(stats_region_)
+    {
+      PublishStats();
+      net_worker_.PostDelayed(RTC_FROM_HERE, StatsRegion::kPublishInterval,
+        this, MSGID_STATS_PUBLISH);
+    }
+  }
+  break;
+#endif // !_IPOP_WIN
+  }
+}
+
+void
+BasicTunnel::QueryLinksInfo(
+  Json::Value & links_info)
+{
+  LinksInfoMsgData md;
+  QueryVlinks(md.vls);
+  if(md.vls.empty())
+    return;
+  net_worker_.Post(RTC_FROM_HERE, this, MSGID_QUERY_LINKS_INFO, &md);
+  md.msg_event.Wait(Event::kForever);
+  for(auto & vl : md.vls)
+    links_info[vl->Id()].swap(md.info[vl->Id()]);
+}
+
+/*
+The Interval in milliseconds between full reports, 0 to unsubscribe, and the
+Threshold, a percentage change in rtt or transfer rate that is reported before
+the interval is up. The subscription is applied on the network thread.
+*/
+void
+BasicTunnel::SubscribeLinkStats(
+  const Json::Value & sub_desc)
+{
+  StatsConfigMsgData * md = new StatsConfigMsgData;
+  md->interval = sub_desc["Interval"].asUInt();
+  md->threshold = sub_desc.isMember("Threshold") ?
+    sub_desc["Threshold"].asUInt() : LinkStatsMonitor::kDefaultThreshold;
+  net_worker_.Post(RTC_FROM_HERE, this, MSGID_STATS_CONFIG, md);
+}
+
+/*
+Enabled turns the timestamping of frames on or off, Reset discards what has
+been recorded so far. Frames already in the pipeline when timing is turned on
+are not timed.
+*/
+void
+BasicTunnel::ConfigureLatencyStats(
+  const Json::Value & cfg_desc)
+{
+  if(cfg_desc.get("Reset", false).asBool())
+  {
+    latencies_.Reset();
+    vector<shared_ptr<VirtualLink>> vlinks;
+    QueryVlinks(vlinks);
+    for(auto & vl : vlinks)
+      vl->Latencies().Reset();
+  }
+  if(cfg_desc.isMember("Enabled"))
+    latency_enabled_.store(cfg_desc["Enabled"].asBool(),
+      std::memory_order_relaxed);
+}
+
+void
+BasicTunnel::QueryLatencyStats(
+  bool reset,
+  Json::Value & stats)
+{
+  vector<shared_ptr<VirtualLink>> vlinks;
+  QueryVlinks(vlinks);
+  stats["Enabled"] = latency_enabled_.load(std::memory_order_relaxed);
+  stats["Tunnel"] = Json::Value(Json::objectValue);
+  latencies_.Query(stats["Tunnel"]);
+  stats["Links"] = Json::Value(Json::objectValue);
+  for(auto & vl : vlinks)
+  {
+    Json::Value & link = stats["Links"][vl->Id()];
+    link = Json::Value(Json::objectValue);
+    vl->Latencies().Query(link);
+  }
+  if(reset)
+  {
+    latencies_.Reset();
+    for(auto & vl : vlinks)
+      vl->Latencies().Reset();
+  }
+}
+
+void
+BasicTunnel::RecordVlinkToTap(
+  TapFrame & frame,
+  VirtualLink & vlink,
+  uint64_t received)
+{
+  if(!received)
+    return;
+  uint64_t now = LatencyClock();
+  latencies_.Record(PS_VLINK_TO_TAP, now - received);
+  vlink.Latencies().Record(PS_VLINK_TO_TAP, now - received);
+  frame.Timestamp(received, now);
+  frame.VlinkLatencies(vlink.SharedLatencies());
+}
+
+void
+BasicTunnel::RecordTapWrite(
+  TapFrame & frame)
+{
+  if(!frame.EntryTime())
+    return;
+  uint64_t now = LatencyClock();
+  for(StageLatencies * sl : { &latencies_, frame.VlinkLatencies().get() })
+  {
+    if(!sl)
+      continue;
+    sl->Record(PS_TAP_WRITE, now - frame.StageTime());
+    sl->Record(PS_INGRESS, now - frame.EntryTime());
+  }
+}
+
+/*
+Samples the vlinks on the network thread and hands any update to the signal
+thread for delivery, so a slow controller does not hold up the data path.
+*/
+void
+BasicTunnel::PushLinkStats()
+{
+  vector<shared_ptr<VirtualLink>> vlinks;
+  QueryVlinks(vlinks);
+  vector<pair<string, LinkStatsSample>> samples(vlinks.size());
+  for(size_t i = 0; i < vlinks.size(); i++)
+  {
+    samples[i].first = vlinks[i]->Id();
+    vlinks[i]->GetStats(samples[i].second);
+  }
+  Json::Value links(Json::arrayValue);
+  bool full = false;
+  if(!stats_monitor_.Update(samples, rtc::TimeMillis(), links, full))
+    return;
+  StatsPushMsgData * md = new StatsPushMsgData;
+  md->ctrl = make_unique<TincanControl>();
+  md->ctrl->SetControlType(TincanControl::CTTincanRequest);
+  Json::Value & req = md->ctrl->GetRequest();
+  req[TincanControl::Command] = "LinkStatsUpdate";
+  req[TincanControl::TunnelId] = descriptor_->uid;
+  req[TincanControl::Stats]["Full"] = full;
+  req[TincanControl::Stats]["Links"].swap(links);
+  sig_worker_.Post(RTC_FROM_HERE, this, MSGID_STATS_PUSH, md);
+}
+
+void
+BasicTunnel::SetStatsRegion(
+  StatsRegion * stats_region)
+{
+  stats_region_ = stats_region;
+}
+
+void
+BasicTunnel::SetIccLink(
+  IccLink * icc_link)
+{
+  icc_link_ = icc_link;
+}
+
+void
+BasicTunnel::DeliverIcc(
+  TapFrame & frame,
+  VirtualLink & vlink)
+{
+  if(icc_link_ && icc_link_->DeliverIcc(descriptor_->uid, vlink.Id(),
+    frame.Payload(), frame.PayloadLength()))
+    return;
+  unique_ptr<TincanControl> ctrl = make_unique<TincanControl>();
+  ctrl->SetControlType(TincanControl::CTTincanRequest);
+  Json::Value & req = ctrl->GetRequest();
+  req[TincanControl::Command] = TincanControl::ICC;
+  req[TincanControl::TunnelId] = descriptor_->uid;
+  req[TincanControl::LinkId] = vlink.Id();
+  req[TincanControl::Data] = string((char*)frame.Payload(),
+    frame.PayloadLength());
+  ctrl_link_->Deliver(move(ctrl));
+}
+
+void
+BasicTunnel::QueueStats(
+  uint64_t & pending,
+  uint64_t & dropped)
+{
+  pending = 0;
+  dropped = 0;
+}
+
+/*
+Copies the data path counters of the tunnel and its vlinks to their slots in
+the stats region. Slots are taken for new vlinks and given back for the ones
+that have gone. The rtt is only sampled every kStatsRttRefresh publishes as it
+requires querying the ICE connections.
+*/
+void
+BasicTunnel::PublishStats()
+{
+#if !defined(_IPOP_WIN)
+  uint64_t now = (uint64_t)rtc::TimeMillis();
+  if(!tnl_stats_slot_)
+    tnl_stats_slot_ = stats_region_->AcquireTunnelSlot(descriptor_->uid);
+  if(tnl_stats_slot_)
+  {
+    uint64_t values[TC_COUNT];
+    values[TC_TAP_FRAMES_IN] =
+      tap_counters_.frames_in.load(std::memory_order_relaxed);
+    values[TC_TAP_BYTES_IN] =
+      tap_counters_.bytes_in.load(std::memory_order_relaxed);
+    values[TC_TAP_FRAMES_OUT] =
+      tap_counters_.frames_out.load(std::memory_order_relaxed);
+    values[TC_TAP_BYTES_OUT] =
+      tap_counters_.bytes_out.load(std::memory_order_relaxed);
+    values[TC_TAP_ERRORS] =
+      tap_counters_.errors.load(std::memory_order_relaxed);
+    QueueStats(values[TC_PENDING_FRAMES], values[TC_DROPPED]);
+    values[TC_NET_QUEUE] = net_worker_.size();
+    values[TC_UPDATED_MS] = now;
+    PublishSlot(*tnl_stats_slot_, values);
+  }
+  bool refresh_rtt = stats_publishes_++ % kStatsRttRefresh == 0;
+  vector<shared_ptr<VirtualLink>> vlinks;
+  QueryVlinks(vlinks);
+  map<string, LinkStatsSlot *> link_slots;
+  for(auto & vl : vlinks)
+  {
+    LinkStatsSlot * slot = nullptr;
+    auto itr = link_stats_slots_.find(vl->Id());
+    if(itr != link_stats_slots_.end())
+    {
+      slot = itr->second;
+      link_stats_slots_.erase(itr);
+    }
+    else
+    {
+      slot = stats_region_->AcquireLinkSlot(descriptor_->uid, vl->Id());
+      if(!slot)
+        continue;
+    }
+    link_slots[vl->Id()] = slot;
+    const LinkCounters & lc = vl->Counters();
+    uint64_t values[LC_COUNT];
+    values[LC_FRAMES_IN] = lc.frames_in.load(std::memory_order_relaxed);
+    values[LC_BYTES_IN] = lc.bytes_in.load(std::memory_order_relaxed);
+    values[LC_FRAMES_OUT] = lc.frames_out.load(std::memory_order_relaxed);
+    values[LC_BYTES_OUT] = lc.bytes_out.load(std::memory_order_relaxed);
+    values[LC_SEND_FAILURES] =
+      lc.send_failures.load(std::memory_order_relaxed);
+    values[LC_ONLINE] = vl->IsReady() ? 1 : 0;
+    values[LC_RTT] = slot->values[LC_RTT].load(std::memory_order_relaxed);
+    if(!values[LC_ONLINE])
+      values[LC_RTT] = 0;
+    else if(refresh_rtt)
+    {
+      LinkStatsSample sample;
+      vl->GetStats(sample);
+      values[LC_RTT] = sample.rtt;
+    }
+    values[LC_UPDATED_MS] = now;
+    PublishSlot(*slot, values);
   }
+  for(auto & entry : link_stats_slots_)
+    stats_region_->Release(entry.second);
+  link_stats_slots_.swap(link_slots);
+#endif // !_IPOP_WIN
+}
+
+void
+BasicTunnel::ReleaseStatsSlots()
+{
+#if !defined(_IPOP_WIN)
+  for(auto & entry : link_stats_slots_)
+    stats_region_->Release(entry.second);
+  link_stats_slots_.clear();
+  if(tnl_stats_slot_)
+    stats_region_->Release(tnl_stats_slot_);
+  tnl_stats_slot_ = nullptr;
+#endif // !_IPOP_WIN
 }
 
 void
@@ -259,4 +645,28 @@ BasicTunnel::InjectFame(
   tdev_->Write(*tf.release());
   //LOG(LS_INFO) << "Frame injected=\n" << data;
 }
+
+void
+BasicTunnel::InjectFrame(
+  const uint8_t * data,
+  uint32_t len)
+{
+  if(len > tp.kEthernetSize)
+  {
+    stringstream oss;
+    oss << "Inject Frame operation failed - frame size " << len
+      << " is larger than maximum accepted " << tp.kEthernetSize;
+    throw TCEXCEPT(oss.str().c_str());
+  }
+  unique_ptr<TapFrame> tf = make_unique<TapFrame>();
+  tf->Initialize();
+  memcpy(tf->Payload(), data, len);
+  tf->SetWriteOp();
+  tf->PayloadLength(len);
+  tf->BufferToTransfer(tf->Payload());
+  tf->BytesTransferred(len);
+  tf->BytesToTransfer(len);
+  if(0 == tdev_->Write(*tf))
+    tf.release();
+}
 } //namespace tincan
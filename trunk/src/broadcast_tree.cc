@@ -0,0 +1,169 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "broadcast_tree.h"
+#include "webrtc/base/helpers.h"
+namespace tincan
+{
+BroadcastTree::BroadcastTree() :
+  has_parent_(false),
+  parent_{ 0 },
+  next_seq_(rtc::CreateRandomId()),
+  stats_{ 0, 0, 0, 0 }
+{}
+
+void
+BroadcastTree::Install(
+  bool has_parent,
+  const MacAddressType & parent,
+  const vector<MacAddressType> & children)
+{
+  lock_guard<mutex> lg(mtx_);
+  has_parent_ = has_parent;
+  parent_ = parent;
+  children_ = children;
+}
+
+void
+BroadcastTree::Clear()
+{
+  lock_guard<mutex> lg(mtx_);
+  has_parent_ = false;
+  children_.clear();
+  origins_.clear();
+}
+
+bool
+BroadcastTree::IsInstalled()
+{
+  lock_guard<mutex> lg(mtx_);
+  return has_parent_ || !children_.empty();
+}
+
+vector<MacAddressType>
+BroadcastTree::Neighbors()
+{
+  lock_guard<mutex> lg(mtx_);
+  vector<MacAddressType> nbrs;
+  nbrs.reserve(children_.size() + 1);
+  if(has_parent_)
+    nbrs.push_back(parent_);
+  nbrs.insert(nbrs.end(), children_.begin(), children_.end());
+  return nbrs;
+}
+
+uint32_t
+BroadcastTree::NextSequence()
+{
+  lock_guard<mutex> lg(mtx_);
+  return next_seq_++;
+}
+
+/*
+A sequence ahead of the highest one seen advances the window, one within the
+window is checked against the bitmap. One that is further behind than the
+window is taken to be from an origin that has restarted, its window is reset.
+*/
+bool
+BroadcastTree::FirstSeen(
+  const MacAddressType & origin,
+  uint32_t seq)
+{
+  steady_clock::time_point now = steady_clock::now();
+  lock_guard<mutex> lg(mtx_);
+  auto it = origins_.find(origin);
+  if(it == origins_.end())
+  {
+    if(origins_.size() >= kMaxOrigins)
+      ExpireOrigins(now);
+    if(origins_.size() >= kMaxOrigins)
+      origins_.erase(origins_.begin());
+    origins_[origin] = SeqWindow{ seq, 1, now };
+    return true;
+  }
+  SeqWindow & sw = it->second;
+  sw.last_seen = now;
+  int32_t delta = (int32_t)(seq - sw.highest);
+  if(delta > 0)
+  {
+    sw.seen = (uint32_t)delta < kSeqWindow ? (sw.seen << delta) | 1 : 1;
+    sw.highest = seq;
+    return true;
+  }
+  uint32_t behind = (uint32_t)-delta;
+  if(behind >= kSeqWindow)
+  {
+    sw.highest = seq;
+    sw.seen = 1;
+    return true;
+  }
+  if(sw.seen & (1ULL << behind))
+  {
+    stats_.duplicates++;
+    return false;
+  }
+  sw.seen |= 1ULL << behind;
+  return true;
+}
+
+void
+BroadcastTree::Originated()
+{
+  lock_guard<mutex> lg(mtx_);
+  stats_.originated++;
+}
+
+void
+BroadcastTree::Forwarded(
+  size_t copies)
+{
+  lock_guard<mutex> lg(mtx_);
+  stats_.forwarded += copies;
+}
+
+void
+BroadcastTree::Delivered()
+{
+  lock_guard<mutex> lg(mtx_);
+  stats_.delivered++;
+}
+
+BroadcastTreeStats
+BroadcastTree::Stats()
+{
+  lock_guard<mutex> lg(mtx_);
+  return stats_;
+}
+
+void
+BroadcastTree::ExpireOrigins(
+  steady_clock::time_point now)
+{
+  for(auto it = origins_.begin(); it != origins_.end();)
+  {
+    if(now - it->second.last_seen >= milliseconds(kOriginExpiry))
+      it = origins_.erase(it);
+    else
+      ++it;
+  }
+}
+} // namespace tincan
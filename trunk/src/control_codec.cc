@@ -0,0 +1,345 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "control_codec.h"
+#include "tincan_exception.h"
+namespace tincan
+{
+const uint8_t ControlCodec::kMagic[2] = { 0xC0, 0x01 };
+
+//The schema's object keys, a key is encoded as its index plus one
+static const char * const kKeys[] = {
+  "Command", "ControlType", "TransactionId", "ProtocolVersion", "Request",
+  "Response", "Message", "Success", "TunnelId", "LinkId", "NodeId", "Data",
+  "PeerInfo", "CAS", "FPR", "MAC", "UID", "VIP4", "VIP6", "IP4PrefixLen",
+  "MTU4", "TapName", "IceRole", "Type", "Level", "Status", "Stats", "Vlinks",
+  "Recipient", "RecipientMac", "EncryptionEnabled", "IgnoredNetInterfaces",
+  "StunServers", "TurnServers", "Address", "User", "Password", "Table",
+  "Action", "Prefix", "Path", "Replace", "Destination", "Routes", "Added",
+  "Removed", "Rejected", "Hits", "Misses", "Enabled", "Rate", "Burst",
+  "Peers", "Groups", "Group", "Parent", "Children", "LinkIds", "TunnelIds",
+  "rtt", "state", "writable", "receiving", "timeout", "local_candidate",
+  "remote_candidate", "sent_total_bytes", "recv_total_bytes", "best_conn",
+  "Links", "Full", "sent_bytes_second", "recv_bytes_second", "Interval",
+  "Threshold",
+};
+static const size_t kKeyCount = sizeof(kKeys) / sizeof(kKeys[0]);
+
+static const map<string, uint32_t> &
+KeyIndex()
+{
+  static const map<string, uint32_t> index = []()
+  {
+    map<string, uint32_t> m;
+    for(uint32_t i = 0; i < kKeyCount; i++)
+      m[kKeys[i]] = i + 1;
+    return m;
+  }();
+  return index;
+}
+
+static void
+PutVarint(
+  uint64_t v,
+  string & out)
+{
+  while(v >= 0x80)
+  {
+    out.push_back((char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((char)v);
+}
+
+static uint64_t
+GetVarint(
+  const uint8_t *& pos,
+  const uint8_t * end)
+{
+  uint64_t v = 0;
+  for(uint32_t shift = 0; shift < 64; shift += 7)
+  {
+    if(pos == end)
+      throw TCEXCEPT("The binary control is truncated");
+    uint8_t b = *pos++;
+    v |= (uint64_t)(b & 0x7F) << shift;
+    if(!(b & 0x80))
+      return v;
+  }
+  throw TCEXCEPT("The binary control has an invalid varint");
+}
+
+static void
+PutFixed(
+  uint64_t v,
+  size_t width,
+  string & out)
+{
+  for(size_t i = 0; i < width; i++)
+    out.push_back((char)(v >> (8 * i)));
+}
+
+static uint64_t
+GetFixed(
+  const uint8_t * pos,
+  size_t width)
+{
+  uint64_t v = 0;
+  for(size_t i = 0; i < width; i++)
+    v |= (uint64_t)pos[i] << (8 * i);
+  return v;
+}
+
+static void
+GetBytes(
+  const uint8_t *& pos,
+  const uint8_t * end,
+  string & str)
+{
+  uint64_t len = GetVarint(pos, end);
+  if(len > (uint64_t)(end - pos))
+    throw TCEXCEPT("The binary control is truncated");
+  str.assign((const char*)pos, (size_t)len);
+  pos += len;
+}
+
+bool
+ControlCodec::IsBinary(
+  const char * data,
+  size_t len)
+{
+  return len >= 2 && (uint8_t)data[0] == kMagic[0] &&
+    (uint8_t)data[1] == kMagic[1];
+}
+
+void
+ControlCodec::Encode(
+  const ControlHeader & hdr,
+  const Json::Value * req,
+  const Json::Value * resp,
+  string & out)
+{
+  out.clear();
+  out.reserve(256);
+  out.append((const char*)kMagic, sizeof(kMagic));
+  out.push_back((char)hdr.version);
+  out.push_back((char)hdr.type);
+  PutFixed(0, 4, out); //body length, filled in below
+  PutFixed(hdr.tag, 8, out);
+  uint8_t flags = (req ? kHasRequest : 0) | (resp ? kHasResponse : 0);
+  out.push_back((char)flags);
+  if(req)
+    EncodeValue(*req, out);
+  if(resp)
+    EncodeValue(*resp, out);
+  uint64_t body_len = out.size() - kHeaderSize;
+  for(size_t i = 0; i < 4; i++)
+    out[4 + i] = (char)(body_len >> (8 * i));
+}
+
+void
+ControlCodec::Decode(
+  const char * data,
+  size_t len,
+  ControlHeader & hdr,
+  Json::Value & req,
+  Json::Value & resp)
+{
+  if(len < kHeaderSize || !IsBinary(data, len))
+    throw TCEXCEPT("The binary control header is invalid");
+  const uint8_t * pos = (const uint8_t*)data;
+  const uint8_t * end = pos + len;
+  hdr.version = pos[2];
+  hdr.type = pos[3];
+  uint64_t body_len = GetFixed(pos + 4, 4);
+  hdr.tag = GetFixed(pos + 8, 8);
+  if(body_len != len - kHeaderSize || body_len == 0)
+    throw TCEXCEPT("The binary control length is invalid");
+  pos += kHeaderSize;
+  uint8_t flags = *pos++;
+  if(flags & kHasRequest)
+    DecodeValue(pos, end, 0, req);
+  if(flags & kHasResponse)
+    DecodeValue(pos, end, 0, resp);
+  if(pos != end)
+    throw TCEXCEPT("The binary control has trailing data");
+}
+
+void
+ControlCodec::EncodeValue(
+  const Json::Value & val,
+  string & out)
+{
+  switch(val.type())
+  {
+  case Json::nullValue:
+    out.push_back(TAG_NULL);
+    break;
+  case Json::booleanValue:
+    out.push_back(val.asBool() ? TAG_TRUE : TAG_FALSE);
+    break;
+  case Json::intValue:
+  {
+    //zigzag keeps small negative values short
+    int64_t v = val.asLargestInt();
+    out.push_back(TAG_INT);
+    PutVarint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63), out);
+    break;
+  }
+  case Json::uintValue:
+    out.push_back(TAG_UINT);
+    PutVarint(val.asLargestUInt(), out);
+    break;
+  case Json::realValue:
+  {
+    double d = val.asDouble();
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    out.push_back(TAG_REAL);
+    PutFixed(bits, 8, out);
+    break;
+  }
+  case Json::stringValue:
+  {
+    //the string's own length, so that embedded NULs are kept where the json
+    //library does
+    string str = val.asString();
+    out.push_back(TAG_STRING);
+    PutVarint(str.length(), out);
+    out.append(str);
+    break;
+  }
+  case Json::arrayValue:
+    out.push_back(TAG_ARRAY);
+    PutVarint(val.size(), out);
+    for(Json::ArrayIndex i = 0; i < val.size(); i++)
+      EncodeValue(val[i], out);
+    break;
+  case Json::objectValue:
+  {
+    const map<string, uint32_t> & index = KeyIndex();
+    out.push_back(TAG_OBJECT);
+    PutVarint(val.size(), out);
+    for(auto & key : val.getMemberNames())
+    {
+      auto ki = index.find(key);
+      if(ki != index.end())
+        PutVarint(ki->second, out);
+      else
+      {
+        PutVarint(0, out);
+        PutVarint(key.length(), out);
+        out.append(key);
+      }
+      EncodeValue(val[key], out);
+    }
+    break;
+  }
+  }
+}
+
+void
+ControlCodec::DecodeValue(
+  const uint8_t *& pos,
+  const uint8_t * end,
+  uint32_t depth,
+  Json::Value & val)
+{
+  if(pos == end)
+    throw TCEXCEPT("The binary control is truncated");
+  if(depth > kMaxDepth)
+    throw TCEXCEPT("The binary control is nested too deeply");
+  switch(*pos++)
+  {
+  case TAG_NULL:
+    val = Json::Value(Json::nullValue);
+    break;
+  case TAG_FALSE:
+    val = false;
+    break;
+  case TAG_TRUE:
+    val = true;
+    break;
+  case TAG_INT:
+  {
+    uint64_t zz = GetVarint(pos, end);
+    val = (Json::Int64)((zz >> 1) ^ (~(zz & 1) + 1));
+    break;
+  }
+  case TAG_UINT:
+    val = (Json::UInt64)GetVarint(pos, end);
+    break;
+  case TAG_REAL:
+  {
+    if(end - pos < 8)
+      throw TCEXCEPT("The binary control is truncated");
+    uint64_t bits = GetFixed(pos, 8);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    pos += 8;
+    val = d;
+    break;
+  }
+  case TAG_STRING:
+  {
+    string str;
+    GetBytes(pos, end, str);
+    val = str;
+    break;
+  }
+  case TAG_ARRAY:
+  {
+    uint64_t count = GetVarint(pos, end);
+    //every element takes at least one byte
+    if(count > (uint64_t)(end - pos))
+      throw TCEXCEPT("The binary control is truncated");
+    val = Json::Value(Json::arrayValue);
+    val.resize((Json::ArrayIndex)count);
+    for(Json::ArrayIndex i = 0; i < count; i++)
+      DecodeValue(pos, end, depth + 1, val[i]);
+    break;
+  }
+  case TAG_OBJECT:
+  {
+    uint64_t count = GetVarint(pos, end);
+    if(count > (uint64_t)(end - pos))
+      throw TCEXCEPT("The binary control is truncated");
+    val = Json::Value(Json::objectValue);
+    string key;
+    for(uint64_t i = 0; i < count; i++)
+    {
+      uint64_t ki = GetVarint(pos, end);
+      if(ki == 0)
+        GetBytes(pos, end, key);
+      else if(ki <= kKeyCount)
+        key = kKeys[ki - 1];
+      else
+        throw TCEXCEPT("The binary control has an unknown key");
+      DecodeValue(pos, end, depth + 1, val[key]);
+    }
+    break;
+  }
+  default:
+    throw TCEXCEPT("The binary control has an invalid value tag");
+  }
+}
+} // namespace tincan
@@ -30,31 +30,87 @@ namespace tincan
 using namespace rtc;
 ControlDispatch::ControlDispatch() :
   dtol_(nullptr),
-  ctrl_link_(new DisconnectedControllerHandle())
+  ctrl_link_(&disc_link_)
 {
   control_map_ = {
+    { "ConfigureLatencyStats", &ControlDispatch::ConfigureLatencyStats },
     { "ConfigureLogging", &ControlDispatch::ConfigureLogging },
+    { "ConfigureReplication", &ControlDispatch::ConfigureReplication },
     { "CreateCtrlRespLink", &ControlDispatch::CreateIpopControllerRespLink },
     { "CreateLink", &ControlDispatch::CreateLink },
+    { "CreateLinks", &ControlDispatch::CreateLinks },
     { "CreateTunnel", &ControlDispatch::CreateTunnel },
     { "Echo", &ControlDispatch::Echo },
     { "SendIcc", &ControlDispatch::SendIcc },
     { "InjectFrame", &ControlDispatch::InjectFrame },
     { "QueryCandidateAddressSet", &ControlDispatch::QueryCandidateAddressSet },
+    { "QueryLatencyStats", &ControlDispatch::QueryLatencyStats },
     { "QueryLinkStats", &ControlDispatch::QueryLinkStats },
     { "QueryTunnelInfo", &ControlDispatch::QueryTunnelInfo },
     { "RemoveTunnel", &ControlDispatch::RemoveTunnel },
     { "RemoveLink", &ControlDispatch::RemoveLink },
+    { "RemoveLinks", &ControlDispatch::RemoveLinks },
+    { "SubscribeLinkStats", &ControlDispatch::SubscribeLinkStats },
     { "UpdateMap", &ControlDispatch::UpdateRouteTable },
+    { "UpdateIp4Routes", &ControlDispatch::UpdateIp4RouteTable },
+    { "UpdateBroadcastTree", &ControlDispatch::UpdateBroadcastTree },
   };
+  for(uint32_t i = 0; i < kWorkerCount; i++)
+  {
+    workers_.push_back(make_unique<Thread>());
+    workers_.back()->Start();
+  }
 }
 ControlDispatch::~ControlDispatch()
 {
+  for(auto & worker : workers_)
+  {
+    worker->Stop();
+    worker->Clear(this);
+  }
   LogMessage::RemoveLogToStream(log_sink_.get());
 }
 
 void
 ControlDispatch::operator () (TincanControl & control)
+{
+  if(control.GetControlType() == TincanControl::CTTincanRequest)
+  {
+    //queries across several tunnels run on the worker of the first one
+    const Json::Value & req = control.GetRequest();
+    const Json::Value & tnl_id = req.isMember(TincanControl::TunnelId) ?
+      req[TincanControl::TunnelId] : req["TunnelIds"][0u];
+    if(!tnl_id.isNull())
+    {
+      WorkerFor(tnl_id.asString()).Post(RTC_FROM_HERE, this, MSGID_CONTROL,
+        new ControlMsgData(move(control)));
+      return;
+    }
+  }
+  Execute(control);
+}
+
+void
+ControlDispatch::OnMessage(
+  Message * msg)
+{
+  if(msg->message_id == MSGID_CONTROL)
+  {
+    ControlMsgData * md = static_cast<ControlMsgData*>(msg->pdata);
+    Execute(md->ctrl);
+    delete md;
+  }
+}
+
+Thread &
+ControlDispatch::WorkerFor(
+  const string & tnl_id)
+{
+  return *workers_[hash<string>{}(tnl_id) % workers_.size()];
+}
+
+void
+ControlDispatch::Execute(TincanControl & control)
 {
   try {
     switch(control.GetControlType()) {
@@ -91,6 +147,27 @@ ControlDispatch::SetDispatchToListenerInf(
   dtol_ = dtol;
 }
 
+void
+ControlDispatch::ConfigureLatencyStats(
+  TincanControl & control)
+{
+  Json::Value & req = control.GetRequest();
+  string msg = "ConfigureLatencyStats failed.";
+  bool status = false;
+  try
+  {
+    tincan_->ConfigureLatencyStats(req);
+    msg = "ConfigureLatencyStats succeeded.";
+    status = true;
+  } catch(exception & e)
+  {
+    LOG(LS_WARNING) << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+  }
+  control.SetResponse(msg, status);
+  ControllerLink().Deliver(control);
+}
+
 void
 ControlDispatch::ConfigureLogging(
   TincanControl & control)
@@ -142,7 +219,28 @@ ControlDispatch::ConfigureLogging(
     status = false;
   }
   control.SetResponse(msg, status);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
+}
+
+void
+ControlDispatch::ConfigureReplication(
+  TincanControl & control)
+{
+  Json::Value & req = control.GetRequest();
+  string msg = "ConfigureReplication failed.";
+  bool status = false;
+  try
+  {
+    tincan_->ConfigureReplication(req);
+    msg = "ConfigureReplication succeeded.";
+    status = true;
+  } catch(exception & e)
+  {
+    LOG(LS_WARNING) << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+  }
+  control.SetResponse(msg, status);
+  ControllerLink().Deliver(control);
 }
 
 void
@@ -152,7 +250,6 @@ ControlDispatch::CreateLink(
   Json::Value & req = control.GetRequest();
   string msg("Connection to peer node in progress.");
   bool status = false;
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->CreateVlink(req, control);
@@ -166,10 +263,27 @@ ControlDispatch::CreateLink(
   if(!status)
   {
     control.SetResponse(msg, status);
-    ctrl_link_->Deliver(control);
+    ControllerLink().Deliver(control);
   } //else respond when CAS is available
 }
 
+void
+ControlDispatch::CreateLinks(
+  TincanControl & control)
+{
+  Json::Value & req = control.GetRequest();
+  try
+  {
+    tincan_->CreateVlinks(req, control);
+  } catch(exception & e)
+  {
+    LOG(LS_WARNING) << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+    control.SetResponse("CreateLinks failed.", false);
+    ControllerLink().Deliver(control);
+  } //else respond when the CAS of every link is available
+}
+
 void ControlDispatch::CreateIpopControllerRespLink(
   TincanControl & control)
 {
@@ -177,16 +291,14 @@ void ControlDispatch::CreateIpopControllerRespLink(
   string ip = req["IP"].asString();
   int port = req["Port"].asInt();
   string msg("Controller endpoint successfully created.");
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     unique_ptr<SocketAddress> ctrl_addr(new SocketAddress(ip, port));
     dtol_->CreateIpopControllerLink(move(ctrl_addr));
-    delete ctrl_link_;
     ctrl_link_ = &dtol_->GetIpopControllerLink();
     tincan_->SetIpopControllerLink(ctrl_link_);
     control.SetResponse(msg, true);
-    ctrl_link_->Deliver(control);
+    ControllerLink().Deliver(control);
   }
   catch(exception & e)
   {
@@ -203,7 +315,6 @@ ControlDispatch::CreateTunnel(
 {
   Json::Value & req = control.GetRequest();
   unique_ptr<Json::Value> resp = make_unique<Json::Value>(Json::objectValue);
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->CreateTunnel(req, (*resp)["Message"]);
@@ -217,7 +328,7 @@ ControlDispatch::CreateTunnel(
     (*resp)["Success"] = false;
   }
   control.SetResponse(move(resp));
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
 }
 
 void ControlDispatch::Echo(TincanControl & control)
@@ -226,7 +337,7 @@ void ControlDispatch::Echo(TincanControl & control)
   string msg = req[TincanControl::Message].asString();
   control.SetResponse(msg, true);
   control.SetControlType(TincanControl::CTTincanResponse);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
 }
 
 LoggingSeverity
@@ -234,7 +345,6 @@ ControlDispatch::GetLogLevel(
   const string & log_level)
 {
   LoggingSeverity lv = LS_WARNING;
-  lock_guard<mutex> lg(disp_mutex_);
   if (log_level == "NONE")
     lv = rtc::LS_NONE;
   else if (log_level == "ERROR")
@@ -262,7 +372,6 @@ ControlDispatch::InjectFrame(
   Json::Value & req = control.GetRequest();
   string msg = "InjectFrame failed.";
   bool status = false;
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->InjectFrame(req);
@@ -274,7 +383,7 @@ ControlDispatch::InjectFrame(
       control.StyledString();
   }
   control.SetResponse(msg, status);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
 }
 
 void
@@ -284,7 +393,6 @@ ControlDispatch::QueryCandidateAddressSet(
   Json::Value & req = control.GetRequest(), cas_info;
   string resp;
   bool status = false;
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->QueryLinkCas(req, cas_info);
@@ -297,7 +405,30 @@ ControlDispatch::QueryCandidateAddressSet(
       control.StyledString();
   }
   control.SetResponse(resp, status);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
+}
+
+void
+ControlDispatch::QueryLatencyStats(
+  TincanControl & control)
+{
+  Json::Value & req = control.GetRequest();
+  unique_ptr<Json::Value> resp = make_unique<Json::Value>(Json::objectValue);
+  (*resp)["Success"] = false;
+  try
+  {
+    tincan_->QueryLatencyStats(req, (*resp)["Message"]);
+    (*resp)["Success"] = true;
+  } catch(exception & e)
+  {
+    string er_msg = "The QueryLatencyStats operation failed. ";
+    LOG(LS_WARNING) << er_msg << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+    (*resp)["Message"] = er_msg;
+    (*resp)["Success"] = false;
+  }
+  control.SetResponse(move(resp));
+  ControllerLink().Deliver(control);
 }
 
 void
@@ -307,7 +438,6 @@ ControlDispatch::QueryLinkStats(
   Json::Value & req = control.GetRequest();
   unique_ptr<Json::Value> resp = make_unique<Json::Value>(Json::objectValue);
   (*resp)["Success"] = false;
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->QueryLinkStats(req, (*resp)["Message"]);
@@ -321,7 +451,7 @@ ControlDispatch::QueryLinkStats(
     (*resp)["Success"] = false;
   }
   control.SetResponse(move(resp));
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
 }
 
 void
@@ -331,7 +461,6 @@ ControlDispatch::QueryTunnelInfo(
   Json::Value & req = control.GetRequest(), node_info;
   string resp("The QueryTunnelInfo operation succeeded");
   bool status = false;
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->QueryTunnelInfo(req, node_info);
@@ -345,7 +474,7 @@ ControlDispatch::QueryTunnelInfo(
       control.StyledString();
   }
   control.SetResponse(resp, status);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
 }
 
 
@@ -356,7 +485,6 @@ ControlDispatch::RemoveLink(
   bool status = false;
   Json::Value & req = control.GetRequest();
   string msg("The RemoveLink operation succeeded");
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->RemoveVlink(req);
@@ -368,7 +496,29 @@ ControlDispatch::RemoveLink(
       control.StyledString();
   }
   control.SetResponse(msg, status);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
+}
+
+void
+ControlDispatch::RemoveLinks(
+  TincanControl & control)
+{
+  Json::Value & req = control.GetRequest();
+  unique_ptr<Json::Value> resp = make_unique<Json::Value>(Json::objectValue);
+  try
+  {
+    tincan_->RemoveVlinks(req, (*resp)["Message"]);
+    (*resp)["Success"] = true;
+  } catch(exception & e)
+  {
+    string er_msg = "The RemoveLinks operation failed.";
+    LOG(LS_WARNING) << er_msg << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+    (*resp)["Message"] = er_msg;
+    (*resp)["Success"] = false;
+  }
+  control.SetResponse(move(resp));
+  ControllerLink().Deliver(control);
 }
 
 void
@@ -378,7 +528,6 @@ ControlDispatch::RemoveTunnel(
   bool status = false;
   Json::Value & req = control.GetRequest();
   string msg("The RemoveTunnel operation ");
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->RemoveTunnel(req);
@@ -391,7 +540,7 @@ ControlDispatch::RemoveTunnel(
       control.StyledString();
   }
   control.SetResponse(msg, status);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
 }
 
 void
@@ -400,7 +549,6 @@ ControlDispatch::SendIcc(
 {
   Json::Value & req = control.GetRequest();
   string msg("The ICC operation succeeded");
-  lock_guard<mutex> lg(disp_mutex_);
   try
   {
     tincan_->SendIcc(req);
@@ -410,29 +558,93 @@ ControlDispatch::SendIcc(
     LOG(LS_WARNING) << e.what() << ". Control Data=\n" <<
       control.StyledString();
     control.SetResponse(msg, false);
-    ctrl_link_->Deliver(control);
+    ControllerLink().Deliver(control);
   }
 }
 
 void
-ControlDispatch::UpdateRouteTable(
+ControlDispatch::SubscribeLinkStats(
   TincanControl & control)
 {
+  Json::Value & req = control.GetRequest();
+  string msg = "SubscribeLinkStats failed.";
   bool status = false;
+  try
+  {
+    tincan_->SubscribeLinkStats(req);
+    msg = "SubscribeLinkStats succeeded.";
+    status = true;
+  } catch(exception & e)
+  {
+    LOG(LS_WARNING) << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+  }
+  control.SetResponse(msg, status);
+  ControllerLink().Deliver(control);
+}
+
+void
+ControlDispatch::UpdateRouteTable(
+  TincanControl & control)
+{
+  Json::Value & req = control.GetRequest();
+  unique_ptr<Json::Value> resp = make_unique<Json::Value>(Json::objectValue);
+  try
+  {
+    tincan_->UpdateRouteTable(req, (*resp)["Message"]);
+    (*resp)["Success"] = true;
+  } catch(exception & e)
+  {
+    string er_msg = "The Update Routes operation failed. ";
+    LOG(LS_WARNING) << er_msg << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+    (*resp)["Message"] = er_msg;
+    (*resp)["Success"] = false;
+  }
+  control.SetResponse(move(resp));
+  ControllerLink().Deliver(control);
+}
+
+void
+ControlDispatch::UpdateIp4RouteTable(
+  TincanControl & control)
+{
   Json::Value & req = control.GetRequest();
-  string msg = "The Add Routes operation failed.";
-  lock_guard<mutex> lg(disp_mutex_);
+  unique_ptr<Json::Value> resp = make_unique<Json::Value>(Json::objectValue);
+  try
+  {
+    tincan_->UpdateIp4RouteTable(req, (*resp)["Message"]);
+    (*resp)["Success"] = true;
+  } catch(exception & e)
+  {
+    string er_msg = "The Update IP4 Routes operation failed. ";
+    LOG(LS_WARNING) << er_msg << e.what() << ". Control Data=\n" <<
+      control.StyledString();
+    (*resp)["Message"] = er_msg;
+    (*resp)["Success"] = false;
+  }
+  control.SetResponse(move(resp));
+  ControllerLink().Deliver(control);
+}
+
+void
+ControlDispatch::UpdateBroadcastTree(
+  TincanControl & control)
+{
+  Json::Value & req = control.GetRequest();
+  string msg = "UpdateBroadcastTree failed.";
+  bool status = false;
   try
   {
-    tincan_->UpdateRouteTable(req);
+    tincan_->UpdateBroadcastTree(req);
+    msg = "UpdateBroadcastTree succeeded.";
     status = true;
-    msg = "The Add Routes opertation completed successfully.";
   } catch(exception & e)
   {
     LOG(LS_WARNING) << e.what() << ". Control Data=\n" <<
       control.StyledString();
   }
   control.SetResponse(msg, status);
-  ctrl_link_->Deliver(control);
+  ControllerLink().Deliver(control);
 }
 }  // namespace tincan
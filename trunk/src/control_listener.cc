@@ -22,13 +22,15 @@
 */
 #include "webrtc/base/nethelpers.h"
 #include "control_listener.h"
+#include "control_codec.h"
 #include "tincan_exception.h"
 namespace tincan
 {
 using namespace rtc;
 ControlListener::ControlListener(unique_ptr<ControlDispatch> control_dispatch):
   ctrl_dispatch_(move(control_dispatch)),
-  packet_options_(DSCP_DEFAULT)
+  packet_options_(DSCP_DEFAULT),
+  proto_ver_(tp.kTincanControlVer)
 {
   ctrl_dispatch_->SetDispatchToListenerInf(this);
 }
@@ -47,11 +49,13 @@ ControlListener::ReadPacketHandler(
   try {
     TincanControl ctrl(data, len);
     LOG(LS_INFO) << "Received CONTROL: " << ctrl.StyledString();
+    proto_ver_ = ctrl.GetProtocolVersion();
     (*ctrl_dispatch_)(ctrl);
   }
   catch(exception & e) {
     LOG(LS_WARNING) << "A control failed to execute." << endl
-      << string(data, len) << endl
+      << (ControlCodec::IsBinary(data, len) ?
+        ByteArrayToString(data, data + len) : string(data, len)) << endl
       << e.what();
   }
 }
@@ -61,8 +65,11 @@ void
 ControlListener::Deliver(
   TincanControl & ctrl_resp)
 {
-  std::string msg = ctrl_resp.StyledString();
-  LOG(LS_INFO) << "Sending CONTROL: " << msg;
+  if(ctrl_resp.GetControlType() == TincanControl::CTTincanRequest)
+    ctrl_resp.SetProtocolVersion(proto_ver_);
+  LOG(LS_INFO) << "Sending CONTROL: " << ctrl_resp.StyledString();
+  std::string msg;
+  ctrl_resp.Serialize(msg);
   lock_guard<mutex> lg(skt_mutex_);
   snd_socket_->SendTo(msg.c_str(), msg.length(), *ctrl_addr_, packet_options_);
 }
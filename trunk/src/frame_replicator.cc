@@ -0,0 +1,115 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "frame_replicator.h"
+#include <algorithm>
+namespace tincan
+{
+TokenBucket::TokenBucket(
+  double rate,
+  double burst) :
+  rate_(rate),
+  burst_(burst),
+  tokens_(burst),
+  last_(steady_clock::now())
+{}
+
+bool
+TokenBucket::Consume()
+{
+  steady_clock::time_point now = steady_clock::now();
+  std::chrono::duration<double> elapsed = now - last_;
+  last_ = now;
+  tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+  if(tokens_ < 1)
+    return false;
+  tokens_ -= 1;
+  return true;
+}
+
+FrameReplicator::FrameReplicator() :
+  enabled_(false),
+  stats_{ 0, 0, 0 }
+{}
+
+void
+FrameReplicator::Configure(
+  bool enabled,
+  const ReplicationPolicy & default_policy,
+  const map<MacAddressType, ReplicationPolicy> & groups)
+{
+  lock_guard<mutex> lg(mtx_);
+  enabled_ = enabled;
+  default_group_.policy = default_policy;
+  default_group_.bucket = TokenBucket(default_policy.rate,
+    default_policy.burst);
+  groups_.clear();
+  for(auto & grp : groups)
+  {
+    ReplicationGroup & rg = groups_[grp.first];
+    rg.policy = grp.second;
+    rg.bucket = TokenBucket(grp.second.rate, grp.second.burst);
+  }
+}
+
+bool
+FrameReplicator::IsEnabled()
+{
+  lock_guard<mutex> lg(mtx_);
+  return enabled_;
+}
+
+bool
+FrameReplicator::Admit(
+  const MacAddressType & group,
+  vector<MacAddressType> & peers)
+{
+  lock_guard<mutex> lg(mtx_);
+  if(!enabled_)
+    return false;
+  auto itr = groups_.find(group);
+  ReplicationGroup & rg = itr != groups_.end() ? itr->second : default_group_;
+  if(!rg.bucket.Consume())
+  {
+    stats_.rate_limited++;
+    return false;
+  }
+  peers = rg.policy.peers;
+  return true;
+}
+
+void
+FrameReplicator::Replicated(
+  size_t copies)
+{
+  lock_guard<mutex> lg(mtx_);
+  stats_.frames++;
+  stats_.copies += copies;
+}
+
+ReplicationStats
+FrameReplicator::Stats()
+{
+  lock_guard<mutex> lg(mtx_);
+  return stats_;
+}
+} // namespace tincan
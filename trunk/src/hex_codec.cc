@@ -0,0 +1,164 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "hex_codec.h"
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TINCAN_HEX_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+namespace tincan
+{
+const int8_t kHexDigitValue[256] =
+{
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+   0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+const char kHexPairsUpper[513] =
+  "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+  "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+  "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+  "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+  "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+  "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+  "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+  "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+const char kHexPairsLower[513] =
+  "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+  "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+  "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+  "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+  "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+  "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+  "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+  "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+/*
+Each byte is split into its nibbles, which are interleaved so the high nibble
+comes first, and each nibble is mapped to its digit by adding '0' and, for
+values above 9, the distance from '9' to 'A' or 'a'.
+*/
+void
+HexEncode(
+  const uint8_t * src,
+  size_t len,
+  char * dst,
+  bool uppercase)
+{
+  size_t i = 0;
+#if defined(TINCAN_HEX_CODEC_SSE2)
+  const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+  const __m128i nine = _mm_set1_epi8(9);
+  const __m128i zero_char = _mm_set1_epi8('0');
+  const __m128i alpha_adj = _mm_set1_epi8(uppercase ? 'A' - '9' - 1 :
+    'a' - '9' - 1);
+  for(; i + 16 <= len; i += 16)
+  {
+    __m128i in = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), nibble_mask);
+    __m128i lo = _mm_and_si128(in, nibble_mask);
+    __m128i first = _mm_unpacklo_epi8(hi, lo);
+    __m128i second = _mm_unpackhi_epi8(hi, lo);
+    first = _mm_add_epi8(_mm_add_epi8(first, zero_char),
+      _mm_and_si128(_mm_cmpgt_epi8(first, nine), alpha_adj));
+    second = _mm_add_epi8(_mm_add_epi8(second, zero_char),
+      _mm_and_si128(_mm_cmpgt_epi8(second, nine), alpha_adj));
+    _mm_storeu_si128((__m128i*)(dst + 2 * i), first);
+    _mm_storeu_si128((__m128i*)(dst + 2 * i + 16), second);
+  }
+#endif // TINCAN_HEX_CODEC_SSE2
+  const char * pairs = uppercase ? kHexPairsUpper : kHexPairsLower;
+  for(; i < len; i++)
+    memcpy(dst + 2 * i, pairs + 2 * src[i], 2);
+}
+
+/*
+A block of 16 digits is validated and converted to nibble values in parallel.
+Each pair of nibbles, loaded as a 16 bit lane with the high nibble in the low
+byte, is combined and the lanes are narrowed to 8 bytes. A block containing an
+invalid digit is left to the scalar loop, which stops at the offending pair.
+*/
+size_t
+HexDecode(
+  const char * src,
+  size_t src_len,
+  uint8_t * dst,
+  size_t dst_len)
+{
+  size_t out = 0;
+  size_t in = 0;
+#if defined(TINCAN_HEX_CODEC_SSE2)
+  const __m128i minus_one = _mm_set1_epi8(-1);
+  const __m128i ten = _mm_set1_epi8(10);
+  const __m128i six = _mm_set1_epi8(6);
+  const __m128i lower_bit = _mm_set1_epi8(0x20);
+  const __m128i low_byte = _mm_set1_epi16(0x00FF);
+  for(; in + 16 <= src_len && out + 8 <= dst_len; in += 16, out += 8)
+  {
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + in));
+    __m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(d, minus_one),
+      _mm_cmplt_epi8(d, ten));
+    __m128i l = _mm_sub_epi8(_mm_or_si128(c, lower_bit), _mm_set1_epi8('a'));
+    __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(l, minus_one),
+      _mm_cmplt_epi8(l, six));
+    if(_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xFFFF)
+      break;
+    __m128i v = _mm_or_si128(_mm_and_si128(is_digit, d),
+      _mm_and_si128(is_alpha, _mm_add_epi8(l, ten)));
+    __m128i bytes = _mm_or_si128(
+      _mm_slli_epi16(_mm_and_si128(v, low_byte), 4), _mm_srli_epi16(v, 8));
+    _mm_storel_epi64((__m128i*)(dst + out),
+      _mm_packus_epi16(bytes, _mm_setzero_si128()));
+  }
+#endif // TINCAN_HEX_CODEC_SSE2
+  for(; in + 2 <= src_len && out < dst_len; in += 2, out++)
+  {
+    int8_t hi = kHexDigitValue[(uint8_t)src[in]];
+    int8_t lo = kHexDigitValue[(uint8_t)src[in + 1]];
+    if(hi < 0 || lo < 0)
+      return out;
+    dst[out] = (uint8_t)(hi << 4 | lo);
+  }
+  if(in + 1 == src_len && out < dst_len &&
+    kHexDigitValue[(uint8_t)src[in]] >= 0)
+    dst[out++] = (uint8_t)kHexDigitValue[(uint8_t)src[in]];
+  return out;
+}
+} // namespace tincan
@@ -0,0 +1,194 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#if !defined(_IPOP_WIN)
+#include "icc_channel.h"
+#include "tincan_exception.h"
+namespace tincan
+{
+IccChannel::IccChannel(
+  TincanDispatchInterface & tincan,
+  const string & socket_path) :
+  UnixStreamServer(socket_path),
+  tincan_(tincan),
+  thread_(nullptr),
+  dropped_(0)
+{}
+
+IccChannel::~IccChannel()
+{}
+
+/*
+Passes each complete ICC to its tunnel, and each run of frame injections to a
+tunnel as a batch. The injected frames are passed
+in place in the receive buffer. A malformed frame ends the connection as the
+stream can no longer be trusted.
+*/
+void
+IccChannel::OnReceived(
+  string & rcv_buf)
+{
+  size_t pos = 0;
+  string tnl_id, link_id, data;
+  string inj_tnl_id;
+  vector<pair<const uint8_t *, uint32_t>> inj_frames;
+  while(rcv_buf.size() - pos >= kFrameHeaderSize)
+  {
+    const uint8_t * hdr = (const uint8_t*)rcv_buf.data() + pos;
+    uint32_t len = (uint32_t)hdr[0] << 24 | (uint32_t)hdr[1] << 16 |
+      (uint32_t)hdr[2] << 8 | hdr[3];
+    if(len > kMaxFrameSize || len < kFrameHeaderSize - 4 + hdr[5] + hdr[6] ||
+      (hdr[4] != kIccFrame && hdr[4] != kInjectFrame))
+    {
+      LOG(LS_WARNING) << "Malformed ICC frame, closing the ICC connection";
+      CloseConnection();
+      return;
+    }
+    if(rcv_buf.size() - pos - 4 < len)
+      break;
+    const char * body = rcv_buf.data() + pos + kFrameHeaderSize;
+    const char * payload = body + hdr[5] + hdr[6];
+    uint32_t payload_len = len - (kFrameHeaderSize - 4) - hdr[5] - hdr[6];
+    tnl_id.assign(body, hdr[5]);
+    if(!inj_frames.empty() && (hdr[4] != kInjectFrame || tnl_id != inj_tnl_id))
+      InjectFrames(inj_tnl_id, inj_frames);
+    if(hdr[4] == kInjectFrame && payload_len > TincanParameters::kEthernetSize)
+    {
+      LOG(LS_WARNING) << "An injected frame of " << payload_len
+        << " bytes exceeds the maximum, it was discarded";
+    }
+    else if(hdr[4] == kInjectFrame)
+    {
+      inj_tnl_id.swap(tnl_id);
+      inj_frames.emplace_back((const uint8_t*)payload, payload_len);
+    }
+    else
+    {
+      link_id.assign(body + hdr[5], hdr[6]);
+      data.assign(payload, payload_len);
+      try {
+        tincan_.SendIcc(tnl_id, link_id, data);
+      }
+      catch(exception & e) {
+        LOG(LS_WARNING) << "Sending an ICC on vlink " << link_id
+          << " failed. " << e.what();
+      }
+    }
+    pos += 4 + len;
+  }
+  if(!inj_frames.empty())
+    InjectFrames(inj_tnl_id, inj_frames);
+  rcv_buf.erase(0, pos);
+}
+
+void
+IccChannel::InjectFrames(
+  const string & tnl_id,
+  vector<pair<const uint8_t *, uint32_t>> & frames)
+{
+  try {
+    tincan_.InjectFrames(tnl_id, frames);
+  }
+  catch(exception & e) {
+    LOG(LS_WARNING) << "Injecting " << frames.size() << " frames failed. "
+      << e.what();
+  }
+  frames.clear();
+}
+
+void
+IccChannel::OnClosed()
+{
+  snd_buf_.clear();
+}
+
+/*
+Frames the ICC into the send buffer. The first ICC into an empty buffer
+schedules a flush, any that follow before it runs go out in the same write.
+*/
+bool
+IccChannel::DeliverIcc(
+  const string & tnl_id,
+  const string & link_id,
+  const uint8_t * data,
+  uint32_t len)
+{
+  if(tnl_id.length() > 255 || link_id.length() > 255)
+    return false;
+  uint32_t frm_len = (uint32_t)(kFrameHeaderSize - 4 + tnl_id.length() +
+    link_id.length() + len);
+  uint8_t hdr[kFrameHeaderSize] = { (uint8_t)(frm_len >> 24),
+    (uint8_t)(frm_len >> 16), (uint8_t)(frm_len >> 8), (uint8_t)frm_len,
+    kIccFrame, (uint8_t)tnl_id.length(), (uint8_t)link_id.length(), 0 };
+  lock_guard<mutex> lg(conn_mutex_);
+  if(conn_fd_ == -1)
+    return false;
+  if(snd_buf_.size() + 4 + frm_len > kMaxPending)
+  {
+    if(dropped_++ % 1000 == 0)
+      LOG(LS_WARNING) << "The ICC channel is backed up, " << dropped_
+        << " ICCs dropped";
+    return true;
+  }
+  bool flush = snd_buf_.empty();
+  snd_buf_.append((const char*)hdr, sizeof(hdr));
+  snd_buf_.append(tnl_id);
+  snd_buf_.append(link_id);
+  snd_buf_.append((const char*)data, len);
+  if(flush)
+    thread_->Post(RTC_FROM_HERE, this, MSGID_FLUSH);
+  return true;
+}
+
+void
+IccChannel::Flush()
+{
+  string buf;
+  {
+    lock_guard<mutex> lg(conn_mutex_);
+    buf.swap(snd_buf_);
+  }
+  //the connection is only replaced on this thread, it is written without the
+  //lock so the tunnels are not held up by a slow controller
+  if(conn_fd_ != -1 && !Send(buf.data(), buf.length()))
+    CloseConnection();
+}
+
+void
+IccChannel::OnMessage(
+  Message * msg)
+{
+  if(msg->message_id == MSGID_FLUSH)
+    Flush();
+}
+
+void
+IccChannel::Run(
+  Thread * thread)
+{
+  thread_ = thread;
+  Listen(thread);
+  LOG(LS_INFO) << "Tincan ICC channel listening on " << socket_path_;
+  thread->ProcessMessages(-1); //run until stopped
+}
+}  // namespace tincan
+#endif  // !_IPOP_WIN
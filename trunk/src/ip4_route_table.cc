@@ -0,0 +1,172 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "ip4_route_table.h"
+#include <algorithm>
+namespace tincan
+{
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+/*
+Prefixes are inserted shortest first so that each longer prefix overwrites the
+range it covers, and groups are only ever created below entries that already
+hold the result of the shorter prefixes.
+*/
+Ip4RouteTable::Lpm::Lpm(
+  const map<pair<uint32_t, uint8_t>, MacAddressType> & routes) :
+  tbl16_(1 << 16, 0)
+{
+  vector<map<pair<uint32_t, uint8_t>, MacAddressType>::const_iterator> order;
+  order.reserve(routes.size());
+  for(auto itr = routes.begin(); itr != routes.end(); ++itr)
+    order.push_back(itr);
+  std::stable_sort(order.begin(), order.end(),
+    [](const map<pair<uint32_t, uint8_t>, MacAddressType>::const_iterator & a,
+      const map<pair<uint32_t, uint8_t>, MacAddressType>::const_iterator & b)
+  {
+    return a->first.second < b->first.second;
+  });
+  map<MacAddressType, uint32_t> nh_index;
+  for(auto & rt : order)
+  {
+    uint32_t prefix = rt->first.first;
+    uint8_t length = rt->first.second;
+    auto nh = nh_index.emplace(rt->second, (uint32_t)next_hops_.size() + 1);
+    if(nh.second)
+      next_hops_.push_back(rt->second);
+    uint32_t val = nh.first->second;
+    if(length <= 16)
+    {
+      Fill(tbl16_, prefix >> 16, (size_t)1 << (16 - length), val);
+      continue;
+    }
+    uint32_t grp = Expand(tbl16_, prefix >> 16);
+    size_t idx = ((size_t)grp << 8) | ((prefix >> 8) & 0xFF);
+    if(length <= 24)
+    {
+      Fill(tbl8_, idx, (size_t)1 << (24 - length), val);
+      continue;
+    }
+    grp = Expand(tbl8_, idx);
+    idx = ((size_t)grp << 8) | (prefix & 0xFF);
+    Fill(tbl8_, idx, (size_t)1 << (32 - length), val);
+  }
+}
+
+uint32_t
+Ip4RouteTable::Lpm::Expand(
+  vector<uint32_t> & tbl,
+  size_t idx)
+{
+  if(tbl[idx] & kGroup)
+    return tbl[idx] & ~kGroup;
+  uint32_t grp = (uint32_t)(tbl8_.size() >> 8);
+  uint32_t val = tbl[idx];
+  //tbl may be tbl8_ itself, so it is only indexed after the resize
+  tbl8_.resize(tbl8_.size() + 256, val);
+  tbl[idx] = grp | kGroup;
+  return grp;
+}
+
+void
+Ip4RouteTable::Lpm::Fill(
+  vector<uint32_t> & tbl,
+  size_t first,
+  size_t count,
+  uint32_t val)
+{
+  std::fill(tbl.begin() + first, tbl.begin() + first + count, val);
+}
+
+Ip4RouteTable::Ip4RouteTable()
+{}
+
+Ip4RouteUpdateStats
+Ip4RouteTable::Update(
+  const vector<Ip4RouteUpdate> & updates,
+  bool replace)
+{
+  Ip4RouteUpdateStats rus = { 0, 0, 0, 0, microseconds(0) };
+  lock_guard<mutex> lg(update_mtx_);
+  steady_clock::time_point start = steady_clock::now();
+  if(replace)
+    routes_.clear();
+  for(auto & ru : updates)
+  {
+    if(ru.length > 32)
+    {
+      rus.rejected++;
+      continue;
+    }
+    uint32_t mask = ru.length ? 0xFFFFFFFF << (32 - ru.length) : 0;
+    pair<uint32_t, uint8_t> key(ru.prefix & mask, ru.length);
+    if(ru.remove)
+    {
+      if(routes_.erase(key))
+        rus.removed++;
+      else
+        rus.rejected++;
+      continue;
+    }
+    routes_[key] = ru.path;
+    rus.added++;
+  }
+  shared_ptr<const Lpm> lpm = make_shared<const Lpm>(routes_);
+  std::atomic_store(&lpm_, lpm);
+  rus.routes = (uint32_t)routes_.size();
+  rus.build_time = duration_cast<microseconds>(steady_clock::now() - start);
+  return rus;
+}
+
+bool
+Ip4RouteTable::Lookup(
+  const IP4AddressType & ip4,
+  MacAddressType & path) const
+{
+  shared_ptr<const Lpm> lpm = std::atomic_load(&lpm_);
+  if(!lpm)
+    return false;
+  uint32_t addr = (uint32_t)ip4[0] << 24 | (uint32_t)ip4[1] << 16 |
+    (uint32_t)ip4[2] << 8 | (uint32_t)ip4[3];
+  uint32_t ent = lpm->Lookup(addr);
+  if(!ent)
+    return false;
+  path = lpm->NextHop(ent);
+  return true;
+}
+
+void
+Ip4RouteTable::Clear()
+{
+  lock_guard<mutex> lg(update_mtx_);
+  routes_.clear();
+  std::atomic_store(&lpm_, shared_ptr<const Lpm>());
+}
+
+size_t
+Ip4RouteTable::Size()
+{
+  lock_guard<mutex> lg(update_mtx_);
+  return routes_.size();
+}
+} // namespace tincan
@@ -0,0 +1,126 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "latency_stats.h"
+namespace tincan
+{
+const char * const kPipelineStageNames[PS_COUNT] =
+{
+  "TapToNet",
+  "DtlsSend",
+  "VlinkToTap",
+  "TapWrite",
+  "Egress",
+  "Ingress",
+};
+
+LatencyHistogram::LatencyHistogram() :
+  sum_(0),
+  reset_(false)
+{
+  for(auto & count : counts_)
+    count.store(0, std::memory_order_relaxed);
+}
+
+//The request is taken before the counts are cleared, so a reset requested
+//while they are being cleared is carried out with the next record
+void
+LatencyHistogram::Clear()
+{
+  reset_.store(false, std::memory_order_relaxed);
+  for(auto & count : counts_)
+    count.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t
+LatencyHistogram::BucketValue(
+  uint32_t index)
+{
+  if(index < kSubBuckets)
+    return index;
+  uint32_t shift = index / kSubBuckets - 1;
+  uint64_t sub = index % kSubBuckets + kSubBuckets;
+  return ((sub + 1) << shift) - 1;
+}
+
+/*
+Works on a copy of the counts so the results are consistent with each other
+while the writer carries on.
+*/
+void
+LatencyHistogram::Query(
+  Json::Value & stats) const
+{
+  static const double kPercentiles[] = { 50, 90, 99, 99.9 };
+  static const char * const kNames[] = { "P50", "P90", "P99", "P999" };
+  array<uint64_t, kBucketCount> counts;
+  uint64_t total = 0;
+  bool reset = reset_.load(std::memory_order_relaxed);
+  for(uint32_t i = 0; i < kBucketCount; i++)
+  {
+    counts[i] = reset ? 0 : counts_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  uint64_t sum = reset ? 0 : sum_.load(std::memory_order_relaxed);
+  stats["Count"] = (Json::UInt64)total;
+  stats["Mean"] = (Json::UInt64)(total ? sum / total : 0);
+  uint64_t min = 0, max = 0;
+  uint64_t seen = 0;
+  size_t next = 0;
+  for(uint32_t i = 0; i < kBucketCount && total; i++)
+  {
+    if(!counts[i])
+      continue;
+    if(!seen)
+      min = BucketValue(i);
+    max = BucketValue(i);
+    seen += counts[i];
+    for(; next < 4 && seen * 100.0 >= kPercentiles[next] * total; next++)
+      stats[kNames[next]] = (Json::UInt64)max;
+  }
+  for(; next < 4; next++)
+    stats[kNames[next]] = (Json::UInt64)0;
+  stats["Min"] = (Json::UInt64)min;
+  stats["Max"] = (Json::UInt64)max;
+}
+
+void
+StageLatencies::Reset()
+{
+  for(auto & stage : stages)
+    stage.Reset();
+}
+
+void
+StageLatencies::Query(
+  Json::Value & stats) const
+{
+  for(uint32_t i = 0; i < PS_COUNT; i++)
+  {
+    Json::Value stage(Json::objectValue);
+    stages[i].Query(stage);
+    if(stage["Count"].asUInt64())
+      stats[kPipelineStageNames[i]].swap(stage);
+  }
+}
+} // namespace tincan
@@ -0,0 +1,160 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "link_stats_monitor.h"
+#include <set>
+#include "tincan_control.h"
+namespace tincan
+{
+LinkStatsMonitor::LinkStatsMonitor() :
+  interval_(0),
+  threshold_(kDefaultThreshold),
+  next_full_(0)
+{}
+
+void
+LinkStatsMonitor::Configure(
+  uint32_t interval,
+  uint32_t threshold,
+  int64_t now)
+{
+  interval_ = interval;
+  threshold_ = threshold;
+  //a new subscription starts with a full report
+  next_full_ = now;
+  links_.clear();
+}
+
+/*
+The bytes transferred between two samples, taken per connection. The vlink's
+totals are the sums over its current connections, so they drop when one is
+pruned even though traffic flowed on the others. A connection that is new, or
+whose totals restarted, counts with all of its bytes.
+*/
+static void
+Transferred(
+  const LinkStatsSample & prev,
+  const LinkStatsSample & cur,
+  uint64_t & sent,
+  uint64_t & recv)
+{
+  sent = recv = 0;
+  for(auto & cc : cur.connections)
+  {
+    auto pc = std::find_if(prev.connections.begin(), prev.connections.end(),
+      [&cc](const ConnectionBytes & c) { return c.key == cc.key; });
+    bool known = pc != prev.connections.end();
+    sent += known && cc.sent_bytes >= pc->sent_bytes ?
+      cc.sent_bytes - pc->sent_bytes : cc.sent_bytes;
+    recv += known && cc.recv_bytes >= pc->recv_bytes ?
+      cc.recv_bytes - pc->recv_bytes : cc.recv_bytes;
+  }
+}
+
+bool
+LinkStatsMonitor::Update(
+  const vector<pair<string, LinkStatsSample>> & samples,
+  int64_t now,
+  Json::Value & links,
+  bool & full)
+{
+  full = now >= next_full_;
+  if(full)
+    next_full_ = now + interval_;
+  std::set<string> current;
+  for(auto & smp : samples)
+  {
+    current.insert(smp.first);
+    auto itr = links_.find(smp.first);
+    bool added = itr == links_.end();
+    LinkState & ls = links_[smp.first];
+    if(!added && now > ls.at)
+    {
+      uint64_t elapsed = (uint64_t)(now - ls.at);
+      uint64_t sent, recv;
+      Transferred(ls.last, smp.second, sent, recv);
+      ls.sent_rate = sent * 1000 / elapsed;
+      ls.recv_rate = recv * 1000 / elapsed;
+    }
+    ls.last = smp.second;
+    ls.at = now;
+    if(full || added || HasChanged(ls))
+      Report(smp.first, ls, links);
+  }
+  for(auto itr = links_.begin(); itr != links_.end();)
+  {
+    if(current.count(itr->first) == 0)
+    {
+      Json::Value link(Json::objectValue);
+      link[TincanControl::LinkId] = itr->first;
+      link[TincanControl::Status] = "REMOVED";
+      links.append(link);
+      itr = links_.erase(itr);
+    }
+    else
+      itr++;
+  }
+  return links.size() > 0;
+}
+
+bool
+LinkStatsMonitor::Differs(
+  uint64_t reported,
+  uint64_t current,
+  uint64_t floor) const
+{
+  uint64_t delta = reported > current ? reported - current : current - reported;
+  return delta > floor && delta * 100 > reported * threshold_;
+}
+
+bool
+LinkStatsMonitor::HasChanged(
+  const LinkState & ls) const
+{
+  return ls.last.online != ls.reported.online ||
+    ls.last.writable != ls.reported.writable ||
+    Differs(ls.reported.rtt, ls.last.rtt, 1) ||
+    Differs(ls.reported_sent_rate, ls.sent_rate, kRateFloor) ||
+    Differs(ls.reported_recv_rate, ls.recv_rate, kRateFloor);
+}
+
+void
+LinkStatsMonitor::Report(
+  const string & link_id,
+  LinkState & ls,
+  Json::Value & links)
+{
+  Json::Value link(Json::objectValue);
+  link[TincanControl::LinkId] = link_id;
+  link[TincanControl::Status] = ls.last.online ? "ONLINE" : "OFFLINE";
+  link["writable"] = ls.last.writable;
+  link["rtt"] = (Json::UInt64)ls.last.rtt;
+  link["sent_total_bytes"] = (Json::UInt64)ls.last.sent_bytes;
+  link["recv_total_bytes"] = (Json::UInt64)ls.last.recv_bytes;
+  link["sent_bytes_second"] = (Json::UInt64)ls.sent_rate;
+  link["recv_bytes_second"] = (Json::UInt64)ls.recv_rate;
+  links.append(link);
+  ls.reported = ls.last;
+  ls.reported_sent_rate = ls.sent_rate;
+  ls.reported_recv_rate = ls.recv_rate;
+}
+} // namespace tincan
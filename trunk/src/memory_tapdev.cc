@@ -0,0 +1,214 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "memory_tapdev.h"
+#include "tincan_exception.h"
+#include "webrtc/base/helpers.h"
+#include "webrtc/base/ipaddress.h"
+
+namespace tincan
+{
+MemoryTapDev::MemoryTapDev() :
+  is_good_(false),
+  dropped_(0),
+  mac_{ 0 },
+  ip4_{ 0 },
+  mtu_(0)
+{}
+
+MemoryTapDev::~MemoryTapDev()
+{
+  Down();
+}
+
+/*
+Assigns a random, locally administered MAC address and the IPv4 address and MTU
+of the descriptor.
+*/
+void MemoryTapDev::Open(
+  const TapDescriptor & tap_desc)
+{
+  uint32_t id = rtc::CreateRandomId();
+  mac_ = { 0x02, 0x00, (uint8_t)(id >> 24), (uint8_t)(id >> 16),
+    (uint8_t)(id >> 8), (uint8_t)id };
+  rtc::IPAddress ip;
+  if(!tap_desc.ip4.empty())
+  {
+    if(!rtc::IPFromString(tap_desc.ip4, &ip) || ip.family() != AF_INET)
+      throw TCEXCEPT("The memory TAP device open operation failed - "
+        "the IP4 address is invalid");
+    uint32_t addr = ip.v4AddressAsHostOrderInteger();
+    ip4_ = { (uint8_t)(addr >> 24), (uint8_t)(addr >> 16), (uint8_t)(addr >> 8),
+      (uint8_t)addr };
+  }
+  mtu_ = tap_desc.mtu4 ? (uint16_t)tap_desc.mtu4 : tp.kMaxMtuSize;
+}
+
+void MemoryTapDev::Close()
+{
+  Down();
+}
+
+void MemoryTapDev::Up()
+{
+  lock_guard<mutex> lg(io_mtx_);
+  if(is_good_)
+    return;
+  reader_ = make_unique<rtc::Thread>();
+  reader_->Start();
+  writer_ = make_unique<rtc::Thread>();
+  writer_->Start();
+  is_good_ = true;
+}
+
+/*
+Stops the IO threads and releases the frames of the reads that were pending and
+of the completions that had not yet been raised.
+*/
+void MemoryTapDev::Down()
+{
+  vector<AsyncIo *> dropped_io;
+  {
+    lock_guard<mutex> lg(io_mtx_);
+    if(!is_good_)
+      return;
+    is_good_ = false;
+    dropped_io.assign(pending_reads_.begin(), pending_reads_.end());
+    pending_reads_.clear();
+    rx_queue_.clear();
+  }
+  for(auto thread : { reader_.get(), writer_.get() })
+  {
+    thread->Stop();
+    rtc::MessageList removed;
+    thread->Clear(this, rtc::MQID_ANY, &removed);
+    for(auto & msg : removed)
+    {
+      TapMessageData * md = (TapMessageData*)msg.pdata;
+      dropped_io.push_back(md->aio_);
+      delete md;
+    }
+  }
+  reader_.reset();
+  writer_.reset();
+  for(auto aio : dropped_io)
+    delete static_cast<TapFrame*>(aio->context_);
+  LOG(LS_INFO) << "Memory TAP device state set to DOWN";
+}
+
+uint32_t MemoryTapDev::Read(AsyncIo & aio_rd)
+{
+  lock_guard<mutex> lg(io_mtx_);
+  if(!is_good_)
+    return 1; //indicates a failure to setup async operation
+  if(rx_queue_.empty())
+  {
+    pending_reads_.push_back(&aio_rd);
+    return 0;
+  }
+  vector<uint8_t> frame = move(rx_queue_.front());
+  rx_queue_.pop_front();
+  CompleteRead(aio_rd, frame.data(), (uint32_t)frame.size());
+  return 0;
+}
+
+uint32_t MemoryTapDev::Write(AsyncIo & aio_wr)
+{
+  lock_guard<mutex> lg(io_mtx_);
+  if(!is_good_)
+    return 1; //indicates a failure to setup async operation
+  TapMessageData * md = new TapMessageData;
+  md->aio_ = &aio_wr;
+  writer_->Post(RTC_FROM_HERE, this, MSGID_WRITE, md);
+  return 0;
+}
+
+bool MemoryTapDev::Inject(
+  const uint8_t * frame,
+  uint32_t len)
+{
+  lock_guard<mutex> lg(io_mtx_);
+  if(is_good_ && !pending_reads_.empty())
+  {
+    AsyncIo * aio_rd = pending_reads_.front();
+    pending_reads_.pop_front();
+    CompleteRead(*aio_rd, frame, len);
+    return true;
+  }
+  if(!is_good_ || rx_queue_.size() >= kMaxQueued)
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  rx_queue_.emplace_back(frame, frame + len);
+  return true;
+}
+
+//Copies the frame into the read's buffer and raises its completion on the
+//reader thread, called with io_mtx_ held
+void MemoryTapDev::CompleteRead(
+  AsyncIo & aio_rd,
+  const uint8_t * frame,
+  uint32_t len)
+{
+  uint32_t nread = std::min(len, aio_rd.BytesToTransfer());
+  memcpy(aio_rd.BufferToTransfer(), frame, nread);
+  aio_rd.BytesTransferred(nread);
+  aio_rd.good_ = true;
+  TapMessageData * md = new TapMessageData;
+  md->aio_ = &aio_rd;
+  reader_->Post(RTC_FROM_HERE, this, MSGID_READ, md);
+}
+
+void MemoryTapDev::OnMessage(Message * msg)
+{
+  AsyncIo * aio = ((TapMessageData*)msg->pdata)->aio_;
+  delete (TapMessageData*)msg->pdata;
+  switch(msg->message_id)
+  {
+  case MSGID_READ:
+    read_completion_(aio);
+    break;
+  case MSGID_WRITE:
+    SignalFrameWritten(aio->BufferToTransfer(), aio->BytesToTransfer());
+    aio->BytesTransferred(aio->BytesToTransfer());
+    aio->good_ = true;
+    write_completion_(aio);
+    break;
+  }
+}
+
+uint16_t MemoryTapDev::Mtu()
+{
+  return mtu_;
+}
+
+MacAddressType MemoryTapDev::MacAddress()
+{
+  return mac_;
+}
+
+IP4AddressType MemoryTapDev::Ip4()
+{
+  return ip4_;
+}
+} // namespace tincan
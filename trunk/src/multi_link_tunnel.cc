@@ -22,21 +22,99 @@
 */
 #include "multi_link_tunnel.h"
 #include "webrtc/base/base64.h"
+#include "webrtc/base/byteorder.h"
+#include "webrtc/base/ipaddress.h"
 #include "tincan_control.h"
+#include <algorithm>
 namespace tincan
 {
   extern TincanParameters tp;
+  //Ethernet header and an ARP packet for IPv4 over Ethernet
+  static const uint32_t kArpFrameSize = 42;
+  //htype, ptype, hlen and plen of IPv4 over Ethernet ARP
+  static const uint8_t kArpEthIp4[] = { 0x00, 0x01, 0x08, 0x00, 0x06, 0x04 };
   MultiLinkTunnel::MultiLinkTunnel(
   unique_ptr<TunnelDescriptor> descriptor,
-  IpopControllerLink * ctrl_handle) :
-  BasicTunnel(move(descriptor), ctrl_handle)
+  IpopControllerLink * ctrl_handle,
+  unique_ptr<TapDevInf> tdev) :
+  BasicTunnel(move(descriptor), ctrl_handle, move(tdev))
 {
   peer_network_ = make_unique<PeerNetwork>();
+  peer_network_->SignalTick.connect(this, &MultiLinkTunnel::PeerNetworkTick);
 }
 
 MultiLinkTunnel::~MultiLinkTunnel()
 {}
 
+static void
+ParseReplicationPolicy(
+  const Json::Value & desc,
+  ReplicationPolicy & policy)
+{
+  if(desc.isMember("Rate"))
+    policy.rate = desc["Rate"].asDouble();
+  if(desc.isMember("Burst"))
+    policy.burst = desc["Burst"].asDouble();
+  const Json::Value & peers = desc["Peers"];
+  for(Json::Value::ArrayIndex i = 0; i < peers.size(); i++)
+  {
+    MacAddressType mac;
+    if(StringToByteArray(peers[i].asString(), mac.begin(), mac.end()) != 6)
+      throw TCEXCEPT("Invalid replication peer MAC address");
+    policy.peers.push_back(mac);
+  }
+}
+
+/*
+The description holds the Enabled flag, the default Rate, Burst and Peers
+applied to all group addresses, and a list of Groups that override them for
+individual group MAC addresses. Omitting the Peers selects all adjacent peers.
+*/
+void
+MultiLinkTunnel::ConfigureReplication(
+  const Json::Value & rp_descr)
+{
+  ReplicationPolicy default_policy;
+  ParseReplicationPolicy(rp_descr, default_policy);
+  map<MacAddressType, ReplicationPolicy> groups;
+  const Json::Value & grps = rp_descr["Groups"];
+  for(Json::Value::ArrayIndex i = 0; i < grps.size(); i++)
+  {
+    MacAddressType grp;
+    if(StringToByteArray(grps[i]["Group"].asString(), grp.begin(), grp.end())
+      != 6 || !(grp[0] & 0x01))
+      throw TCEXCEPT("Invalid replication group MAC address");
+    ParseReplicationPolicy(grps[i], groups[grp]);
+  }
+  replicator_.Configure(rp_descr["Enabled"].asBool(), default_policy, groups);
+}
+
+/*
+The description holds the MAC of the Parent, which is empty at the root of the
+tree, and the MACs of the Children. A tree without any edges removes it.
+*/
+void
+MultiLinkTunnel::UpdateBroadcastTree(
+  const Json::Value & bct_descr)
+{
+  MacAddressType parent = { 0 };
+  string parent_mac = bct_descr["Parent"].asString();
+  bool has_parent = !parent_mac.empty();
+  if(has_parent &&
+    StringToByteArray(parent_mac, parent.begin(), parent.end()) != 6)
+    throw TCEXCEPT("Invalid broadcast tree parent MAC address");
+  vector<MacAddressType> children;
+  const Json::Value & chl = bct_descr["Children"];
+  for(Json::Value::ArrayIndex i = 0; i < chl.size(); i++)
+  {
+    MacAddressType mac;
+    if(StringToByteArray(chl[i].asString(), mac.begin(), mac.end()) != 6)
+      throw TCEXCEPT("Invalid broadcast tree child MAC address");
+    children.push_back(mac);
+  }
+  bcast_tree_.Install(has_parent, parent, children);
+}
+
 shared_ptr<VirtualLink>
 MultiLinkTunnel::CreateVlink(
   unique_ptr<VlinkDescriptor> vlink_desc,
@@ -60,8 +138,20 @@ MultiLinkTunnel::CreateVlink(
       ir = cricket::ICEROLE_CONTROLLING;
     string roles[] = { "CONTROLLING", "CONTROLLED" };
     LOG(LS_INFO) << "Creating " << roles[ir] << " vlink w/ peer " << peer_desc->uid;
+    rtc::IPAddress vip4;
+    MacAddressType mac;
+    bool has_binding = rtc::IPFromString(peer_desc->vip4, &vip4) &&
+      vip4.family() == AF_INET &&
+      StringToByteArray(peer_desc->mac_address, mac.begin(), mac.end()) == 6;
     vl = BasicTunnel::CreateVlink(move(vlink_desc), move(peer_desc), ir);
     peer_network_->Add(vl);
+    if(has_binding)
+    {
+      IP4AddressType ip4;
+      in_addr ia = vip4.ipv4_address();
+      memcpy(ip4.data(), &ia.s_addr, ip4.size());
+      arp_cache_.AddStatic(ip4, mac);
+    }
   }
   return vl;
 }
@@ -71,29 +161,407 @@ MultiLinkTunnel::Start()
 {
   BasicTunnel::Start();
   tdev_->Up();
-  peer_net_thread_.Start(peer_network_.get());
+  peer_network_->Start(&net_worker_);
 }
 
 void
 MultiLinkTunnel::Shutdown()
 {
+  peer_network_->Stop();
   BasicTunnel::Shutdown();
-  peer_net_thread_.Quit();
   peer_network_->Clear();
+  pending_routes_.Clear();
+  arp_cache_.Clear();
+  ip4_routes_.Clear();
+  bcast_tree_.Clear();
 }
 
+/*
+Each entry of the route table description is an object with an Action of "Add"
+or "Remove", the Destination MAC and for additions the MAC of the adjacent
+peer that is the Path to it. Entries with any other Action are rejected. When
+Replace is set the table replaces all of the existing routes.
+*/
 void
 MultiLinkTunnel::UpdateRouteTable(
-  const Json::Value & rt_descr)
+  const Json::Value & rt_descr,
+  Json::Value & rt_info)
+{
+  steady_clock::time_point start = steady_clock::now();
+  const Json::Value & table = rt_descr["Table"];
+  vector<RouteUpdate> updates;
+  updates.reserve(table.size());
+  uint32_t malformed = 0;
+  for(Json::Value::ArrayIndex i = 0; i < table.size(); i++)
+  {
+    const Json::Value & entry = table[i];
+    RouteUpdate ru;
+    string action = entry["Action"].asString();
+    ru.remove = action == "Remove";
+    string dest = entry["Destination"].asString();
+    string path = entry["Path"].asString();
+    if((!ru.remove && action != "Add") ||
+      StringToByteArray(dest, ru.dest.begin(), ru.dest.end()) != 6 ||
+      (!ru.remove &&
+        StringToByteArray(path, ru.path.begin(), ru.path.end()) != 6))
+    {
+      malformed++;
+      continue;
+    }
+    updates.push_back(ru);
+  }
+  std::chrono::microseconds parse_time =
+    std::chrono::duration_cast<std::chrono::microseconds>(
+      steady_clock::now() - start);
+  RouteUpdateStats rus = peer_network_->UpdateRouteTable(updates,
+    rt_descr["Replace"].asBool());
+  rt_info["Added"] = rus.added;
+  rt_info["Removed"] = rus.removed;
+  rt_info["Rejected"] = rus.rejected + malformed;
+  rt_info["Routes"] = rus.routes;
+  rt_info["ParseTime"] = (Json::UInt64)parse_time.count();
+  rt_info["BuildTime"] = (Json::UInt64)rus.build_time.count();
+  rt_info["SwapTime"] = (Json::UInt64)rus.swap_time.count();
+  FlushPendingRoutes();
+}
+
+/*
+Each entry of the table is an object with an Action of "Add" or "Remove", the
+IPv4 Prefix in CIDR notation and for additions the MAC of the adjacent peer
+that is the Path to the subnet. Entries with any other Action are rejected.
+When Replace is set the table replaces all of the existing IPv4 routes.
+*/
+void
+MultiLinkTunnel::UpdateIp4RouteTable(
+  const Json::Value & rt_descr,
+  Json::Value & rt_info)
+{
+  const Json::Value & table = rt_descr["Table"];
+  vector<Ip4RouteUpdate> updates;
+  updates.reserve(table.size());
+  uint32_t malformed = 0;
+  for(Json::Value::ArrayIndex i = 0; i < table.size(); i++)
+  {
+    const Json::Value & entry = table[i];
+    Ip4RouteUpdate ru;
+    string action = entry["Action"].asString();
+    ru.remove = action == "Remove";
+    string prefix = entry["Prefix"].asString();
+    string path = entry["Path"].asString();
+    size_t sep = prefix.find('/');
+    rtc::IPAddress addr;
+    int length = -1;
+    if(sep != string::npos && sep + 1 < prefix.length() &&
+      prefix.find_first_not_of("0123456789", sep + 1) == string::npos &&
+      prefix.length() - sep <= 3)
+      length = std::stoi(prefix.substr(sep + 1));
+    if((!ru.remove && action != "Add") || length < 0 || length > 32 ||
+      !rtc::IPFromString(prefix.substr(0, sep), &addr) ||
+      addr.family() != AF_INET ||
+      (!ru.remove &&
+        StringToByteArray(path, ru.path.begin(), ru.path.end()) != 6))
+    {
+      malformed++;
+      continue;
+    }
+    ru.prefix = addr.v4AddressAsHostOrderInteger();
+    ru.length = (uint8_t)length;
+    updates.push_back(ru);
+  }
+  Ip4RouteUpdateStats rus = ip4_routes_.Update(updates,
+    rt_descr["Replace"].asBool());
+  rt_info["Added"] = rus.added;
+  rt_info["Removed"] = rus.removed;
+  rt_info["Rejected"] = rus.rejected + malformed;
+  rt_info["Routes"] = rus.routes;
+  rt_info["BuildTime"] = (Json::UInt64)rus.build_time.count();
+}
+
+void
+MultiLinkTunnel::VLinkUp(
+  string vlink_id)
+{
+  BasicTunnel::VLinkUp(vlink_id);
+  FlushPendingRoutes();
+}
+
+void
+MultiLinkTunnel::RequestRoute(
+  const MacAddressType & dest,
+  unique_ptr<TapFrame> frame)
+{
+  string data;
+  if(dest[0] & 0x01)
+  { //broadcast and multicast frames are not resolved to a route, the
+    //controller handles each of them
+    data = ByteArrayToString(frame->Payload(), frame->PayloadEnd());
+  }
+  else
+  {
+    bool request = pending_routes_.Enqueue(dest, move(frame),
+      peer_network_->Now(), data);
+    //a route installed after the caller's lookup missed may have been flushed
+    //before the frame was queued, release it now rather than have it wait for
+    //an answer that has already arrived
+    ForwardingDecision fd = peer_network_->Lookup(dest);
+    if(fd.type != FWD_UNKNOWN && fd.vlink->IsReady())
+    {
+      FlushPendingRoutes();
+      return;
+    }
+    if(!request)
+      return;
+  }
+  unique_ptr<TincanControl> ctrl = make_unique<TincanControl>();
+  ctrl->SetControlType(TincanControl::CTTincanRequest);
+  Json::Value & req = ctrl->GetRequest();
+  req[TincanControl::Command] = TincanControl::ReqRouteUpdate;
+  req[TincanControl::TunnelId] = descriptor_->uid;
+  req[TincanControl::Data] = data;
+  ctrl_link_->Deliver(move(ctrl));
+}
+
+/*
+Pending frames are released once their destination is reachable over a vlink
+that is ready to carry them, and are transmitted with the header of the current
+forwarding decision.
+*/
+void
+MultiLinkTunnel::FlushPendingRoutes()
+{
+  vector<unique_ptr<TapFrame>> frames;
+  pending_routes_.Release([this](const MacAddressType & mac)
+  {
+    ForwardingDecision fd = peer_network_->Lookup(mac);
+    return fd.type != FWD_UNKNOWN && fd.vlink->IsReady();
+  }, frames);
+  for(auto & frame : frames)
+  {
+    TapFrameProperties fp(*frame);
+    ForwardingDecision fd = peer_network_->Lookup(fp.DestinationMac());
+    if(fd.type == FWD_UNKNOWN)
+      continue;
+    frame->Header(fd.header);
+    frame->BufferToTransfer(frame->Begin());
+    frame->BytesToTransfer(frame->Length());
+    TransmitMsgData *md = new TransmitMsgData;
+    md->vl = fd.SelectVlink(fp.FlowHash());
+    md->frm = move(frame);
+    net_worker_.Post(RTC_FROM_HERE, this, MSGID_FWD_FRAME, md);
+  }
+}
+
+void
+MultiLinkTunnel::PeerNetworkTick(
+  uint32_t now)
+{
+  pending_routes_.Expire(now);
+  arp_cache_.Expire(now);
+}
+
+/*
+Requests for the address of a peer in the ARP cache are answered directly into
+the TAP on behalf of the peer, so the local stack does not wait on the
+controller to resolve the overlay address. Gratuitous ARP and requests for
+unknown addresses take the normal path.
+*/
+bool
+MultiLinkTunnel::ProxyArp(
+  TapFrame & frame)
 {
-  //peer_network_->UpdateRouteTable(rt_descr);
+  if(frame.PayloadLength() < kArpFrameSize)
+    return false;
+  EthOffsets eth(frame.Payload());
+  ArpOffsets arp(eth.Payload());
+  if(memcmp(arp.HardwareType(), kArpEthIp4, sizeof(kArpEthIp4)) != 0 ||
+    memcmp(arp.SourceIp(), arp.DestinationIp(), 4) == 0)
+    return false;
+  IP4AddressType tpa;
+  MacAddressType mac;
+  memcpy(tpa.data(), arp.DestinationIp(), tpa.size());
+  if(!arp_cache_.Resolve(tpa, mac))
+    return false;
+  unique_ptr<TapFrame> tf = make_unique<TapFrame>();
+  tf->Initialize();
+  EthOffsets reth(tf->Payload());
+  memcpy(reth.DestinationMac(), eth.SourceMac(), 6);
+  memcpy(reth.SourceMac(), mac.data(), 6);
+  memcpy(reth.Type(), eth.Type(), 2);
+  ArpOffsets rarp(reth.Payload());
+  memcpy(rarp.HardwareType(), kArpEthIp4, sizeof(kArpEthIp4));
+  rarp.ArpOperation()[0] = 0x00;
+  rarp.ArpOperation()[1] = 0x02;
+  memcpy(rarp.SourceMac(), mac.data(), 6);
+  memcpy(rarp.SourceIp(), arp.DestinationIp(), 4);
+  memcpy(rarp.DestinationMac(), arp.SourceMac(), 6);
+  memcpy(rarp.DestinationIp(), arp.SourceIp(), 4);
+  tf->SetWriteOp();
+  tf->PayloadLength(kArpFrameSize);
+  tf->BufferToTransfer(tf->Payload());
+  tf->BytesTransferred(kArpFrameSize);
+  tf->BytesToTransfer(kArpFrameSize);
+  if(0 != tdev_->Write(*tf))
+    return false;
+  tf.release();
+  return true;
+}
+
+void
+MultiLinkTunnel::LearnArp(
+  TapFrame & frame)
+{
+  if(frame.PayloadLength() < kArpFrameSize)
+    return;
+  EthOffsets eth(frame.Payload());
+  ArpOffsets arp(eth.Payload());
+  if(memcmp(arp.HardwareType(), kArpEthIp4, sizeof(kArpEthIp4)) != 0)
+    return;
+  IP4AddressType spa;
+  MacAddressType sha;
+  memcpy(spa.data(), arp.SourceIp(), spa.size());
+  memcpy(sha.data(), arp.SourceMac(), sha.size());
+  if(*(uint32_t*)spa.data() == 0) //address probe
+    return;
+  arp_cache_.Learn(spa, sha, peer_network_->Now());
+}
+
+/*
+The frame buffer is shared by all the copies, it is transmitted on each
+selected vlink in turn on the network thread and then returned to the TAP for
+the next read. Frames over the group's rate limit are dropped.
+*/
+void
+MultiLinkTunnel::ReplicateFrame(
+  TapFrame * frame)
+{
+  TapFrameProperties fp(*frame);
+  vector<MacAddressType> peers;
+  unique_ptr<ReplicateMsgData> md = make_unique<ReplicateMsgData>();
+  if(replicator_.Admit(fp.DestinationMac(), peers))
+  {
+    if(peers.empty())
+      peer_network_->AdjacentVlinks(md->vls);
+    else
+    {
+      for(auto & mac : peers)
+      {
+        ForwardingDecision fd = peer_network_->Lookup(mac);
+        if(fd.type == FWD_ADJACENT)
+          md->vls.push_back(fd.vlink);
+      }
+    }
+    md->vls.erase(std::remove_if(md->vls.begin(), md->vls.end(),
+      [](const shared_ptr<VirtualLink> & vl) { return !vl->IsReady(); }),
+      md->vls.end());
+  }
+  if(md->vls.empty())
+  {
+    frame->Initialize(frame->Payload(), frame->PayloadCapacity());
+    if(0 != tdev_->Read(*frame))
+      delete frame;
+    return;
+  }
+  replicator_.Replicated(md->vls.size());
+  frame->Header(tp.kDtfMagic);
+  md->frm.reset(frame);
+  net_worker_.Post(RTC_FROM_HERE, this, MSGID_REPLICATE_RD, md.release());
+}
+
+/*
+The frame is stamped with this node as its origin and the next broadcast
+sequence number, by which the receivers recognize the copies of it that loop
+back while the tree is changing.
+*/
+void
+MultiLinkTunnel::BroadcastFrame(
+  TapFrame * frame)
+{
+  unique_ptr<ReplicateMsgData> md = make_unique<ReplicateMsgData>();
+  TreeVlinks(nullptr, md->vls);
+  if(md->vls.empty())
+  {
+    frame->Initialize(frame->Payload(), frame->PayloadCapacity());
+    if(0 != tdev_->Read(*frame))
+      delete frame;
+    return;
+  }
+  bcast_tree_.Originated();
+  bcast_tree_.Forwarded(md->vls.size());
+  MacAddressType origin = tdev_->MacAddress();
+  uint8_t * trailer = frame->PayloadEnd();
+  memcpy(trailer, origin.data(), origin.size());
+  rtc::SetBE32(trailer + origin.size(), bcast_tree_.NextSequence());
+  frame->PayloadLength(frame->PayloadLength() + tp.kBctTrailerSize);
+  frame->BytesToTransfer(frame->Length());
+  frame->Header(tp.kBctMagic);
+  md->frm.reset(frame);
+  net_worker_.Post(RTC_FROM_HERE, this, MSGID_REPLICATE_RD, md.release());
+}
+
+void
+MultiLinkTunnel::TreeVlinks(
+  const VirtualLink * ingress,
+  vector<shared_ptr<VirtualLink>> & vlinks)
+{
+  for(auto & mac : bcast_tree_.Neighbors())
+  {
+    ForwardingDecision fd = peer_network_->Lookup(mac);
+    if(fd.type != FWD_ADJACENT || !fd.vlink->IsReady() ||
+      std::any_of(fd.vlinks->begin(), fd.vlinks->end(),
+        [ingress](const shared_ptr<VirtualLink> & vl)
+        { return vl.get() == ingress; }))
+      continue;
+    vlinks.push_back(fd.vlink);
+  }
+}
+
+void
+MultiLinkTunnel::LearnSource(
+  TapFrame & frame,
+  VirtualLink & vlink,
+  bool bridged)
+{
+  TapFrameProperties fp(frame);
+  const MacAddressType & src = fp.SourceMac();
+  if((src[0] & 0x01) || src == tdev_->MacAddress())
+    return;
+  if(peer_network_->Learn(src, vlink, bridged, learn_cache_))
+    FlushPendingRoutes();
+}
+
+/*
+Subnet routes only apply through an adjacent peer, the frame is delivered to
+its TAP as is and from there to the host on the peer's network segment.
+*/
+ForwardingDecision
+MultiLinkTunnel::LookupIp4(
+  const IP4AddressType & ip4)
+{
+  MacAddressType path;
+  if(!ip4_routes_.Lookup(ip4, path))
+    return ForwardingDecision();
+  ForwardingDecision fd = peer_network_->Lookup(path, tap_flow_cache_);
+  if(fd.type != FWD_ADJACENT)
+    return ForwardingDecision();
+  return fd;
 }
 
 
 void MultiLinkTunnel::RemoveLink(
   const string & vlink_id)
 {
-    peer_network_->Remove(vlink_id);
+  MacAddressType mac;
+  bool has_mac = false;
+  if(peer_network_->Exists(vlink_id))
+  {
+    shared_ptr<VirtualLink> vl = peer_network_->GetVlinkById(vlink_id);
+    has_mac = StringToByteArray(vl->PeerInfo().mac_address, mac.begin(),
+      mac.end()) == 6;
+  }
+  peer_network_->Remove(vlink_id);
+  //the binding remains while other vlinks to the peer exist
+  if(has_mac && !peer_network_->IsAdjacent(mac))
+    arp_cache_.RemoveStatic(mac);
 }
 
 void MultiLinkTunnel::QueryInfo(
@@ -110,6 +578,38 @@ void MultiLinkTunnel::QueryInfo(
   {
     tnl_info[TincanControl::Vlinks].append(vl);
   }
+  Json::Value & fc = tnl_info[TincanControl::Stats]["FlowCache"];
+  fc["Hits"] =
+    (Json::UInt64)(tap_flow_cache_.Hits() + vlink_flow_cache_.Hits());
+  fc["Misses"] =
+    (Json::UInt64)(tap_flow_cache_.Misses() + vlink_flow_cache_.Misses());
+  PendingRouteStats prs = pending_routes_.Stats();
+  Json::Value & pr = tnl_info[TincanControl::Stats]["PendingRoutes"];
+  pr["Requests"] = (Json::UInt64)prs.requests;
+  pr["Suppressed"] = (Json::UInt64)prs.suppressed;
+  pr["Buffered"] = (Json::UInt64)prs.buffered;
+  pr["Flushed"] = (Json::UInt64)prs.flushed;
+  pr["Dropped"] = (Json::UInt64)prs.dropped;
+  pr["Pending"] = prs.pending;
+  Json::Value & ac = tnl_info[TincanControl::Stats]["ArpCache"];
+  ac["Entries"] = (Json::UInt64)arp_cache_.Size();
+  ac["Hits"] = (Json::UInt64)arp_cache_.Hits();
+  ac["Misses"] = (Json::UInt64)arp_cache_.Misses();
+  tnl_info[TincanControl::Stats]["LearnedMacs"] =
+    peer_network_->LearnedCount();
+  tnl_info[TincanControl::Stats]["Ip4Routes"] =
+    (Json::UInt64)ip4_routes_.Size();
+  ReplicationStats rs = replicator_.Stats();
+  Json::Value & rp = tnl_info[TincanControl::Stats]["Replication"];
+  rp["Frames"] = (Json::UInt64)rs.frames;
+  rp["Copies"] = (Json::UInt64)rs.copies;
+  rp["RateLimited"] = (Json::UInt64)rs.rate_limited;
+  BroadcastTreeStats bs = bcast_tree_.Stats();
+  Json::Value & bt = tnl_info[TincanControl::Stats]["BroadcastTree"];
+  bt["Originated"] = (Json::UInt64)bs.originated;
+  bt["Forwarded"] = (Json::UInt64)bs.forwarded;
+  bt["Delivered"] = (Json::UInt64)bs.delivered;
+  bt["Duplicates"] = (Json::UInt64)bs.duplicates;
 }
 
 void MultiLinkTunnel::QueryLinkCas(
@@ -135,6 +635,23 @@ MultiLinkTunnel::QueryLinkIds
   link_ids = peer_network_->QueryVlinks();
 }
 
+void
+MultiLinkTunnel::QueryVlinks(
+  vector<shared_ptr<VirtualLink>> & vlinks)
+{
+  peer_network_->QueryVlinks(vlinks);
+}
+
+void
+MultiLinkTunnel::QueueStats(
+  uint64_t & pending,
+  uint64_t & dropped)
+{
+  PendingRouteStats prs = pending_routes_.Stats();
+  pending = prs.pending;
+  dropped = prs.dropped + replicator_.Stats().rate_limited;
+}
+
 void
 MultiLinkTunnel::QueryLinkInfo(
   const string & vlink_id,
@@ -205,48 +722,75 @@ MultiLinkTunnel::VlinkReadComplete(
   uint32_t data_len,
   VirtualLink & vlink)
 {
+  uint64_t received = LatencyStamp();
   unique_ptr<TapFrame> frame = make_unique<TapFrame>(data, data_len);
   TapFrameProperties fp(*frame);
   if(fp.IsIccMsg())
   { // this is an ICC message, deliver to the ipop-controller
-    unique_ptr<TincanControl> ctrl = make_unique<TincanControl>();
-    ctrl->SetControlType(TincanControl::CTTincanRequest);
-    Json::Value & req = ctrl->GetRequest();
-    req[TincanControl::Command] = TincanControl::ICC;
-    req[TincanControl::TunnelId] = descriptor_->uid;
-    req[TincanControl::LinkId] = vlink.Id();
-    req[TincanControl::Data] = string((char*)frame->Payload(),
-      frame->PayloadLength());
-    ctrl_link_->Deliver(move(ctrl));
+    DeliverIcc(*frame, vlink);
   }
   else if(fp.IsFwdMsg())
   { // a frame to be routed
-    if(peer_network_->IsRouteExists(fp.DestinationMac()))
+    LearnSource(*frame, vlink, false);
+    ForwardingDecision fd =
+      peer_network_->Lookup(fp.DestinationMac(), vlink_flow_cache_);
+    if(fd.type != FWD_UNKNOWN)
     {
-      shared_ptr<VirtualLink> vl = peer_network_->GetRoute(fp.DestinationMac());
+      frame->Header(fd.header);
       TransmitMsgData *md = new TransmitMsgData;
+      md->vl = fd.SelectVlink(fp.FlowHash());
       md->frm = move(frame);
-      md->vl = vl;
       net_worker_.Post(RTC_FROM_HERE, this, MSGID_FWD_FRAME, md);
     }
     else
-    { //no route found, send to controller
-      unique_ptr<TincanControl> ctrl = make_unique<TincanControl>();
-      ctrl->SetControlType(TincanControl::CTTincanRequest);
-      Json::Value & req = ctrl->GetRequest();
-      req[TincanControl::Command] = TincanControl::ReqRouteUpdate;
-      req[TincanControl::TunnelId] = descriptor_->uid;
-      req[TincanControl::Data] = ByteArrayToString(frame->Payload(),
-        frame->PayloadEnd());
-      ctrl_link_->Deliver(move(ctrl));
+    { //no route found, hold it while the controller is asked for one
+      MacAddressType dest = fp.DestinationMac();
+      RequestRoute(dest, move(frame));
     }
   }
+  else if(fp.IsBctMsg())
+  { // a broadcast on the distribution tree, deliver it to the TAP and pass it
+    // on to the other tree neighbors
+    if(frame->PayloadLength() < tp.kEthHeaderSize + tp.kBctTrailerSize)
+      return;
+    uint32_t pl_len = frame->PayloadLength() - tp.kBctTrailerSize;
+    const uint8_t * trailer = frame->Payload() + pl_len;
+    MacAddressType origin;
+    memcpy(origin.data(), trailer, origin.size());
+    if(origin == tdev_->MacAddress() ||
+      !bcast_tree_.FirstSeen(origin, rtc::GetBE32(trailer + origin.size())))
+      return;
+    if(fp.IsArpRequest() || fp.IsArpResponse())
+      LearnArp(*frame);
+    unique_ptr<ReplicateMsgData> md = make_unique<ReplicateMsgData>();
+    TreeVlinks(&vlink, md->vls);
+    unique_ptr<TapFrame> tf;
+    if(md->vls.empty())
+      tf = move(frame);
+    else
+    {
+      tf = make_unique<TapFrame>(*frame);
+      bcast_tree_.Forwarded(md->vls.size());
+      md->frm = move(frame);
+      net_worker_.Post(RTC_FROM_HERE, this, MSGID_REPLICATE, md.release());
+    }
+    bcast_tree_.Delivered();
+    tf->PayloadLength(pl_len); //the trailer is not delivered to the TAP
+    tf->BufferToTransfer(tf->Payload());
+    tf->BytesToTransfer(tf->PayloadLength());
+    tf->SetWriteOp();
+    tdev_->Write(*tf.release());
+  }
   else if (fp.IsDtfMsg())
   {
     frame->Dump("Frame from vlink");
+    LearnSource(*frame, vlink, true);
+    if(fp.IsArpRequest() || fp.IsArpResponse())
+      LearnArp(*frame);
     frame->BufferToTransfer(frame->Payload()); //write frame payload to TAP
     frame->BytesToTransfer(frame->PayloadLength());
     frame->SetWriteOp();
+    RecordVlinkToTap(*frame, vlink, received);
     tdev_->Write(*frame.release());
   }
   else
@@ -285,42 +829,49 @@ MultiLinkTunnel::TapReadComplete(
       delete frame;
     return;
   }
+  tap_counters_.frames_in.fetch_add(1, std::memory_order_relaxed);
+  tap_counters_.bytes_in.fetch_add(frame->BytesTransferred(),
+    std::memory_order_relaxed);
+  StampTapRead(*frame);
   frame->PayloadLength(frame->BytesTransferred());
   TapFrameProperties fp(*frame);
-  MacAddressType mac = fp.DestinationMac();
+  if(fp.IsArpRequest() && ProxyArp(*frame))
+  {
+    frame->Initialize(frame->Payload(), frame->PayloadCapacity());
+    if(0 != tdev_->Read(*frame))
+      delete frame;
+    return;
+  }
   frame->BufferToTransfer(frame->Begin()); //write frame header + PL to vlink
   frame->BytesToTransfer(frame->Length());
-  if(peer_network_->IsAdjacent(mac))
+  ForwardingDecision fd =
+    peer_network_->Lookup(fp.DestinationMac(), tap_flow_cache_);
+  if(fd.type == FWD_UNKNOWN && fp.IsIp4())
+    fd = LookupIp4(fp.DestinationIp4Address());
+  if(fd.type != FWD_UNKNOWN)
   {
-    frame->Header(tp.kDtfMagic);
-    //frame->Dump("Unicast");
-    shared_ptr<VirtualLink> vl = peer_network_->GetVlink(mac);
+    //DTF to an adjacent peer or FWD through its route, either way the frame
+    //is returned to the TAP for the next read once transmitted
+    frame->Header(fd.header);
     TransmitMsgData *md = new TransmitMsgData;
+    md->vl = fd.SelectVlink(fp.FlowHash());
     md->frm.reset(frame);
-    md->vl = vl;
     net_worker_.Post(RTC_FROM_HERE, this, MSGID_TRANSMIT, md);
   }
-  else if(peer_network_->IsRouteExists(mac))
+  else if((fp.DestinationMac()[0] & 0x01) && bcast_tree_.IsInstalled())
   {
-    frame->Header(tp.kFwdMagic);
-    //frame->Dump("Frame FWD");
-    TransmitMsgData *md = new TransmitMsgData;
-    md->frm.reset(frame);
-    md->vl = peer_network_->GetRoute(mac);
-    net_worker_.Post(RTC_FROM_HERE, this, MSGID_FWD_FRAME, md);
+    BroadcastFrame(frame);
+  }
+  else if((fp.DestinationMac()[0] & 0x01) && replicator_.IsEnabled())
+  {
+    ReplicateFrame(frame);
   }
   else
   {
-    frame->Header(tp.kIccMagic);
-    //Send to IPOP Controller to find a route for this frame
-    unique_ptr<TincanControl> ctrl = make_unique<TincanControl>();
-    ctrl->SetControlType(TincanControl::CTTincanRequest);
-    Json::Value & req = ctrl->GetRequest();
-    req[TincanControl::Command] = TincanControl::ReqRouteUpdate;
-    req[TincanControl::TunnelId] = descriptor_->uid;
-    req[TincanControl::Data] = ByteArrayToString(frame->Payload(),
-      frame->PayloadEnd());
-    ctrl_link_->Deliver(move(ctrl));
+    //Ask the IPOP Controller for a route, holding a copy of the frame until
+    //one is installed
+    RequestRoute(fp.DestinationMac(),
+      make_unique<TapFrame>(frame->Begin(), frame->Length()));
     //Post a new TAP read request
     frame->Initialize(frame->Payload(), frame->PayloadCapacity());
     if(0 != tdev_->Read(*frame))
@@ -334,9 +885,18 @@ MultiLinkTunnel::TapWriteComplete(
 {
   TapFrame * frame = static_cast<TapFrame*>(aio_wr->context_);
   if(frame->IsGood())
+  {
+    tap_counters_.frames_out.fetch_add(1, std::memory_order_relaxed);
+    tap_counters_.bytes_out.fetch_add(frame->BytesTransferred(),
+      std::memory_order_relaxed);
+    RecordTapWrite(*frame);
     frame->Dump("TAP Write Completed");
+  }
   else
+  {
+    tap_counters_.errors.fetch_add(1, std::memory_order_relaxed);
     LOG(LS_WARNING) << "Tap Write FAILED completion";
+  }
   delete frame;
 }
 
@@ -22,10 +22,110 @@
 */
 #include "peer_network.h"
 #include "tincan_exception.h"
+#include <algorithm>
 namespace tincan
 {
+FlowCache::FlowCache() :
+  hits_(0),
+  misses_(0)
+{}
+
+uint32_t
+FlowCache::SlotIndex(
+  const MacAddressType & mac)
+{
+  uint64_t key = 0;
+  memcpy(&key, mac.data(), mac.size());
+  return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - kSlotBits));
+}
+
+bool
+FlowCache::Find(
+  const MacAddressType & mac,
+  uint32_t generation,
+  ForwardingDecision & fd)
+{
+  Slot & slot = slots_[SlotIndex(mac)];
+  if(slot.generation == generation && slot.mac == mac)
+  {
+    fd.type = slot.type;
+    fd.header = slot.header;
+    fd.vlink = slot.vlink.lock();
+    fd.vlinks = slot.vlinks.lock();
+    if(fd.type == FWD_UNKNOWN || (fd.vlink && fd.vlinks))
+    {
+      hits_.store(hits_.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+      return true;
+    }
+    fd = ForwardingDecision();
+  }
+  misses_.store(misses_.load(std::memory_order_relaxed) + 1,
+    std::memory_order_relaxed);
+  return false;
+}
+
+void
+FlowCache::Insert(
+  const MacAddressType & mac,
+  uint32_t generation,
+  const ForwardingDecision & fd)
+{
+  Slot & slot = slots_[SlotIndex(mac)];
+  slot.mac = mac;
+  slot.generation = generation;
+  slot.type = fd.type;
+  slot.header = fd.header;
+  slot.vlink = fd.vlink;
+  slot.vlinks = fd.vlinks;
+}
+
+shared_ptr<VirtualLink>
+ForwardingDecision::SelectVlink(
+  uint32_t flow_hash) const
+{
+  if(!vlinks || vlinks->size() < 2)
+    return vlink;
+  size_t cnt = vlinks->size();
+  size_t first = flow_hash % cnt;
+  for(size_t i = 0; i < cnt; i++)
+  {
+    const shared_ptr<VirtualLink> & vl = (*vlinks)[(first + i) % cnt];
+    if(vl->IsReady())
+      return vl;
+  }
+  return vlink;
+}
+
+bool
+LearnCache::Seen(
+  const MacAddressType & src,
+  const VirtualLink * ingress,
+  uint32_t generation,
+  uint32_t tick)
+{
+  uint64_t key = 0;
+  memcpy(&key, src.data(), src.size());
+  Slot & slot =
+    slots_[(uint32_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - kSlotBits))];
+  if(slot.mac == src && slot.ingress == ingress &&
+    slot.generation == generation && slot.tick == tick)
+    return true;
+  slot.mac = src;
+  slot.ingress = ingress;
+  slot.generation = generation;
+  slot.tick = tick;
+  return false;
+}
+
 PeerNetwork::PeerNetwork() :
-  scavenge_interval(120000)
+  generation_(1),
+  fwd_table_(make_shared<FwdTable>()),
+  tick_(0),
+  learned_count_(0),
+  next_timer_id_(0),
+  building_(false),
+  timer_thread_(nullptr)
 {}
 
 PeerNetwork::~PeerNetwork()
@@ -34,7 +134,8 @@ PeerNetwork::~PeerNetwork()
 }
 /*
 Adds a new adjacent node to the peer network. This is used when a new vlink is
-created.
+created. A vlink to a peer that is already adjacent becomes an additional path
+to it.
 */
 void PeerNetwork::Add(shared_ptr<VirtualLink> vlink)
 {
@@ -48,34 +149,44 @@ void PeerNetwork::Add(shared_ptr<VirtualLink> vlink)
     emsg.append(vlink->PeerInfo().mac_address);
     throw TCEXCEPT(emsg.c_str());
   }
+  lock_guard<mutex> rlg(rebuild_mtx_);
+  shared_ptr<const FwdTable> table = BeginBuild();
+  shared_ptr<VlinkGroup> vlinks = make_shared<VlinkGroup>();
+  auto itr = table->find(mac);
+  if(itr != table->end() && itr->second.type == FWD_ADJACENT)
   {
-    lock_guard<mutex> lg(mac_map_mtx_);
-    if(mac_map_.count(mac) == 1)
+    for(auto & vl : *itr->second.vlinks)
     {
-      LOG(LS_INFO) << "Entry " << vlink->PeerInfo().mac_address <<
-        " already exists in peer net. It will be updated.";
+      if(vl->Id() != vlink->Id())
+        vlinks->push_back(vl);
     }
-    mac_map_[mac] = vlink;
-    link_map_[vlink->Id()] = vlink;
+    LOG(LS_INFO) << "Entry " << vlink->PeerInfo().mac_address <<
+      " already exists in peer net, adding path " << vlinks->size() + 1;
   }
+  vlinks->push_back(vlink);
+  shared_ptr<FwdTable> update = CopyTable(*table, false);
+  UpdatePaths(*update, mac, vlinks);
+  lock_guard<mutex> ulg(update_mtx_);
+  EndBuild(*update);
+  table = move(update);
+  lock_guard<mutex> lg(mac_map_mtx_);
+  UpdateLearnedPaths(mac, vlinks);
+  link_map_[vlink->Id()] = vlink;
+  Publish(table);
 }
 
 void PeerNetwork::Clear()
 {
+  lock_guard<mutex> rlg(rebuild_mtx_);
+  lock_guard<mutex> ulg(update_mtx_);
   lock_guard<mutex> lgm(mac_map_mtx_);
-  mac_routes_.clear();
-  mac_map_.clear();
+  fwd_table_ = make_shared<FwdTable>();
+  learned_.clear();
   link_map_.clear();
-}
-
-shared_ptr<VirtualLink>
-PeerNetwork::GetRoute(
-  const MacAddressType& mac)
-{
-  lock_guard<mutex> lgm(mac_map_mtx_);
-  HubEx & hux = mac_routes_.at(mac);
-  hux.accessed = steady_clock::now();
-  return hux.vl;
+  route_timers_.Clear();
+  learned_timers_.Clear();
+  learned_count_ = 0;
+  generation_++;
 }
 
 shared_ptr<VirtualLink>
@@ -92,7 +203,10 @@ PeerNetwork::GetVlink(
   const MacAddressType& mac)
 {
   lock_guard<mutex> lgm(mac_map_mtx_);
-  return mac_map_.at(mac);
+  auto itr = fwd_table_->find(mac);
+  if(itr == fwd_table_->end() || itr->second.type != FWD_ADJACENT)
+    throw out_of_range("The MAC address is not an adjacent peer");
+  return itr->second.vlinks->front();
 }
 
 shared_ptr<VirtualLink>
@@ -125,23 +239,152 @@ PeerNetwork::IsAdjacent(
   const MacAddressType& mac)
 {
   lock_guard<mutex> lgm(mac_map_mtx_);
-  return (mac_map_.count(mac) == 1);
+  auto itr = fwd_table_->find(mac);
+  return (itr != fwd_table_->end() && itr->second.type == FWD_ADJACENT);
 }
 
-bool
-PeerNetwork::IsRouteExists(
+/*
+Resolves the destination MAC with a single probe of the forwarding table, the
+learned MACs are only probed for destinations it does not have. An adjacent
+peer is reached directly with a DTF frame, any other known destination is
+forwarded through the vlinks of its route. Routes through a peer that is no
+longer adjacent are reported as unknown and left for their expiry timer to
+reclaim. The first ready vlink of the group is the preferred one.
+*/
+ForwardingDecision
+PeerNetwork::Lookup(
   const MacAddressType& mac)
 {
-  bool rv = false;
+  ForwardingDecision fd;
   lock_guard<mutex> lgm(mac_map_mtx_);
-  if(mac_routes_.count(mac) == 1)
+  const FwdEntry * fe = nullptr;
+  auto itr = fwd_table_->find(mac);
+  if(itr != fwd_table_->end() &&
+    !itr->second.expired.load(std::memory_order_relaxed))
+  {
+    fe = &itr->second;
+    if(fe->type != FWD_ADJACENT)
+      fe->accessed.store(Now(), std::memory_order_relaxed);
+  }
+  else
+  {
+    //learned entries are only refreshed by traffic from the source
+    auto litr = learned_.find(mac);
+    if(litr != learned_.end())
+      fe = &litr->second;
+  }
+  if(!fe || fe->vlinks->empty())
+    return fd;
+  fd.header = fe->type == FWD_ROUTED ? tp.kFwdMagic : tp.kDtfMagic;
+  fd.type = fe->type;
+  fd.vlinks = fe->vlinks;
+  fd.vlink = fe->vlinks->front();
+  for(auto & vl : *fe->vlinks)
   {
-    if(mac_routes_.at(mac).vl->is_valid_)
-      rv = true;
-    else
-      mac_routes_.erase(mac);
+    if(vl->IsReady())
+    {
+      fd.vlink = vl;
+      break;
+    }
+  }
+  return fd;
+}
+
+ForwardingDecision
+PeerNetwork::Lookup(
+  const MacAddressType& mac,
+  FlowCache & cache)
+{
+  ForwardingDecision fd;
+  uint32_t gen = generation_.load(std::memory_order_acquire);
+  if(!cache.Find(mac, gen, fd))
+  {
+    fd = Lookup(mac);
+    cache.Insert(mac, gen, fd);
+  }
+  return fd;
+}
+
+/*
+A learning bridge over the vlinks. An unknown source is installed as a route
+through the peer of the ingress vlink, a learned source seen through another
+peer has moved and its route follows it, and any observation refreshes its
+age. Adjacent peers and installed routes are never overridden. The common case
+of a known source is resolved by the cache, and any source with the data path
+lock alone.
+*/
+bool
+PeerNetwork::Learn(
+  const MacAddressType & src,
+  VirtualLink & ingress,
+  bool bridged,
+  LearnCache & cache)
+{
+  uint32_t gen = generation_.load(std::memory_order_acquire);
+  uint32_t tick = Now();
+  if(cache.Seen(src, &ingress, gen, tick))
+    return false;
+  FWD_TYPE type = bridged ? FWD_BRIDGED : FWD_ROUTED;
+  {
+    lock_guard<mutex> lg(mac_map_mtx_);
+    auto itr = fwd_table_->find(src);
+    if(itr != fwd_table_->end() &&
+      !itr->second.expired.load(std::memory_order_relaxed))
+      return false;
+    auto litr = learned_.find(src);
+    if(litr != learned_.end())
+    {
+      FwdEntry & fe = litr->second;
+      if(fe.type == type && std::find_if(fe.vlinks->begin(), fe.vlinks->end(),
+        [&ingress](const shared_ptr<VirtualLink> & vl)
+      {
+        return vl.get() == &ingress;
+      }) != fe.vlinks->end())
+      {
+        fe.accessed.store(tick, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    else if(learned_count_.load(std::memory_order_relaxed) >= kMaxLearned)
+      return false;
   }
-  return rv;
+  MacAddressType path;
+  if(StringToByteArray(ingress.PeerInfo().mac_address, path.begin(),
+    path.end()) != 6 || path == src)
+    return false;
+  lock_guard<mutex> lg(mac_map_mtx_);
+  auto pitr = fwd_table_->find(path);
+  if(pitr == fwd_table_->end() || pitr->second.type != FWD_ADJACENT)
+    return false;
+  shared_ptr<const VlinkGroup> vlinks = pitr->second.vlinks;
+  auto iitr = fwd_table_->find(src);
+  if(iitr != fwd_table_->end() &&
+    !iitr->second.expired.load(std::memory_order_relaxed))
+    return false;
+  auto itr = learned_.find(src);
+  if(itr == learned_.end())
+  {
+    if(learned_count_.load(std::memory_order_relaxed) >= kMaxLearned)
+      return false;
+    FwdEntry & fe = learned_[src];
+    fe.timer_id = ++next_timer_id_;
+    learned_timers_.Schedule(RouteTimer{ src, fe.timer_id },
+      tick + kLearnedExpiry);
+    learned_count_++;
+    itr = learned_.find(src);
+  }
+  else if(itr->second.path != path || itr->second.type != type)
+  {
+    LOG(LS_INFO) << "Learned MAC " << ByteArrayToString(src.begin(), src.end())
+      << " moved to " << ByteArrayToString(path.begin(), path.end());
+  }
+  FwdEntry & fe = itr->second;
+  fe.type = type;
+  fe.vlinks = vlinks;
+  fe.path = path;
+  fe.accessed.store(tick, std::memory_order_relaxed);
+  generation_++;
+  return true;
 }
 
 vector<string>
@@ -149,16 +392,44 @@ PeerNetwork::QueryVlinks()
 {
   vector<string> vlids;
   lock_guard<mutex> lg(mac_map_mtx_);
-  for(auto vl : mac_map_)
+  for(auto & vl : link_map_)
   {
-    vlids.push_back(vl.second->Id());
+    vlids.push_back(vl.first);
   }
   return vlids;
 }
 
+void
+PeerNetwork::QueryVlinks(
+  vector<shared_ptr<VirtualLink>> & vlinks)
+{
+  lock_guard<mutex> lg(mac_map_mtx_);
+  for(auto & vl : link_map_)
+    vlinks.push_back(vl.second);
+}
+
+void
+PeerNetwork::AdjacentVlinks(
+  vector<shared_ptr<VirtualLink>> & vlinks)
+{
+  map<string, shared_ptr<VirtualLink>> peers;
+  lock_guard<mutex> lg(mac_map_mtx_);
+  for(auto & vl : link_map_)
+  {
+    shared_ptr<VirtualLink> & pvl = peers[vl.second->PeerInfo().mac_address];
+    if(!pvl || (!pvl->IsReady() && vl.second->IsReady()))
+      pvl = vl.second;
+  }
+  for(auto & pvl : peers)
+  {
+    vlinks.push_back(pvl.second);
+  }
+}
+
 /*
-Used when a vlink is removed and the peer is no longer adjacent. All routes that
-use this path must be removed as well.
+Used when a vlink is removed. The remaining vlinks to the peer continue to
+carry its traffic and that of the routes through it, when none remain the peer
+is no longer adjacent and its routes become unusable until they expire.
 */
 void
 PeerNetwork::Remove(
@@ -166,15 +437,37 @@ PeerNetwork::Remove(
 {
   try
   {
-    lock_guard<mutex> lg(mac_map_mtx_);
-    shared_ptr<VirtualLink> vl = link_map_.at(link_id);
+    lock_guard<mutex> rlg(rebuild_mtx_);
+    shared_ptr<VirtualLink> vl;
+    {
+      lock_guard<mutex> lg(mac_map_mtx_);
+      vl = link_map_.at(link_id);
+    }
     vl->is_valid_ = false;
     //remove the MAC for the adjacent node when tnl goes out of scope ref count
     //is decr, if it is 0 it's deleted 
     MacAddressType mac;
     StringToByteArray(vl->PeerInfo().mac_address, mac.begin(), mac.end());
-    mac_map_.erase(mac);
+    shared_ptr<const FwdTable> table = BeginBuild();
+    shared_ptr<VlinkGroup> vlinks = make_shared<VlinkGroup>();
+    auto itr = table->find(mac);
+    if(itr != table->end() && itr->second.type == FWD_ADJACENT)
+    {
+      for(auto & pvl : *itr->second.vlinks)
+      {
+        if(pvl != vl)
+          vlinks->push_back(pvl);
+      }
+    }
+    shared_ptr<FwdTable> update = CopyTable(*table, false);
+    UpdatePaths(*update, mac, vlinks);
+    lock_guard<mutex> ulg(update_mtx_);
+    EndBuild(*update);
+    table = move(update);
+    lock_guard<mutex> lg(mac_map_mtx_);
     link_map_.erase(vl->Id());
+    UpdateLearnedPaths(mac, vlinks);
+    Publish(table);
   } catch(exception & e)
   {
     LOG(LS_WARNING) << e.what();
@@ -187,69 +480,295 @@ PeerNetwork::Remove(
 }
 
 void
-PeerNetwork::Run(Thread* thread)
+PeerNetwork::Start(
+  Thread * timer_thread)
+{
+  timer_thread_ = timer_thread;
+  timer_thread_->PostDelayed(RTC_FROM_HERE, kTickInterval, this, MSGID_TICK);
+}
+
+void
+PeerNetwork::Stop()
+{
+  if(!timer_thread_)
+    return;
+  //cancel on the timer thread itself so no tick can be in progress
+  timer_thread_->Invoke<void>(RTC_FROM_HERE, [this]()
+  {
+    timer_thread_->Clear(this);
+  });
+  timer_thread_ = nullptr;
+}
+
+void
+PeerNetwork::OnMessage(
+  Message * msg)
+{
+  if(msg->message_id != MSGID_TICK)
+    return;
+  uint32_t now = tick_.fetch_add(1, std::memory_order_relaxed) + 1;
+  ExpireRoutes(now);
+  //Cached decisions do not refresh the route access time, invalidating them
+  //periodically forces active flows back through Lookup() before expiry.
+  if(now % kCacheRefresh == 0)
+    generation_++;
+  SignalTick(now);
+  timer_thread_->PostDelayed(RTC_FROM_HERE, kTickInterval, this, MSGID_TICK);
+}
+
+/*
+Only the routes whose timers have come due are examined. A route that was used
+since its timer was set is rescheduled to expire relative to its last access,
+otherwise it is removed along with routes through vlinks that no longer exist.
+Installed routes are only marked as expired, copying the table to drop them
+would hold up the data path that the timer runs on. While a new table is being
+built the expiries are also recorded for it, so the timer never waits on a
+build.
+*/
+void
+PeerNetwork::ExpireRoutes(
+  uint32_t now)
 {
-  steady_clock::time_point accessed;
-  milliseconds expiry_period = 3 * scavenge_interval;
-  while(thread->ProcessMessages((int)scavenge_interval.count()))
+  uint32_t expired = 0;
+  vector<RouteTimer> fired;
   {
-    accessed = steady_clock::now();
-    list<MacAddressType> ml;
-    lock_guard<mutex> lgm(mac_map_mtx_);
-    for(auto & i : mac_routes_)
+    lock_guard<mutex> lg(mac_map_mtx_);
+    learned_timers_.Advance(now, fired);
+    for(auto & rt : fired)
     {
-      if(!i.second.vl->is_valid_)
-        ml.push_back(i.first);
-      else
+      auto itr = learned_.find(rt.mac);
+      if(itr == learned_.end() || itr->second.timer_id != rt.timer_id)
+        continue;
+      uint32_t accessed =
+        itr->second.accessed.load(std::memory_order_relaxed);
+      if(!itr->second.vlinks->empty() && now - accessed < kLearnedExpiry)
       {
-        std::chrono::duration<double, milli> elapsed = steady_clock::now()
-          - i.second.accessed;
-        if(elapsed > expiry_period)
-          ml.push_back(i.first);
+        learned_timers_.Schedule(rt, accessed + kLearnedExpiry);
+        continue;
       }
+      LOG(LS_INFO) << "Expiring learned MAC "
+        << ByteArrayToString(rt.mac.begin(), rt.mac.end());
+      learned_.erase(itr);
+      learned_count_--;
+      expired++;
     }
-    for(auto & mac : ml)
-    {
-      LOG(LS_INFO) << "Scavenging route to "
-        << ByteArrayToString(mac.begin(), mac.end());
-      mac_routes_.erase(mac);
-    }
-    if(LOG_CHECK_LEVEL(LS_INFO))
+  }
+  fired.clear();
+  lock_guard<mutex> ulg(update_mtx_);
+  route_timers_.Advance(now, fired);
+  if(!fired.empty())
+  {
+    lock_guard<mutex> lg(mac_map_mtx_);
+    for(auto & rt : fired)
     {
-      LOG(LS_INFO) << "PeerNetwork scavenge took "
-        << (steady_clock::now() - accessed).count() << " nanosecs.";
+      auto itr = fwd_table_->find(rt.mac);
+      if(itr == fwd_table_->end() || itr->second.type == FWD_ADJACENT ||
+        itr->second.timer_id != rt.timer_id ||
+        itr->second.expired.load(std::memory_order_relaxed))
+        continue;
+      uint32_t accessed =
+        itr->second.accessed.load(std::memory_order_relaxed);
+      if(!itr->second.vlinks->empty() && now - accessed < kRouteExpiry)
+      {
+        route_timers_.Schedule(rt, accessed + kRouteExpiry);
+        continue;
+      }
+      LOG(LS_INFO) << "Expiring route to "
+        << ByteArrayToString(rt.mac.begin(), rt.mac.end());
+      itr->second.expired.store(true, std::memory_order_relaxed);
+      if(building_)
+        build_expiries_.push_back(rt);
+      expired++;
     }
   }
+  if(expired)
+    generation_++;
 }
 
-void PeerNetwork::UpdateRouteTable(
-  MacAddressType & dest,
-  MacAddressType & route)
+shared_ptr<const PeerNetwork::FwdTable>
+PeerNetwork::BeginBuild()
 {
+  lock_guard<mutex> ulg(update_mtx_);
+  building_ = true;
+  build_expiries_.clear();
   lock_guard<mutex> lg(mac_map_mtx_);
-  //for(uint32_t i = 0; i < rts_desc["Table"].size(); i++)
-  //{
-  //  Json::Value & entry = rts_desc[i];
-  //  entry["Identifier"]
-  //    entry["Action"]
-  //    entry["Destination"]
-  //    entry["Path"]
-  //}
-
-  if(dest == route || mac_map_.count(route) == 0 ||
-    (mac_map_.count(route) && !mac_map_.at(route)->is_valid_))
-  {
-    stringstream oss;
-    oss << "Attempt to add INVALID route! DEST=" <<
-      ByteArrayToString(dest.begin(), dest.end()) << " ROUTE=" <<
-      ByteArrayToString(route.begin(), route.end());
-    throw TCEXCEPT(oss.str().c_str());
-  }
-  mac_routes_[dest].vl = mac_map_.at(route);
-  mac_routes_[dest].accessed = steady_clock::now();
-  LOG(LS_INFO) << "Updated route to node=" <<
-    ByteArrayToString(dest.begin(), dest.end()) << " through node=" <<
-    ByteArrayToString(route.begin(), route.end()) << " vlink obj=" <<
-    mac_routes_[dest].vl.get();
+  return fwd_table_;
+}
+
+void
+PeerNetwork::EndBuild(
+  FwdTable & table)
+{
+  for(auto & rt : build_expiries_)
+  {
+    auto itr = table.find(rt.mac);
+    if(itr != table.end() && itr->second.timer_id == rt.timer_id)
+      table.erase(itr);
+  }
+  build_expiries_.clear();
+  building_ = false;
+}
+
+shared_ptr<PeerNetwork::FwdTable>
+PeerNetwork::CopyTable(
+  const FwdTable & table,
+  bool adjacent_only)
+{
+  shared_ptr<FwdTable> copy = make_shared<FwdTable>();
+  copy->reserve(table.size());
+  for(auto & i : table)
+  {
+    if(i.second.expired.load(std::memory_order_relaxed) ||
+      (adjacent_only && i.second.type != FWD_ADJACENT))
+      continue;
+    (*copy)[i.first] = i.second;
+  }
+  return copy;
+}
+
+/*
+Routes hold the group of their path so a lookup is resolved with one probe,
+which costs a walk of the table whenever the vlinks to a peer change.
+*/
+void
+PeerNetwork::UpdatePaths(
+  FwdTable & table,
+  const MacAddressType & mac,
+  shared_ptr<const VlinkGroup> vlinks)
+{
+  if(vlinks->empty())
+    table.erase(mac);
+  else
+  {
+    FwdEntry & fe = table[mac];
+    fe.type = FWD_ADJACENT;
+    fe.vlinks = vlinks;
+  }
+  for(auto & i : table)
+  {
+    if(i.second.type != FWD_ADJACENT && i.second.path == mac)
+      i.second.vlinks = vlinks;
+  }
+}
+
+void
+PeerNetwork::UpdateLearnedPaths(
+  const MacAddressType & mac,
+  shared_ptr<const VlinkGroup> vlinks)
+{
+  for(auto & i : learned_)
+  {
+    if(i.second.path == mac)
+      i.second.vlinks = vlinks;
+  }
+}
+
+void
+PeerNetwork::Publish(
+  shared_ptr<const FwdTable> & table)
+{
+  fwd_table_.swap(table);
+  vector<MacAddressType> shadowed;
+  for(auto & i : learned_)
+  {
+    if(fwd_table_->count(i.first))
+      shadowed.push_back(i.first);
+  }
+  for(auto & mac : shadowed)
+    learned_.erase(mac);
+  learned_count_ = (uint32_t)learned_.size();
+  generation_++;
+}
+
+/*
+Applies a batch of route additions and removals. The new table is built from a
+copy of the published one, which is never modified, so the data path lock is
+only taken to read the table pointer and to swap in the result. Learning and
+expiries carry on during the build, the routes that expire are dropped from the
+new table when it is swapped in. With replace set all existing routes are
+dropped and only the adjacent peers and the learned MACs are carried over.
+Updates that do not refer to a valid adjacent peer are rejected and counted.
+Installed routes take the place of learned ones.
+*/
+RouteUpdateStats
+PeerNetwork::UpdateRouteTable(
+  const vector<RouteUpdate> & updates,
+  bool replace)
+{
+  RouteUpdateStats rus;
+  steady_clock::time_point start = steady_clock::now();
+  lock_guard<mutex> rlg(rebuild_mtx_);
+  shared_ptr<FwdTable> table = CopyTable(*BeginBuild(), replace);
+  uint32_t tick = Now();
+  vector<pair<RouteTimer, uint32_t>> timers;
+  timers.reserve(updates.size());
+  for(auto & ru : updates)
+  {
+    if(ru.remove)
+    {
+      auto itr = table->find(ru.dest);
+      if(itr != table->end() && itr->second.type != FWD_ADJACENT)
+      {
+        table->erase(itr);
+        rus.removed++;
+      }
+      continue;
+    }
+    auto itr = table->find(ru.path);
+    if(ru.dest == ru.path || itr == table->end() ||
+      itr->second.type != FWD_ADJACENT)
+    {
+      LOG(LS_INFO) << "Attempt to add INVALID route! DEST=" <<
+        ByteArrayToString(ru.dest.begin(), ru.dest.end()) << " ROUTE=" <<
+        ByteArrayToString(ru.path.begin(), ru.path.end());
+      rus.rejected++;
+      continue;
+    }
+    shared_ptr<const VlinkGroup> vlinks = itr->second.vlinks;
+    FwdEntry & fe = (*table)[ru.dest];
+    if(fe.type == FWD_ADJACENT)
+    {
+      rus.rejected++;
+      continue;
+    }
+    fe.type = FWD_ROUTED;
+    fe.vlinks = vlinks;
+    fe.path = ru.path;
+    fe.accessed.store(tick, std::memory_order_relaxed);
+    fe.timer_id = ++next_timer_id_;
+    timers.push_back(make_pair(RouteTimer{ ru.dest, fe.timer_id },
+      tick + kRouteExpiry));
+    rus.added++;
+  }
+  for(auto & i : *table)
+  {
+    if(i.second.type != FWD_ADJACENT)
+      rus.routes++;
+  }
+  steady_clock::time_point now = steady_clock::now();
+  rus.build_time =
+    std::chrono::duration_cast<std::chrono::microseconds>(now - start);
+  shared_ptr<const FwdTable> published;
+  {
+    lock_guard<mutex> ulg(update_mtx_);
+    EndBuild(*table);
+    published = move(table);
+    lock_guard<mutex> lg(mac_map_mtx_);
+    Publish(published);
+  }
+  rus.swap_time = std::chrono::duration_cast<std::chrono::microseconds>(
+    steady_clock::now() - now);
+  //the replaced table is freed here, outside of the data path lock
+  published.reset();
+  //the timers are added in batches so the tick is not held up for long
+  for(size_t i = 0; i < timers.size(); i += kTimerBatch)
+  {
+    lock_guard<mutex> ulg(update_mtx_);
+    for(size_t j = i; j < timers.size() && j < i + kTimerBatch; j++)
+      route_timers_.Schedule(timers[j].first, timers[j].second);
+  }
+  LOG(LS_INFO) << "Route table updated, added=" << rus.added << " removed=" <<
+    rus.removed << " rejected=" << rus.rejected << " routes=" << rus.routes;
+  return rus;
 }
 } // namespace tincan
@@ -0,0 +1,142 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#include "pending_route_queue.h"
+namespace tincan
+{
+PendingRouteQueue::PendingRouteQueue() :
+  stats_{ 0, 0, 0, 0, 0, 0 }
+{}
+
+bool
+PendingRouteQueue::Enqueue(
+  const MacAddressType & dest,
+  unique_ptr<TapFrame> frame,
+  uint32_t now,
+  string & data)
+{
+  lock_guard<mutex> lg(mtx_);
+  auto itr = pending_.find(dest);
+  if(itr == pending_.end())
+  {
+    if(pending_.size() >= kMaxPending)
+    {
+      stats_.dropped++;
+      return false;
+    }
+    PendingRoute & pr = pending_[dest];
+    pr.requested = now;
+    pr.expiry = now + kResolveTimeout;
+    data = ByteArrayToString(frame->Payload(), frame->PayloadEnd());
+    pr.frames.push_back(move(frame));
+    stats_.buffered++;
+    stats_.requests++;
+    return true;
+  }
+  PendingRoute & pr = itr->second;
+  if(pr.negative)
+  {
+    stats_.dropped++;
+    return false;
+  }
+  bool request = now - pr.requested >= kRequestInterval;
+  if(request)
+  {
+    pr.requested = now;
+    data = ByteArrayToString(frame->Payload(), frame->PayloadEnd());
+    stats_.requests++;
+  }
+  else
+    stats_.suppressed++;
+  if(pr.frames.size() < kMaxFrames)
+  {
+    pr.frames.push_back(move(frame));
+    stats_.buffered++;
+  }
+  else
+    stats_.dropped++;
+  return request;
+}
+
+void
+PendingRouteQueue::Release(
+  const std::function<bool(const MacAddressType &)> & resolved,
+  vector<unique_ptr<TapFrame>> & frames)
+{
+  lock_guard<mutex> lg(mtx_);
+  for(auto itr = pending_.begin(); itr != pending_.end();)
+  {
+    if(!resolved(itr->first))
+    {
+      ++itr;
+      continue;
+    }
+    stats_.flushed += itr->second.frames.size();
+    for(auto & frame : itr->second.frames)
+      frames.push_back(move(frame));
+    itr = pending_.erase(itr);
+  }
+}
+
+void
+PendingRouteQueue::Expire(
+  uint32_t now)
+{
+  lock_guard<mutex> lg(mtx_);
+  for(auto itr = pending_.begin(); itr != pending_.end();)
+  {
+    PendingRoute & pr = itr->second;
+    if((int32_t)(now - pr.expiry) < 0)
+    {
+      ++itr;
+      continue;
+    }
+    if(pr.negative)
+    {
+      itr = pending_.erase(itr);
+      continue;
+    }
+    LOG(LS_INFO) << "No route found to "
+      << ByteArrayToString(itr->first.begin(), itr->first.end());
+    stats_.dropped += pr.frames.size();
+    pr.frames.clear();
+    pr.negative = true;
+    pr.expiry = now + kNegativeTtl;
+    ++itr;
+  }
+}
+
+void
+PendingRouteQueue::Clear()
+{
+  lock_guard<mutex> lg(mtx_);
+  pending_.clear();
+}
+
+PendingRouteStats
+PendingRouteQueue::Stats()
+{
+  lock_guard<mutex> lg(mtx_);
+  stats_.pending = (uint32_t)pending_.size();
+  return stats_;
+}
+} // namespace tincan
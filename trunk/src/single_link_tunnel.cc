@@ -28,8 +28,14 @@ namespace tincan
 {
 SingleLinkTunnel::SingleLinkTunnel(
   unique_ptr<TunnelDescriptor> descriptor,
-  IpopControllerLink * ctrl_handle) :
-  BasicTunnel(move(descriptor), ctrl_handle)
+  IpopControllerLink * ctrl_handle,
+  unique_ptr<TapDevInf> tdev) :
+  BasicTunnel(move(descriptor), ctrl_handle, move(tdev))
+{}
+
+void
+SingleLinkTunnel::ConfigureReplication(
+  const Json::Value & rp_descr)
 {}
 
 shared_ptr<VirtualLink>
@@ -91,6 +97,14 @@ void SingleLinkTunnel::QueryLinkIds(vector<string>& link_ids)
     link_ids.push_back(vlink_->Id());
 }
 
+void
+SingleLinkTunnel::QueryVlinks(
+  vector<shared_ptr<VirtualLink>> & vlinks)
+{
+  if(vlink_)
+    vlinks.push_back(vlink_);
+}
+
 void SingleLinkTunnel::QueryLinkInfo(
   const string & vlink_id,
   Json::Value & vlink_info)
@@ -184,7 +198,19 @@ void SingleLinkTunnel::RemoveLink(
 
 void
 SingleLinkTunnel::UpdateRouteTable(
-  const Json::Value & rt_descr)
+  const Json::Value & rt_descr,
+  Json::Value & rt_info)
+{}
+
+void
+SingleLinkTunnel::UpdateIp4RouteTable(
+  const Json::Value & rt_descr,
+  Json::Value & rt_info)
+{}
+
+void
+SingleLinkTunnel::UpdateBroadcastTree(
+  const Json::Value & bct_descr)
 {}
 
 /*
@@ -195,6 +221,7 @@ void SingleLinkTunnel::VlinkReadComplete(
   uint32_t data_len,
   VirtualLink & vlink)
 {
+  uint64_t received = LatencyStamp();
   unique_ptr<TapFrame> frame = make_unique<TapFrame>(data, data_len);
   TapFrameProperties fp(*frame);
   if(fp.IsDtfMsg())
@@ -203,21 +230,12 @@ void SingleLinkTunnel::VlinkReadComplete(
     frame->BufferToTransfer(frame->Payload()); //write frame payload to TAP
     frame->BytesToTransfer(frame->PayloadLength());
     frame->SetWriteOp();
+    RecordVlinkToTap(*frame, vlink, received);
     tdev_->Write(*frame.release());
   }
   else if(fp.IsIccMsg())
   { // this is an ICC message, deliver to the ipop-controller
-    unique_ptr<TincanControl> ctrl = make_unique<TincanControl>();
-    ctrl->SetControlType(TincanControl::CTTincanRequest);
-    Json::Value & req = ctrl->GetRequest();
-    req[TincanControl::Command] = TincanControl::ICC;
-    req[TincanControl::TunnelId] = descriptor_->uid;
-    req[TincanControl::LinkId] = vlink.Id();
-    req[TincanControl::Data] = string((char*)frame->Payload(),
-      frame->PayloadLength());
-    //LOG(LS_INFO) << " Delivering ICC to ctrl, data=\n"
-    //<< req[TincanControl::Data].asString();
-    ctrl_link_->Deliver(move(ctrl));
+    DeliverIcc(*frame, vlink);
   }
   else
   {
@@ -238,6 +256,9 @@ void SingleLinkTunnel::TapReadComplete(
   }
   else if(!vlink_)
   {
+    tap_counters_.frames_in.fetch_add(1, std::memory_order_relaxed);
+    tap_counters_.bytes_in.fetch_add(frame->BytesTransferred(),
+      std::memory_order_relaxed);
     // vlink is not yet created or has been destroyed, keep posting reads
     frame->Initialize();
     frame->BufferToTransfer(frame->Payload());
@@ -251,6 +272,10 @@ void SingleLinkTunnel::TapReadComplete(
   }
   else
   {
+    tap_counters_.frames_in.fetch_add(1, std::memory_order_relaxed);
+    tap_counters_.bytes_in.fetch_add(frame->BytesTransferred(),
+      std::memory_order_relaxed);
+    StampTapRead(*frame);
     frame->PayloadLength(frame->BytesTransferred());
     frame->BufferToTransfer(frame->Begin()); //write frame header + PL to vlink
     frame->BytesToTransfer(frame->Length());
@@ -265,8 +290,17 @@ void SingleLinkTunnel::TapReadComplete(
 void SingleLinkTunnel::TapWriteComplete(
   AsyncIo * aio_wr)
 {
-  //TapFrame * frame = static_cast<TapFrame*>(aio_wr->context_);
-  delete static_cast<TapFrame*>(aio_wr->context_);
+  TapFrame * frame = static_cast<TapFrame*>(aio_wr->context_);
+  if(frame->IsGood())
+  {
+    tap_counters_.frames_out.fetch_add(1, std::memory_order_relaxed);
+    tap_counters_.bytes_out.fetch_add(frame->BytesTransferred(),
+      std::memory_order_relaxed);
+    RecordTapWrite(*frame);
+  }
+  else
+    tap_counters_.errors.fetch_add(1, std::memory_order_relaxed);
+  delete frame;
 }
 
 } // end namespace tincan
@@ -0,0 +1,195 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#if !defined(_IPOP_WIN)
+#include "stats_region.h"
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include "tincan_exception.h"
+namespace tincan
+{
+StatsRegion::StatsRegion(
+  const std::string & path,
+  uint32_t tunnel_slots,
+  uint32_t link_slots) :
+  path_(path),
+  base_(nullptr),
+  size_(sizeof(StatsRegionHeader) + tunnel_slots * sizeof(TunnelStatsSlot) +
+    link_slots * sizeof(LinkStatsSlot)),
+  hdr_(nullptr)
+{
+  //a new inode, so a reader still mapping a previous region is unaffected
+  unlink(path_.c_str());
+  int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if(fd == -1)
+  {
+    std::ostringstream oss;
+    oss << "Failed to create the stats region " << path_ << ", errno="
+      << errno;
+    throw TCEXCEPT(oss.str().c_str());
+  }
+  if(ftruncate(fd, (off_t)size_) != 0)
+  {
+    close(fd);
+    unlink(path_.c_str());
+    throw TCEXCEPT("Failed to size the stats region");
+  }
+  void * base = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(base == MAP_FAILED)
+  {
+    unlink(path_.c_str());
+    throw TCEXCEPT("Failed to map the stats region");
+  }
+  //the file is zero filled, so every slot starts out free
+  base_ = (uint8_t*)base;
+  hdr_ = (StatsRegionHeader*)base_;
+  hdr_->header_size = sizeof(StatsRegionHeader);
+  hdr_->version = kStatsRegionVersion;
+  hdr_->tunnel_slots = tunnel_slots;
+  hdr_->tunnel_slot_size = sizeof(TunnelStatsSlot);
+  hdr_->link_slots = link_slots;
+  hdr_->link_slot_size = sizeof(LinkStatsSlot);
+  hdr_->publish_interval = kPublishInterval;
+  hdr_->pid = (uint32_t)getpid();
+  hdr_->created_ms = (uint64_t)std::chrono::duration_cast<
+    std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  std::atomic_thread_fence(std::memory_order_release);
+  hdr_->magic = kStatsRegionMagic;
+  //handed out lowest index first
+  for(uint32_t i = tunnel_slots; i > 0; i--)
+    free_tunnels_.push_back(i - 1);
+  for(uint32_t i = link_slots; i > 0; i--)
+    free_links_.push_back(i - 1);
+}
+
+StatsRegion::~StatsRegion()
+{
+  if(base_)
+  {
+    munmap(base_, size_);
+    unlink(path_.c_str());
+  }
+}
+
+TunnelStatsSlot *
+StatsRegion::TunnelSlot(
+  uint32_t index)
+{
+  return (TunnelStatsSlot*)(base_ + hdr_->header_size +
+    (size_t)index * hdr_->tunnel_slot_size);
+}
+
+LinkStatsSlot *
+StatsRegion::LinkSlot(
+  uint32_t index)
+{
+  return (LinkStatsSlot*)(base_ + hdr_->header_size +
+    (size_t)hdr_->tunnel_slots * hdr_->tunnel_slot_size +
+    (size_t)index * hdr_->link_slot_size);
+}
+
+static void
+CopyId(
+  char (&dest)[kStatsIdSize],
+  const std::string & id)
+{
+  memset(dest, 0, kStatsIdSize);
+  memcpy(dest, id.c_str(), std::min(id.length(), kStatsIdSize - 1));
+}
+
+TunnelStatsSlot *
+StatsRegion::AcquireTunnelSlot(
+  const std::string & tnl_id)
+{
+  uint32_t index;
+  {
+    std::lock_guard<std::mutex> lg(mtx_);
+    if(free_tunnels_.empty())
+      return nullptr;
+    index = free_tunnels_.back();
+    free_tunnels_.pop_back();
+  }
+  TunnelStatsSlot * slot = TunnelSlot(index);
+  BeginSlotWrite(*slot);
+  CopyId(slot->tunnel_id, tnl_id);
+  for(auto & value : slot->values)
+    value.store(0, std::memory_order_relaxed);
+  slot->in_use.store(1, std::memory_order_relaxed);
+  EndSlotWrite(*slot);
+  return slot;
+}
+
+LinkStatsSlot *
+StatsRegion::AcquireLinkSlot(
+  const std::string & tnl_id,
+  const std::string & link_id)
+{
+  uint32_t index;
+  {
+    std::lock_guard<std::mutex> lg(mtx_);
+    if(free_links_.empty())
+      return nullptr;
+    index = free_links_.back();
+    free_links_.pop_back();
+  }
+  LinkStatsSlot * slot = LinkSlot(index);
+  BeginSlotWrite(*slot);
+  CopyId(slot->tunnel_id, tnl_id);
+  CopyId(slot->link_id, link_id);
+  for(auto & value : slot->values)
+    value.store(0, std::memory_order_relaxed);
+  slot->in_use.store(1, std::memory_order_relaxed);
+  EndSlotWrite(*slot);
+  return slot;
+}
+
+void
+StatsRegion::Release(
+  TunnelStatsSlot * slot)
+{
+  BeginSlotWrite(*slot);
+  slot->in_use.store(0, std::memory_order_relaxed);
+  EndSlotWrite(*slot);
+  uint32_t index = (uint32_t)(((uint8_t*)slot - base_ - hdr_->header_size) /
+    hdr_->tunnel_slot_size);
+  std::lock_guard<std::mutex> lg(mtx_);
+  free_tunnels_.push_back(index);
+}
+
+void
+StatsRegion::Release(
+  LinkStatsSlot * slot)
+{
+  BeginSlotWrite(*slot);
+  slot->in_use.store(0, std::memory_order_relaxed);
+  EndSlotWrite(*slot);
+  uint32_t index = (uint32_t)(((uint8_t*)slot - base_ - hdr_->header_size -
+    (size_t)hdr_->tunnel_slots * hdr_->tunnel_slot_size) /
+    hdr_->link_slot_size);
+  std::lock_guard<std::mutex> lg(mtx_);
+  free_links_.push_back(index);
+}
+} // namespace tincan
+#endif // !_IPOP_WIN
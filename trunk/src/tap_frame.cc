@@ -27,7 +27,9 @@ namespace tincan
 TapFrame::TapFrame() :
   AsyncIo(),
   tfb_(nullptr),
-  pl_len_(0)
+  pl_len_(0),
+  entry_ns_(0),
+  stage_ns_(0)
 {
     AsyncIo::Initialize(nullptr, 0, this, AIO_READ, 0);
 }
@@ -35,7 +37,10 @@ TapFrame::TapFrame() :
 TapFrame::TapFrame(const TapFrame & rhs) :
   AsyncIo(),
   tfb_(nullptr),
-  pl_len_(rhs.pl_len_)
+  pl_len_(rhs.pl_len_),
+  entry_ns_(rhs.entry_ns_),
+  stage_ns_(rhs.stage_ns_),
+  vlink_latencies_(rhs.vlink_latencies_)
 {
   if(rhs.tfb_)
   {
@@ -49,7 +54,10 @@ TapFrame::TapFrame(const TapFrame & rhs) :
 TapFrame::TapFrame(TapFrame && rhs) :
   AsyncIo(),
   tfb_(rhs.tfb_),
-  pl_len_(rhs.pl_len_)
+  pl_len_(rhs.pl_len_),
+  entry_ns_(rhs.entry_ns_),
+  stage_ns_(rhs.stage_ns_),
+  vlink_latencies_(move(rhs.vlink_latencies_))
 {
   rhs.tfb_ = nullptr;
   AsyncIo::Initialize(tfb_->data(), rhs.bytes_to_transfer_, this,
@@ -63,9 +71,11 @@ sets up the frame for write IO.
 TapFrame::TapFrame(
   uint8_t * in_buf,
   uint32_t buf_len) :
-  pl_len_(buf_len - tp.kTapHeaderSize)
+  pl_len_(buf_len - tp.kTapHeaderSize),
+  entry_ns_(0),
+  stage_ns_(0)
 {
-  if(buf_len > tp.kTapBufferSize)
+  if(buf_len > tp.kTapBufferSize + tp.kBctTrailerSize)
     throw TCEXCEPT("Input data is larger than the maximum allowed");
   tfb_ = new TapFrameBuffer;
   memcpy(tfb_->data(), in_buf, buf_len);
@@ -87,6 +97,9 @@ TapFrame::operator= (TapFrame & rhs)
   AsyncIo::Initialize(tfb_->data(), rhs.bytes_to_transfer_, this,
     rhs.flags_, rhs.bytes_transferred_);
   pl_len_ = rhs.pl_len_;
+  entry_ns_ = rhs.entry_ns_;
+  stage_ns_ = rhs.stage_ns_;
+  vlink_latencies_ = rhs.vlink_latencies_;
   return *this;
 }
 
@@ -99,6 +112,9 @@ TapFrame::operator= (TapFrame && rhs)
   AsyncIo::Initialize(tfb_->data(), rhs.bytes_to_transfer_, this,
     rhs.flags_, rhs.bytes_transferred_);
   pl_len_ = rhs.pl_len_;
+  entry_ns_ = rhs.entry_ns_;
+  stage_ns_ = rhs.stage_ns_;
+  vlink_latencies_ = move(rhs.vlink_latencies_);
 
   rhs.tfb_ = nullptr;
   rhs.buffer_to_transfer_ = nullptr;
@@ -107,6 +123,8 @@ TapFrame::operator= (TapFrame && rhs)
   rhs.bytes_to_transfer_ = 0;
   rhs.flags_ = AIO_WRITE;
   rhs.pl_len_ = 0;
+  rhs.entry_ns_ = 0;
+  rhs.stage_ns_ = 0;
   return *this;
 }
 
@@ -151,6 +169,9 @@ TapFrame::operator [](
 TapFrame & TapFrame::Initialize()
 {
   pl_len_ = 0;
+  entry_ns_ = 0;
+  stage_ns_ = 0;
+  vlink_latencies_.reset();
   if(!tfb_)
   {
     tfb_ = new TapFrameBuffer;
@@ -166,6 +187,9 @@ TapFrame & TapFrame::Initialize(
   uint32_t bytes_transferred)
 {
   pl_len_ = 0;
+  entry_ns_ = 0;
+  stage_ns_ = 0;
+  vlink_latencies_.reset();
   AsyncIo::Initialize(buffer_to_transfer, bytes_to_transfer, this, flags,
     bytes_transferred);
   return *this;
@@ -27,6 +27,7 @@
 namespace tincan
 {
 Tincan::Tincan() :
+  ctrl_link_(nullptr),
   exit_event_(false, false)
 {}
 
@@ -42,6 +43,15 @@ Tincan::SetIpopControllerLink(
   ctrl_link_ = ctrl_handle;
 }
 
+void
+Tincan::ConfigureReplication(
+  const Json::Value & rp_desc)
+{
+  const string & tnl_id = rp_desc[TincanControl::TunnelId].asString();
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->ConfigureReplication(rp_desc);
+}
+
 void Tincan::CreateTunnel(
   const Json::Value & tnl_desc,
   Json::Value & tnl_info)
@@ -68,14 +78,14 @@ void Tincan::CreateTunnel(
     td->turn_descs.push_back(turn_desc);
   }
   td->enable_ip_mapping = false;
-  unique_ptr<BasicTunnel> tnl;
+  shared_ptr<BasicTunnel> tnl;
   if(tnl_desc[TincanControl::Type].asString() == "VNET")
   {
-    tnl = make_unique<MultiLinkTunnel>(move(td), ctrl_link_);
+    tnl = make_shared<MultiLinkTunnel>(move(td), ctrl_link_.load());
   }
   else if(tnl_desc[TincanControl::Type].asString() == "TUNNEL")
   {
-    tnl = make_unique<SingleLinkTunnel>(move(td), ctrl_link_);
+    tnl = make_shared<SingleLinkTunnel>(move(td), ctrl_link_.load());
   }
   else
     throw TCEXCEPT("Invalid Tunnel type specified");
@@ -94,6 +104,10 @@ void Tincan::CreateTunnel(
     if_list[i] = network_ignore_list[i].asString();
   }
   tnl->Configure(move(tap_desc), if_list);
+#if !defined(_IPOP_WIN)
+  tnl->SetStatsRegion(stats_region_.get());
+  tnl->SetIccLink(icc_channel_.get());
+#endif // !_IPOP_WIN
   tnl->Start();
   tnl->QueryInfo(tnl_info);
   lock_guard<mutex> lg(tunnels_mutex_);
@@ -118,25 +132,16 @@ Tincan::CreateVlink(
   }
   else
   {
-    TunnelFromId(tnl_id).QueryInfo(tnl_info);
+    TunnelFromId(tnl_id)->QueryInfo(tnl_info);
   }
-  unique_ptr<PeerDescriptor> peer_desc = make_unique<PeerDescriptor>();
-  peer_desc->uid =
-    link_desc[TincanControl::PeerInfo][TincanControl::UID].asString();
-  peer_desc->vip4 =
-    link_desc[TincanControl::PeerInfo][TincanControl::VIP4].asString();
-  peer_desc->cas =
-    link_desc[TincanControl::PeerInfo][TincanControl::CAS].asString();
-  peer_desc->fingerprint =
-    link_desc[TincanControl::PeerInfo][TincanControl::FPR].asString();
-  peer_desc->mac_address =
-    link_desc[TincanControl::PeerInfo][TincanControl::MAC].asString();
+  unique_ptr<PeerDescriptor> peer_desc =
+    ParsePeerInfo(link_desc[TincanControl::PeerInfo]);
 
   vl_desc->dtls_enabled = true;
 
-  BasicTunnel & tnl = TunnelFromId(tnl_id);
+  shared_ptr<BasicTunnel> tnl = TunnelFromId(tnl_id);
   shared_ptr<VirtualLink> vlink =
-    tnl.CreateVlink(move(vl_desc), move(peer_desc));
+    tnl->CreateVlink(move(vl_desc), move(peer_desc));
   unique_ptr<TincanControl> ctrl = make_unique<TincanControl>(control);
   if(!vlink->IsGatheringComplete())
   {
@@ -152,8 +157,171 @@ Tincan::CreateVlink(
     (*resp)["Message"]["CAS"] = vlink->Candidates();
     (*resp)["Success"] = true;
     ctrl->SetResponse(move(resp));
-    ctrl_link_->Deliver(move(ctrl));
+    ctrl_link_.load()->Deliver(move(ctrl));
+  }
+}
+
+/*
+Creates the vlinks described in the Links array, each with its LinkId and
+PeerInfo, and answers with a single response once all of them have their
+candidates. The vlinks gather concurrently, the response lists the outcome of
+each one in the order requested. Vlinks that are removed, or still gathering
+when the batch times out, are reported as failed.
+*/
+void
+Tincan::CreateVlinks(
+  const Json::Value & links_desc,
+  const TincanControl & control)
+{
+  const Json::Value & links = links_desc["Links"];
+  if(!links.isArray() || links.empty())
+    throw TCEXCEPT("No links were specified");
+  unique_ptr<Json::Value> resp = make_unique<Json::Value>(Json::objectValue);
+  Json::Value & tnl_info = (*resp)[TincanControl::Message];
+  string tnl_id = links_desc[TincanControl::TunnelId].asString();
+  if(!IsTunnelExisit(tnl_id))
+  {
+    CreateTunnel(links_desc, tnl_info);
+  }
+  else
+  {
+    TunnelFromId(tnl_id)->QueryInfo(tnl_info);
+  }
+  shared_ptr<BasicTunnel> tnl = TunnelFromId(tnl_id);
+  (*resp)["Success"] = true;
+  shared_ptr<LinkBatch> batch = make_shared<LinkBatch>();
+  batch->ctrl = make_unique<TincanControl>(control);
+  batch->ctrl->SetResponse(move(resp));
+  //the extra count is released once all the vlinks have been created
+  batch->pending = links.size() + 1;
+  vector<string> link_ids(links.size());
+  {
+    std::lock_guard<std::mutex> lg(inprogess_controls_mutex_);
+    Json::Value & results =
+      batch->ctrl->GetResponse()[TincanControl::Message]["Links"];
+    results = Json::Value(Json::arrayValue);
+    results.resize(links.size());
+    for(Json::ArrayIndex i = 0; i < links.size(); i++)
+    {
+      link_ids[i] = links[i][TincanControl::LinkId].asString();
+      results[i][TincanControl::LinkId] = link_ids[i];
+      if(link_ids[i].empty() || batched_links_.count(link_ids[i]) ||
+        inprogess_controls_.count(link_ids[i]))
+      {
+        results[i]["Success"] = false;
+        results[i]["Message"] = "The LinkId is missing or already in progress";
+        batch->pending--;
+        link_ids[i].clear();
+        continue;
+      }
+      batched_links_[link_ids[i]] = BatchedLink{ batch, i, tnl_id };
+    }
   }
+  for(Json::ArrayIndex i = 0; i < links.size(); i++)
+  {
+    if(link_ids[i].empty())
+      continue;
+    try
+    {
+      unique_ptr<VlinkDescriptor> vl_desc = make_unique<VlinkDescriptor>();
+      vl_desc->uid = link_ids[i];
+      vl_desc->dtls_enabled = true;
+      shared_ptr<VirtualLink> vlink = tnl->CreateVlink(move(vl_desc),
+        ParsePeerInfo(links[i][TincanControl::PeerInfo]));
+      vlink->SignalLocalCasReady.connect(this, &Tincan::OnLocalCasUpdated);
+      //gathering may have completed before the handler was connected
+      if(vlink->IsGatheringComplete())
+        CompleteBatchedLink(link_ids[i], true, vlink->Candidates());
+    }
+    catch(exception & e)
+    {
+      LOG(LS_WARNING) << "Creating vlink " << link_ids[i] << " failed. " <<
+        e.what();
+      CompleteBatchedLink(link_ids[i], false, e.what());
+    }
+  }
+  EndBatch(batch);
+  BatchMsgData * md = new BatchMsgData;
+  md->batch = batch;
+  ctl_thread_.PostDelayed(RTC_FROM_HERE, kBatchTimeout, this,
+    MSGID_BATCH_TIMEOUT, md);
+}
+
+bool
+Tincan::CompleteBatchedLink(
+  const string & link_id,
+  bool success,
+  const string & data)
+{
+  shared_ptr<LinkBatch> batch;
+  {
+    std::lock_guard<std::mutex> lg(inprogess_controls_mutex_);
+    auto itr = batched_links_.find(link_id);
+    if(itr == batched_links_.end())
+      return false;
+    batch = itr->second.batch;
+    Json::Value & result = batch->ctrl->GetResponse()
+      [TincanControl::Message]["Links"][itr->second.index];
+    result["Success"] = success;
+    result[success ? "CAS" : "Message"] = data;
+    batched_links_.erase(itr);
+  }
+  EndBatch(batch);
+  return true;
+}
+
+void
+Tincan::EndBatch(
+  shared_ptr<LinkBatch> batch)
+{
+  unique_ptr<TincanControl> ctrl;
+  {
+    std::lock_guard<std::mutex> lg(inprogess_controls_mutex_);
+    if(--batch->pending == 0)
+      ctrl = move(batch->ctrl);
+  }
+  if(ctrl)
+    ctrl_link_.load()->Deliver(move(ctrl));
+}
+
+void
+Tincan::FailBatchedLinks(
+  const std::function<bool(const string &, const BatchedLink &)> & select,
+  const string & reason)
+{
+  vector<shared_ptr<LinkBatch>> batches;
+  {
+    std::lock_guard<std::mutex> lg(inprogess_controls_mutex_);
+    for(auto itr = batched_links_.begin(); itr != batched_links_.end();)
+    {
+      if(!select(itr->first, itr->second))
+      {
+        itr++;
+        continue;
+      }
+      Json::Value & result = itr->second.batch->ctrl->GetResponse()
+        [TincanControl::Message]["Links"][itr->second.index];
+      result["Success"] = false;
+      result["Message"] = reason;
+      batches.push_back(itr->second.batch);
+      itr = batched_links_.erase(itr);
+    }
+  }
+  for(auto & batch : batches)
+    EndBatch(batch);
+}
+
+unique_ptr<PeerDescriptor>
+Tincan::ParsePeerInfo(
+  const Json::Value & peer_info)
+{
+  unique_ptr<PeerDescriptor> peer_desc = make_unique<PeerDescriptor>();
+  peer_desc->uid = peer_info[TincanControl::UID].asString();
+  peer_desc->vip4 = peer_info[TincanControl::VIP4].asString();
+  peer_desc->cas = peer_info[TincanControl::CAS].asString();
+  peer_desc->fingerprint = peer_info[TincanControl::FPR].asString();
+  peer_desc->mac_address = peer_info[TincanControl::MAC].asString();
+  return peer_desc;
 }
 
 void
@@ -161,8 +329,18 @@ Tincan::InjectFrame(
   const Json::Value & frame_desc)
 {
   const string & tnl_id = frame_desc[TincanControl::TunnelId].asString();
-  BasicTunnel & ol = TunnelFromId(tnl_id);
-  ol.InjectFame(frame_desc[TincanControl::Data].asString());
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->InjectFame(frame_desc[TincanControl::Data].asString());
+}
+
+void
+Tincan::InjectFrames(
+  const string & tnl_id,
+  const vector<pair<const uint8_t *, uint32_t>> & frames)
+{
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  for(auto & frame : frames)
+    ol->InjectFrame(frame.first, frame.second);
 }
 
 void
@@ -172,8 +350,18 @@ Tincan::QueryLinkCas(
 {
   const string tnl_id = link_desc[TincanControl::TunnelId].asString();
   const string vlid = link_desc[TincanControl::LinkId].asString();
-  BasicTunnel & ol = TunnelFromId(tnl_id);
-  ol.QueryLinkCas(vlid, cas_info);
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->QueryLinkCas(vlid, cas_info);
+}
+
+void
+Tincan::QueryLatencyStats(
+  const Json::Value & tnl_desc,
+  Json::Value & stats)
+{
+  shared_ptr<BasicTunnel> ol =
+    TunnelFromId(tnl_desc[TincanControl::TunnelId].asString());
+  ol->QueryLatencyStats(tnl_desc.get("Reset", false).asBool(), stats);
 }
 
 void
@@ -183,14 +371,9 @@ Tincan::QueryLinkStats(
 {
   for(uint32_t i = 0; i < tunnel_ids["TunnelIds"].size(); i++)
   {
-    vector<string>link_ids;
     string tnl_id = tunnel_ids["TunnelIds"][i].asString();
-    BasicTunnel & ol = TunnelFromId(tnl_id);
-    ol.QueryLinkIds(link_ids);
-    for(auto vlid : link_ids)
-    {
-      ol.QueryLinkInfo(vlid, stat_info[tnl_id][vlid]);
-    }
+    shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+    ol->QueryLinksInfo(stat_info[tnl_id]);
   }
 
 }
@@ -200,8 +383,9 @@ Tincan::QueryTunnelInfo(
   const Json::Value & tnl_desc,
   Json::Value & tnl_info)
 {
-  BasicTunnel & ol = TunnelFromId(tnl_desc[TincanControl::TunnelId].asString());
-  ol.QueryInfo(tnl_info);
+  shared_ptr<BasicTunnel> ol =
+    TunnelFromId(tnl_desc[TincanControl::TunnelId].asString());
+  ol->QueryInfo(tnl_info);
 }
 
 void 
@@ -212,18 +396,32 @@ Tincan::RemoveTunnel(
   if(tnl_id.empty())
     throw TCEXCEPT("No Tunnel ID was specified");
   
-  lock_guard<mutex> lg(tunnels_mutex_);
-  for(auto tnl = tunnels_.begin(); tnl != tunnels_.end(); tnl++)
+  shared_ptr<BasicTunnel> removed;
   {
-    if((*tnl)->Descriptor().uid.compare(tnl_id) == 0)
+    lock_guard<mutex> lg(tunnels_mutex_);
+    for(auto tnl = tunnels_.begin(); tnl != tunnels_.end(); tnl++)
     {
-      (*tnl)->Shutdown();
-      tunnels_.erase(tnl);
-      LOG(LS_INFO) << "RemoveTunnel: Instance erased from collection " << tnl_id;
-      return;
+      if((*tnl)->Descriptor().uid.compare(tnl_id) == 0)
+      {
+        removed = move(*tnl);
+        tunnels_.erase(tnl);
+        break;
+      }
     }
   }
-  LOG(LS_WARNING) << "RemoveTunnel: No such virtual network exists " << tnl_id;
+  if(!removed)
+  {
+    LOG(LS_WARNING) << "RemoveTunnel: No such virtual network exists "
+      << tnl_id;
+    return;
+  }
+  //controls and ICCs already under way hold their own references, the tunnel
+  //is destroyed when the last of them is done with it
+  removed->Shutdown();
+  FailBatchedLinks([&tnl_id](const string &, const BatchedLink & bl)
+    { return bl.tnl_id == tnl_id; },
+    "The tunnel was removed before the vlink gathered its candidates");
+  LOG(LS_INFO) << "RemoveTunnel: Instance erased from collection " << tnl_id;
 }
 
 void
@@ -235,6 +433,9 @@ Tincan::RemoveVlink(
   if(tnl_id.empty() || vlid.empty())
     throw TCEXCEPT("Required identifier not specified");
 
+  FailBatchedLinks([&tnl_id, &vlid](const string & link_id,
+    const BatchedLink & bl) { return link_id == vlid && bl.tnl_id == tnl_id; },
+    "The vlink was removed before it gathered its candidates");
   lock_guard<mutex> lg(tunnels_mutex_);
   for(auto & tnl : tunnels_)
   {
@@ -245,6 +446,48 @@ Tincan::RemoveVlink(
   }
 }
 
+/*
+Removes each of the vlinks in the LinkIds array, reporting the outcome of each
+one in a single response.
+*/
+void
+Tincan::RemoveVlinks(
+  const Json::Value & links_desc,
+  Json::Value & links_info)
+{
+  const string tnl_id = links_desc[TincanControl::TunnelId].asString();
+  const Json::Value & link_ids = links_desc["LinkIds"];
+  if(tnl_id.empty() || !link_ids.isArray())
+    throw TCEXCEPT("Required identifier not specified");
+  shared_ptr<BasicTunnel> tnl = TunnelFromId(tnl_id);
+  Json::Value & results = links_info["Links"];
+  results = Json::Value(Json::arrayValue);
+  vector<string> vlids(link_ids.size());
+  for(Json::ArrayIndex i = 0; i < link_ids.size(); i++)
+  {
+    Json::Value & result = results[i];
+    const string & vlid = vlids[i] = link_ids[i].asString();
+    result[TincanControl::LinkId] = vlid;
+    try
+    {
+      tnl->RemoveLink(vlid);
+      result["Success"] = true;
+    }
+    catch(exception & e)
+    {
+      result["Success"] = false;
+      result["Message"] = e.what();
+    }
+  }
+  FailBatchedLinks([&tnl_id, &vlids](const string & link_id,
+    const BatchedLink & bl)
+    {
+      return bl.tnl_id == tnl_id &&
+        std::find(vlids.begin(), vlids.end(), link_id) != vlids.end();
+    },
+    "The vlink was removed before it gathered its candidates");
+}
+
 void
 Tincan::SendIcc(
   const Json::Value & icc_desc)
@@ -254,13 +497,40 @@ Tincan::SendIcc(
   if(icc_desc[TincanControl::Data].isString())
   {
     const string & data = icc_desc[TincanControl::Data].asString();
-    BasicTunnel & ol = TunnelFromId(tnl_id);
-    ol.SendIcc(link_id, data);
+    SendIcc(tnl_id, link_id, data);
   }
   else
     throw TCEXCEPT("Icc data is not represented as a string");
 }
 
+void
+Tincan::SendIcc(
+  const string & tnl_id,
+  const string & link_id,
+  const string & data)
+{
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->SendIcc(link_id, data);
+}
+
+void
+Tincan::SubscribeLinkStats(
+  const Json::Value & sub_desc)
+{
+  const string tnl_id = sub_desc[TincanControl::TunnelId].asString();
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->SubscribeLinkStats(sub_desc);
+}
+
+void
+Tincan::ConfigureLatencyStats(
+  const Json::Value & cfg_desc)
+{
+  shared_ptr<BasicTunnel> ol =
+    TunnelFromId(cfg_desc[TincanControl::TunnelId].asString());
+  ol->ConfigureLatencyStats(cfg_desc);
+}
+
 void
 Tincan::OnLocalCasUpdated(
   string link_id,
@@ -292,16 +562,38 @@ Tincan::OnLocalCasUpdated(
   }
   if(to_deliver)
   {
-    ctrl_link_->Deliver(move(ctrl));
+    ctrl_link_.load()->Deliver(move(ctrl));
+  }
+  else
+  {
+    CompleteBatchedLink(link_id, true, lcas);
   }
 }
 
 void Tincan::UpdateRouteTable(
-  const Json::Value & rts_desc)
+  const Json::Value & rts_desc,
+  Json::Value & rts_info)
+{
+  string tnl_id = rts_desc[TincanControl::TunnelId].asString();
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->UpdateRouteTable(rts_desc, rts_info);
+}
+
+void Tincan::UpdateIp4RouteTable(
+  const Json::Value & rts_desc,
+  Json::Value & rts_info)
 {
   string tnl_id = rts_desc[TincanControl::TunnelId].asString();
-  BasicTunnel & ol = TunnelFromId(tnl_id);
-  ol.UpdateRouteTable(rts_desc["Table"]);
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->UpdateIp4RouteTable(rts_desc, rts_info);
+}
+
+void Tincan::UpdateBroadcastTree(
+  const Json::Value & bct_desc)
+{
+  string tnl_id = bct_desc[TincanControl::TunnelId].asString();
+  shared_ptr<BasicTunnel> ol = TunnelFromId(tnl_id);
+  ol->UpdateBroadcastTree(bct_desc);
 }
 
 void
@@ -313,14 +605,42 @@ Tincan::Run()
   SetConsoleCtrlHandler(ControlHandler, TRUE);
 #endif // _IPOP_WIN
 
+#if !defined(_IPOP_WIN)
+  if(!tp.kStatsRegionPath.empty())
+    stats_region_ = make_unique<StatsRegion>(tp.kStatsRegionPath);
+  if(!tp.kIccSocketPath.empty())
+  {
+    icc_channel_ = make_shared<IccChannel>(*this, tp.kIccSocketPath);
+    icc_thread_.Start(icc_channel_.get());
+  }
+#endif // !_IPOP_WIN
   //Start tincan control to get config from Controller
   unique_ptr<ControlDispatch> ctrl_dispatch(new ControlDispatch);
   ctrl_dispatch->SetDispatchToTincanInf(this);
-  ctrl_listener_ = make_shared<ControlListener>(move(ctrl_dispatch));
+#if !defined(_IPOP_WIN)
+  if(!tp.kCtrlSocketPath.empty())
+    ctrl_listener_ = make_shared<UnixControlListener>(move(ctrl_dispatch),
+      tp.kCtrlSocketPath);
+  else
+#endif // !_IPOP_WIN
+    ctrl_listener_ = make_shared<ControlListener>(move(ctrl_dispatch));
   ctl_thread_.Start(ctrl_listener_.get());
   exit_event_.Wait(Event::kForever);
 }
 
+void
+Tincan::OnMessage(
+  Message * msg)
+{
+  if(msg->message_id != MSGID_BATCH_TIMEOUT)
+    return;
+  shared_ptr<LinkBatch> batch = ((BatchMsgData*)msg->pdata)->batch;
+  delete msg->pdata;
+  FailBatchedLinks([&batch](const string &, const BatchedLink & bl)
+    { return bl.batch == batch; },
+    "Timed out gathering the vlink's candidates");
+}
+
 bool
 Tincan::IsTunnelExisit(
   const string & tnl_id)
@@ -333,7 +653,7 @@ Tincan::IsTunnelExisit(
   return false;
 }
 
-BasicTunnel &
+shared_ptr<BasicTunnel>
 Tincan::TunnelFromId(
   const string & tnl_id)
 {
@@ -342,7 +662,7 @@ Tincan::TunnelFromId(
   {
     //list of tunnels will be small enough where a linear search is satifactory
     if(tnl->Descriptor().uid.compare(tnl_id) == 0)
-      return *tnl.get();
+      return tnl;
   }
   string msg("No virtual network exists by this name: ");
   msg.append(tnl_id);
@@ -359,6 +679,9 @@ Tincan::Shutdown()
 {
   lock_guard<mutex> lg(tunnels_mutex_);
   ctl_thread_.Quit();
+#if !defined(_IPOP_WIN)
+  icc_thread_.Quit();
+#endif // !_IPOP_WIN
   for(auto const & tnl : tunnels_) {
     tnl->Shutdown();
   }
@@ -22,6 +22,7 @@
 */
 #include "tincan_control.h"
 #include "webrtc/base/logging.h"
+#include "control_codec.h"
 #include "tincan_exception.h"
 namespace tincan
 {
@@ -108,6 +109,24 @@ TincanControl::TincanControl(
   dict_req_(new Json::Value(Json::objectValue)),
   dict_resp_(new Json::Value(Json::objectValue))
 {
+  if(ControlCodec::IsBinary(req_data, len))
+  {
+    ControlHeader hdr;
+    ControlCodec::Decode(req_data, len, hdr, *dict_req_, *dict_resp_);
+    if(hdr.version != tp.kTincanControlBinaryVer)
+    {
+      ostringstream oss;
+      oss << "Invalid IPOP protocol version in binary control header (" <<
+        (uint32_t)hdr.version << ")";
+      throw TCEXCEPT(oss.str().c_str());
+    }
+    if(hdr.type != CTTincanRequest && hdr.type != CTTincanResponse)
+      throw TCEXCEPT("Invalid control type");
+    proto_ver_ = hdr.version;
+    type_ = (ControlTypeEnum)hdr.type;
+    tag_ = hdr.tag;
+    return;
+  }
   //create Json from full request
   Json::Reader parser;
   Json::Value ctrl(Json::objectValue);
@@ -124,8 +143,9 @@ TincanControl::TincanControl(
       << req_data;
     throw TCEXCEPT(oss.str().c_str());
   }
+  //a JSON control carrying the binary version asks for binary replies
   uint32_t ver = ctrl[IPOP][ProtocolVersion].asUInt();
-  if(ver != tp.kTincanControlVer)
+  if(ver != tp.kTincanControlVer && ver != tp.kTincanControlBinaryVer)
   {
     ostringstream oss;
     oss << "Invalid IPOP protocol version in control header (" << ver << ")";
@@ -234,6 +254,31 @@ TincanControl::StyledString()
   return ctrl.toStyledString();
 }
 
+void
+TincanControl::Serialize(
+  string & msg) const
+{
+  if(proto_ver_ == tp.kTincanControlBinaryVer)
+  {
+    ControlHeader hdr;
+    hdr.version = (uint8_t)proto_ver_;
+    hdr.type = (uint8_t)type_;
+    hdr.tag = tag_;
+    ControlCodec::Encode(hdr, dict_req_, dict_resp_, msg);
+    return;
+  }
+  Json::Value ctrl(Json::objectValue);
+  ctrl[IPOP][ProtocolVersion] = proto_ver_;
+  ctrl[IPOP][TransactionId] = (Json::UInt64)tag_;
+  ctrl[IPOP][ControlType] = ControlTypeStrings[type_];
+  if(dict_req_)
+    ctrl[IPOP][Request] = *dict_req_;
+  if(dict_resp_)
+    ctrl[IPOP][Response] = *dict_resp_;
+  Json::FastWriter writer;
+  msg = writer.write(ctrl);
+}
+
 void TincanControl::SetRequest(unique_ptr<Json::Value> req)
 {
   delete dict_req_;
@@ -318,4 +363,15 @@ void TincanControl::SetControlType(ControlTypeEnum type)
   type_ = type;
 }
 
+uint32_t
+TincanControl::GetProtocolVersion() const
+{
+  return proto_ver_;
+}
+
+void TincanControl::SetProtocolVersion(uint32_t ver)
+{
+  proto_ver_ = ver;
+}
+
 } // namespace tincan
@@ -43,7 +43,13 @@ int main(int argc, char **argv)
     else if(tp.kNeedsHelp) {
       std::cout << "-v         Version check.\n" <<
         "-i=COUNT   Specify concurrent I/Os" << endl <<
-        "-p=PORT    Specify control port number" << endl;
+        "-p=PORT    Specify control port number" << endl
+#if !defined(_IPOP_WIN)
+        << "-s=PATH    Specify control unix socket path" << endl
+        << "-c=PATH    Specify ICC unix socket path" << endl
+        << "-m=PATH    Specify shared memory stats file path" << endl
+#endif // !_IPOP_WIN
+        ;
     }
     else {
       Tincan tc;
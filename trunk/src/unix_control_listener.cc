@@ -0,0 +1,134 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#if !defined(_IPOP_WIN)
+#include "unix_control_listener.h"
+#include "control_codec.h"
+#include "tincan_exception.h"
+namespace tincan
+{
+UnixControlListener::UnixControlListener(
+  unique_ptr<ControlDispatch> control_dispatch,
+  const string & socket_path) :
+  UnixStreamServer(socket_path),
+  ctrl_dispatch_(move(control_dispatch)),
+  proto_ver_(tp.kTincanControlVer)
+{
+  ctrl_dispatch_->SetDispatchToListenerInf(this);
+}
+
+UnixControlListener::~UnixControlListener()
+{}
+
+void
+UnixControlListener::OnReceived(
+  string & rcv_buf)
+{
+  size_t pos = 0;
+  while(rcv_buf.size() - pos >= 4)
+  {
+    const uint8_t * hdr = (const uint8_t*)rcv_buf.data() + pos;
+    uint32_t len = (uint32_t)hdr[0] << 24 | (uint32_t)hdr[1] << 16 |
+      (uint32_t)hdr[2] << 8 | hdr[3];
+    if(len > kMaxControlSize)
+    {
+      LOG(LS_WARNING) << "A control of " << len << " bytes exceeds the limit, "
+        "closing the controller connection";
+      CloseConnection();
+      return;
+    }
+    if(rcv_buf.size() - pos - 4 < len)
+      break;
+    HandleControl(rcv_buf.data() + pos + 4, len);
+    pos += 4 + len;
+  }
+  rcv_buf.erase(0, pos);
+}
+
+void
+UnixControlListener::HandleControl(
+  const char * data,
+  size_t len)
+{
+  try {
+    TincanControl ctrl(data, len);
+    LOG(LS_INFO) << "Received CONTROL: " << ctrl.StyledString();
+    proto_ver_ = ctrl.GetProtocolVersion();
+    (*ctrl_dispatch_)(ctrl);
+  }
+  catch(exception & e) {
+    LOG(LS_WARNING) << "A control failed to execute." << endl
+      << (ControlCodec::IsBinary(data, len) ?
+        ByteArrayToString(data, data + len) : string(data, len)) << endl
+      << e.what();
+  }
+}
+//
+//IpopControllerLink interface implementation
+void
+UnixControlListener::Deliver(
+  TincanControl & ctrl_resp)
+{
+  if(ctrl_resp.GetControlType() == TincanControl::CTTincanRequest)
+    ctrl_resp.SetProtocolVersion(proto_ver_);
+  LOG(LS_INFO) << "Sending CONTROL: " << ctrl_resp.StyledString();
+  string msg;
+  ctrl_resp.Serialize(msg);
+  uint32_t len = (uint32_t)msg.length();
+  char hdr[4] = { (char)(len >> 24), (char)(len >> 16), (char)(len >> 8),
+    (char)len };
+  msg.insert(0, hdr, sizeof(hdr));
+  lock_guard<mutex> lg(conn_mutex_);
+  if(conn_fd_ == -1)
+  {
+    LOG(LS_WARNING) << "No controller is connected, the control was dropped";
+    return;
+  }
+  Send(msg.data(), msg.length());
+}
+
+void
+UnixControlListener::Deliver(
+  unique_ptr<TincanControl> ctrl_resp)
+{
+  Deliver(*ctrl_resp.get());
+}
+//
+//DispatchtoListener interface implementation
+void
+UnixControlListener::CreateIpopControllerLink(
+  unique_ptr<SocketAddress> controller_addr)
+{
+  LOG(LS_INFO) << "Controls are returned on the unix socket connection, the "
+    "address " << controller_addr->ToString() << " is not used";
+}
+
+void
+UnixControlListener::Run(
+  Thread* thread)
+{
+  Listen(thread);
+  LOG(LS_INFO) << "Tincan listening on unix socket " << socket_path_;
+  thread->ProcessMessages(-1); //run until stopped
+}
+}  // namespace tincan
+#endif  // !_IPOP_WIN
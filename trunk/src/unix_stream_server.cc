@@ -0,0 +1,212 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+#if !defined(_IPOP_WIN)
+#include "unix_stream_server.h"
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "tincan_exception.h"
+namespace tincan
+{
+#if defined(MSG_NOSIGNAL)
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+UnixStreamServer::UnixStreamServer(
+  const string & socket_path) :
+  socket_path_(socket_path),
+  conn_fd_(-1),
+  socket_server_(nullptr),
+  listen_fd_(-1)
+{}
+
+UnixStreamServer::~UnixStreamServer()
+{
+  if(socket_server_)
+  {
+    if(listen_disp_)
+      socket_server_->Remove(listen_disp_.get());
+    if(conn_disp_)
+      socket_server_->Remove(conn_disp_.get());
+  }
+  if(conn_fd_ != -1)
+    close(conn_fd_);
+  if(listen_fd_ != -1)
+  {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+  }
+}
+
+void
+UnixStreamServer::SocketDispatcher::OnEvent(
+  uint32_t,
+  int)
+{
+  if(fd_ == server_.listen_fd_)
+    server_.OnAcceptable();
+  else
+    server_.OnReadable();
+}
+
+void
+UnixStreamServer::OnAcceptable()
+{
+  int fd = accept(listen_fd_, nullptr, nullptr);
+  if(fd == -1)
+  {
+    LOG(LS_WARNING) << "Accepting a connection on " << socket_path_
+      << " failed, errno=" << errno;
+    return;
+  }
+  //writes block, bounded by the send timeout, reads are done without waiting
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  timeval tv = { kSendTimeout, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#if defined(SO_NOSIGPIPE)
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+  if(conn_fd_ != -1)
+  {
+    LOG(LS_INFO) << "A new controller connection on " << socket_path_
+      << " replaces the current one";
+    CloseConnection();
+  }
+  closed_disp_.reset();
+  conn_disp_ = make_unique<SocketDispatcher>(*this, fd);
+  {
+    lock_guard<mutex> lg(conn_mutex_);
+    conn_fd_ = fd;
+  }
+  rcv_buf_.clear();
+  socket_server_->Add(conn_disp_.get());
+  LOG(LS_INFO) << "Controller connected on " << socket_path_;
+}
+
+/*
+Drains the connection without blocking and passes what has been received to
+the derived class.
+*/
+void
+UnixStreamServer::OnReadable()
+{
+  char buf[65536];
+  for(;;)
+  {
+    ssize_t cnt = recv(conn_fd_, buf, sizeof(buf), MSG_DONTWAIT);
+    if(cnt > 0)
+    {
+      rcv_buf_.append(buf, (size_t)cnt);
+      continue;
+    }
+    if(cnt == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if(cnt == -1 && errno == EINTR)
+      continue;
+    LOG(LS_INFO) << "Controller disconnected from " << socket_path_;
+    CloseConnection();
+    return;
+  }
+  OnReceived(rcv_buf_);
+}
+
+void
+UnixStreamServer::CloseConnection()
+{
+  socket_server_->Remove(conn_disp_.get());
+  //the dispatcher may be the caller, it is released on the next accept
+  closed_disp_ = move(conn_disp_);
+  lock_guard<mutex> lg(conn_mutex_);
+  close(conn_fd_);
+  conn_fd_ = -1;
+  rcv_buf_.clear();
+  OnClosed();
+}
+
+bool
+UnixStreamServer::Send(
+  const char * data,
+  size_t len)
+{
+  size_t sent = 0;
+  while(conn_fd_ != -1 && sent < len)
+  {
+    ssize_t cnt = send(conn_fd_, data + sent, len - sent, kSendFlags);
+    if(cnt == -1)
+    {
+      if(errno == EINTR)
+        continue;
+      //nothing more is sent on the stream once it is out of frame, the read
+      //side sees the shutdown and closes the connection
+      LOG(LS_WARNING) << "Sending on " << socket_path_ << " failed, errno="
+        << errno << ", closing the controller connection";
+      shutdown(conn_fd_, SHUT_RDWR);
+      return false;
+    }
+    sent += (size_t)cnt;
+  }
+  return sent == len;
+}
+
+void
+UnixStreamServer::Listen(
+  Thread * thread)
+{
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(socket_path_.length() >= sizeof(addr.sun_path))
+  {
+    string emsg("The socket path is too long ");
+    emsg.append(socket_path_);
+    throw TCEXCEPT(emsg.c_str());
+  }
+  strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(listen_fd_ == -1)
+    throw TCEXCEPT("Failed to create the listener socket");
+  fcntl(listen_fd_, F_SETFD, FD_CLOEXEC);
+  fcntl(listen_fd_, F_SETFL, fcntl(listen_fd_, F_GETFL) | O_NONBLOCK);
+  unlink(socket_path_.c_str());
+  if(::bind(listen_fd_, (sockaddr*)&addr, sizeof(addr)) == -1 ||
+    chmod(socket_path_.c_str(), S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) == -1 ||
+    listen(listen_fd_, 1) == -1)
+  {
+    string emsg("Failed to bind the socket ");
+    emsg.append(socket_path_);
+    throw TCEXCEPT(emsg.c_str());
+  }
+  //the server thread is created with the default, physical, socket server
+  socket_server_ = static_cast<PhysicalSocketServer*>(thread->socketserver());
+  listen_disp_ = make_unique<SocketDispatcher>(*this, listen_fd_);
+  socket_server_->Add(listen_disp_.get());
+}
+}  // namespace tincan
+#endif  // !_IPOP_WIN
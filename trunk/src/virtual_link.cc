@@ -27,6 +27,16 @@
 namespace tincan
 {
 using namespace rtc;
+//The counters have a single writer, so no locked read-modify-write is needed
+static inline void
+Increment(
+  std::atomic<uint64_t> & counter,
+  uint64_t count)
+{
+  counter.store(counter.load(std::memory_order_relaxed) + count,
+    std::memory_order_relaxed);
+}
+
 VirtualLink::VirtualLink(
   unique_ptr<VlinkDescriptor> vlink_desc,
   unique_ptr<PeerDescriptor> peer_desc,
@@ -40,6 +50,7 @@ VirtualLink::VirtualLink(
   packet_options_(DSCP_DEFAULT),
   packet_factory_(network_thread),
   gather_state_(cricket::kIceGatheringNew),
+  latencies_(make_shared<StageLatencies>()),
   is_valid_(false),
   signaling_thread_(signaling_thread),
   network_thread_(network_thread)
@@ -75,6 +86,8 @@ VirtualLink::Initialize(
   &network_manager, &packet_factory_, stun_addrs));
 
   port_allocator_->set_flags(cricket::PORTALLOCATOR_DISABLE_TCP);
+  if(vlink_desc_->allow_loopback)
+    port_allocator_->SetNetworkIgnoreMask(0);
   SetupTURN(vlink_desc_->turn_descs);
   transport_ctlr_ = make_unique<TransportController>(signaling_thread_,
     network_thread_, port_allocator_.get());
@@ -134,6 +147,8 @@ VirtualLink::OnReadPacket(
   const rtc::PacketTime &,
   int)
 {
+  Increment(counters_.frames_in, 1);
+  Increment(counters_.bytes_in, len);
   SignalMessageReceived((uint8_t*)data, *(uint32_t*)&len, *this);
 }
 
@@ -198,7 +213,15 @@ void VirtualLink::Transmit(TapFrame & frame)
   int status = channel_->SendPacket((const char*)frame.BufferToTransfer(),
     frame.BytesToTransfer(), packet_options_, 0);
   if(status < 0)
+  {
+    Increment(counters_.send_failures, 1);
     LOG(LS_INFO) << "Vlink send failed";
+  }
+  else
+  {
+    Increment(counters_.frames_out, 1);
+    Increment(counters_.bytes_out, frame.BytesToTransfer());
+  }
 }
 
 string VirtualLink::Candidates()
@@ -268,6 +291,26 @@ VirtualLink::GetStats(Json::Value & stats)
   }
 }
 
+void
+VirtualLink::GetStats(LinkStatsSample & sample)
+{
+  cricket::ConnectionInfos infos;
+  channel_->GetStats(&infos);
+  sample.online = IsReady();
+  for(auto & info : infos)
+  {
+    sample.sent_bytes += info.sent_total_bytes;
+    sample.recv_bytes += info.recv_total_bytes;
+    sample.connections.push_back(ConnectionBytes{ info.key,
+      info.sent_total_bytes, info.recv_total_bytes });
+    if(info.best_connection)
+    {
+      sample.writable = info.writable;
+      sample.rtt = info.rtt;
+    }
+  }
+}
+
 void
 VirtualLink::SetupICE(
   SSLFingerprint const & local_fingerprint)
@@ -376,6 +419,6 @@ void VirtualLink::Disconnect()
 
 bool VirtualLink::IsReady()
 {
-  return channel_->writable();
+  return channel_ && channel_->writable();
 }
 } // end namespace tincan
@@ -0,0 +1,511 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+/*
+Measures the data path of two tunnels connected back to back in one process.
+Each tunnel has a memory TAP device and the two are linked by a vlink that
+runs ICE and DTLS over UDP on the loopback interface. Synthetic frames are
+injected into the first tunnel's TAP, are read and transmitted by it, received
+and written to the second tunnel's TAP where their arrival is timed. A window
+bounds the frames in flight so the latency reflects the data path rather than
+an ever growing queue. Needs neither privileges nor a TUN device.
+
+  tincan-loopback [-d=SEC] [-w=SEC] [-s=BYTES] [-f=FRAMES] [-j]
+
+  -d  measured duration, 10 seconds by default
+  -w  warm up before the measurement, 1 second by default
+  -s  ethernet frame size, 1400 bytes by default
+  -f  frames in flight, 256 by default
+  -j  print the results as JSON
+*/
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include "memory_tapdev.h"
+#include "single_link_tunnel.h"
+#include "tincan_control.h"
+
+namespace tincan
+{
+TincanParameters tp;
+}
+using namespace tincan;
+
+//the sequence number and send time follow the ethernet, IPv4 and UDP headers
+static const uint32_t kStampOffset = 14 + 20 + 8;
+static const uint32_t kMinFrameSize = kStampOffset + 16;
+//frames in flight are presumed lost when nothing arrives for this long
+static const std::chrono::milliseconds kLossTimeout(100);
+static const size_t kMaxSamples = 1 << 22;
+static const int kConnectTimeout = 30000; //ms
+
+static uint64_t
+NowNanos()
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+Stands in for the controller, the harness only needs to know when the vlink of
+each tunnel is up.
+*/
+class LoopbackControllerLink :
+  public IpopControllerLink
+{
+public:
+  LoopbackControllerLink() :
+    links_up_(0),
+    all_up_(true, false)
+  {}
+  void Deliver(
+    TincanControl &) override
+  {}
+  void Deliver(
+    unique_ptr<TincanControl> ctrl) override
+  {
+    Json::Value & req = ctrl->GetRequest();
+    if(req[TincanControl::Command].asString() == "LinkStateChange" &&
+      req[TincanControl::Data].asString() == "LINK_STATE_UP" &&
+      ++links_up_ == 2)
+      all_up_.Set();
+  }
+  bool WaitForLinks(
+    int ms)
+  {
+    return all_up_.Wait(ms);
+  }
+private:
+  std::atomic<uint32_t> links_up_;
+  rtc::Event all_up_;
+};
+
+//Waits for a vlink to finish gathering its local candidates
+class CasWaiter :
+  public sigslot::has_slots<>
+{
+public:
+  CasWaiter() :
+    ready_(true, false)
+  {}
+  string Wait(
+    VirtualLink & vlink,
+    int ms)
+  {
+    vlink.SignalLocalCasReady.connect(this, &CasWaiter::OnLocalCasReady);
+    //gathering may have completed before the handler was connected
+    if(!vlink.IsGatheringComplete() && !ready_.Wait(ms))
+      throw TCEXCEPT("Timed out gathering the local candidates");
+    return vlink.Candidates();
+  }
+private:
+  void OnLocalCasReady(
+    string link_id,
+    string cas)
+  {
+    ready_.Set();
+  }
+  rtc::Event ready_;
+};
+
+struct LoopbackResults
+{
+  uint64_t sent;
+  uint64_t received;
+  uint64_t lost;
+  uint64_t dropped;
+  double seconds;
+  double pps;
+  double gbps;
+  vector<uint64_t> latencies; //ns, sorted
+};
+
+class LoopbackHarness :
+  public sigslot::has_slots<>
+{
+public:
+  LoopbackHarness(
+    uint32_t frame_size,
+    uint32_t window) :
+    frame_size_(frame_size),
+    window_(window),
+    tap_a_(nullptr),
+    tap_b_(nullptr),
+    received_(0),
+    measure_first_(UINT64_MAX),
+    measure_last_(UINT64_MAX),
+    measured_(0)
+  {}
+  ~LoopbackHarness()
+  {
+    if(tnl_a_)
+      tnl_a_->Shutdown();
+    if(tnl_b_)
+      tnl_b_->Shutdown();
+  }
+  void Connect();
+  LoopbackResults Run(
+    std::chrono::seconds warmup,
+    std::chrono::seconds duration);
+private:
+  unique_ptr<SingleLinkTunnel> CreateTunnel(
+    const string & name,
+    const string & node_id,
+    const string & ip4,
+    MemoryTapDev *& tap);
+  void BuildFrame(
+    vector<uint8_t> & frame);
+  void OnFrameWritten(
+    const uint8_t * frame,
+    uint32_t len);
+
+  uint32_t frame_size_;
+  uint32_t window_;
+  LoopbackControllerLink ctrl_link_;
+  MemoryTapDev * tap_a_;
+  MemoryTapDev * tap_b_;
+  unique_ptr<SingleLinkTunnel> tnl_a_;
+  unique_ptr<SingleLinkTunnel> tnl_b_;
+  std::atomic<uint64_t> received_;
+  //the range of sequence numbers sent during the measurement
+  std::atomic<uint64_t> measure_first_;
+  std::atomic<uint64_t> measure_last_;
+  //only used on the receiving tap's writer thread until it is stopped
+  uint64_t measured_;
+  vector<uint64_t> latencies_;
+};
+
+//The names of all interfaces except the loopback ones
+static vector<string>
+NonLoopbackInterfaces()
+{
+  vector<string> names;
+  ifaddrs * ifas = nullptr;
+  if(getifaddrs(&ifas) != 0)
+    return names;
+  for(ifaddrs * ifa = ifas; ifa; ifa = ifa->ifa_next)
+  {
+    if(!(ifa->ifa_flags & IFF_LOOPBACK) &&
+      std::find(names.begin(), names.end(), ifa->ifa_name) == names.end())
+      names.push_back(ifa->ifa_name);
+  }
+  freeifaddrs(ifas);
+  return names;
+}
+
+unique_ptr<SingleLinkTunnel>
+LoopbackHarness::CreateTunnel(
+  const string & name,
+  const string & node_id,
+  const string & ip4,
+  MemoryTapDev *& tap)
+{
+  unique_ptr<TunnelDescriptor> td = make_unique<TunnelDescriptor>();
+  td->uid = name;
+  td->node_id = node_id;
+  td->enable_ip_mapping = false;
+  td->disable_encryption = false;
+  unique_ptr<MemoryTapDev> tdev = make_unique<MemoryTapDev>();
+  tap = tdev.get();
+  unique_ptr<SingleLinkTunnel> tnl = make_unique<SingleLinkTunnel>(move(td),
+    &ctrl_link_, move(tdev));
+  unique_ptr<TapDescriptor> tap_desc = make_unique<TapDescriptor>();
+  tap_desc->name = name;
+  tap_desc->ip4 = ip4;
+  tap_desc->prefix4 = 24;
+  tap_desc->mtu4 = tp.kMaxMtuSize;
+  tnl->Configure(move(tap_desc), NonLoopbackInterfaces());
+  tnl->Start();
+  return tnl;
+}
+
+/*
+Creates the tunnels and the vlink between them, exchanging the candidates as
+the controller would. The second tunnel is given the first one's candidates
+when its vlink is created, the first receives the second's afterwards.
+*/
+void
+LoopbackHarness::Connect()
+{
+  static const string link_id = "0123456789abcdef0123456789abcdef";
+  static const string node_a = "a0000000000000000000000000000000";
+  static const string node_b = "b0000000000000000000000000000000";
+  tnl_a_ = CreateTunnel("loopback-a", node_a, "10.254.0.1", tap_a_);
+  tnl_b_ = CreateTunnel("loopback-b", node_b, "10.254.0.2", tap_b_);
+  tap_b_->SignalFrameWritten.connect(this, &LoopbackHarness::OnFrameWritten);
+  auto vlink_desc = []()
+  {
+    unique_ptr<VlinkDescriptor> vd = make_unique<VlinkDescriptor>();
+    vd->uid = link_id;
+    vd->dtls_enabled = true;
+    vd->allow_loopback = true;
+    return vd;
+  };
+  auto peer_desc = [](const string & uid, BasicTunnel & peer,
+    const string & cas)
+  {
+    unique_ptr<PeerDescriptor> pd = make_unique<PeerDescriptor>();
+    pd->uid = uid;
+    pd->mac_address = peer.MacAddress();
+    pd->fingerprint = peer.Fingerprint();
+    pd->cas = cas;
+    return pd;
+  };
+  CasWaiter waiter_a, waiter_b;
+  shared_ptr<VirtualLink> vl_a = tnl_a_->CreateVlink(vlink_desc(),
+    peer_desc(node_b, *tnl_b_, ""));
+  string cas_a = waiter_a.Wait(*vl_a, kConnectTimeout);
+  shared_ptr<VirtualLink> vl_b = tnl_b_->CreateVlink(vlink_desc(),
+    peer_desc(node_a, *tnl_a_, cas_a));
+  string cas_b = waiter_b.Wait(*vl_b, kConnectTimeout);
+  tnl_a_->CreateVlink(vlink_desc(), peer_desc(node_b, *tnl_b_, cas_b));
+  if(!ctrl_link_.WaitForLinks(kConnectTimeout))
+    throw TCEXCEPT("Timed out connecting the vlink");
+}
+
+//An IPv4 UDP packet from the first tunnel's TAP to the second's
+void
+LoopbackHarness::BuildFrame(
+  vector<uint8_t> & frame)
+{
+  frame.assign(frame_size_, 0);
+  MacAddressType dst = tap_b_->MacAddress(), src = tap_a_->MacAddress();
+  IP4AddressType dst_ip = tap_b_->Ip4(), src_ip = tap_a_->Ip4();
+  memcpy(&frame[0], dst.data(), 6);
+  memcpy(&frame[6], src.data(), 6);
+  frame[12] = 0x08;
+  uint8_t * ip = &frame[14];
+  uint16_t ip_len = (uint16_t)(frame_size_ - 14);
+  ip[0] = 0x45;
+  ip[2] = (uint8_t)(ip_len >> 8);
+  ip[3] = (uint8_t)ip_len;
+  ip[8] = 64;
+  ip[9] = 17;
+  memcpy(&ip[12], src_ip.data(), 4);
+  memcpy(&ip[16], dst_ip.data(), 4);
+  uint8_t * udp = ip + 20;
+  uint16_t udp_len = (uint16_t)(ip_len - 20);
+  udp[0] = 0x9C; udp[1] = 0x40; //40000
+  udp[2] = 0x9C; udp[3] = 0x41; //40001
+  udp[4] = (uint8_t)(udp_len >> 8);
+  udp[5] = (uint8_t)udp_len;
+}
+
+void
+LoopbackHarness::OnFrameWritten(
+  const uint8_t * frame,
+  uint32_t len)
+{
+  uint64_t now = NowNanos();
+  if(len < kMinFrameSize)
+    return;
+  uint64_t seq, sent_at;
+  memcpy(&seq, frame + kStampOffset, sizeof(seq));
+  memcpy(&sent_at, frame + kStampOffset + 8, sizeof(sent_at));
+  if(seq >= measure_first_.load(std::memory_order_acquire) &&
+    seq < measure_last_.load(std::memory_order_acquire))
+  {
+    measured_++;
+    if(latencies_.size() < kMaxSamples)
+      latencies_.push_back(now - sent_at);
+  }
+  received_.fetch_add(1, std::memory_order_release);
+}
+
+/*
+Injects frames for the warm up and then the measured duration, keeping at most
+the window in flight. Only the frames sent during the measurement are counted,
+those still in flight when it ends are given a moment to arrive.
+*/
+LoopbackResults
+LoopbackHarness::Run(
+  std::chrono::seconds warmup,
+  std::chrono::seconds duration)
+{
+  LoopbackResults res = {};
+  vector<uint8_t> frame;
+  BuildFrame(frame);
+  uint64_t sent = 0, lost = 0, last_rx = 0;
+  steady_clock::time_point start = steady_clock::now();
+  steady_clock::time_point measure_start = start + warmup;
+  steady_clock::time_point end = measure_start + duration;
+  steady_clock::time_point progress = start;
+  bool measuring = false;
+  for(steady_clock::time_point now = start; now < end;
+    now = steady_clock::now())
+  {
+    if(!measuring && now >= measure_start)
+    {
+      measure_first_.store(sent, std::memory_order_release);
+      measure_start = now;
+      measuring = true;
+    }
+    uint64_t rx = received_.load(std::memory_order_acquire);
+    if(rx != last_rx)
+    {
+      last_rx = rx;
+      progress = now;
+    }
+    //frames presumed lost may still arrive
+    lost = std::min(lost, sent - rx);
+    if(sent - rx - lost < window_)
+    {
+      uint64_t sent_at = NowNanos();
+      memcpy(&frame[kStampOffset], &sent, sizeof(sent));
+      memcpy(&frame[kStampOffset + 8], &sent_at, sizeof(sent_at));
+      if(tap_a_->Inject(frame.data(), (uint32_t)frame.size()))
+      {
+        sent++;
+        if(measuring)
+          res.sent++;
+      }
+      else
+        std::this_thread::yield();
+    }
+    else if(now - progress > kLossTimeout)
+    {
+      lost = sent - rx;
+      progress = now;
+    }
+    else
+      std::this_thread::yield();
+  }
+  steady_clock::time_point measure_end = steady_clock::now();
+  measure_last_.store(sent, std::memory_order_release);
+  std::this_thread::sleep_for(kLossTimeout * 5);
+  //stopping the receiving tap's threads makes its results visible here
+  tap_b_->Down();
+  res.seconds = std::chrono::duration<double>(
+    measure_end - measure_start).count();
+  res.received = measured_;
+  res.lost = res.sent > res.received ? res.sent - res.received : 0;
+  res.dropped = tap_a_->Dropped();
+  res.pps = res.received / res.seconds;
+  res.gbps = res.pps * frame_size_ * 8 / 1e9;
+  res.latencies = move(latencies_);
+  std::sort(res.latencies.begin(), res.latencies.end());
+  return res;
+}
+
+static double
+PercentileMicros(
+  const vector<uint64_t> & sorted,
+  double pct)
+{
+  if(sorted.empty())
+    return 0;
+  size_t idx = (size_t)(pct / 100 * (sorted.size() - 1) + 0.5);
+  return sorted[idx] / 1000.0;
+}
+
+static void
+PrintResults(
+  const LoopbackResults & r,
+  uint32_t frame_size,
+  uint32_t window,
+  bool json)
+{
+  static const double pcts[] = { 50, 90, 99, 99.9 };
+  static const char * const pct_names[] = { "p50", "p90", "p99", "p99.9" };
+  double min_us = r.latencies.empty() ? 0 : r.latencies.front() / 1000.0;
+  double max_us = r.latencies.empty() ? 0 : r.latencies.back() / 1000.0;
+  if(json)
+  {
+    printf("{\n  \"frame_size\": %u,\n  \"window\": %u,\n  \"seconds\": %.3f,\n"
+      "  \"sent\": %" PRIu64 ",\n  \"received\": %" PRIu64 ",\n"
+      "  \"lost\": %" PRIu64 ",\n  \"dropped\": %" PRIu64 ",\n"
+      "  \"pps\": %.1f,\n  \"gbps\": %.4f,\n  \"latency_us\": {\n"
+      "    \"samples\": %zu,\n    \"min\": %.2f,\n", frame_size, window,
+      r.seconds, r.sent, r.received, r.lost, r.dropped, r.pps, r.gbps,
+      r.latencies.size(), min_us);
+    for(size_t i = 0; i < 4; i++)
+      printf("    \"%s\": %.2f,\n", pct_names[i],
+        PercentileMicros(r.latencies, pcts[i]));
+    printf("    \"max\": %.2f\n  }\n}\n", max_us);
+    return;
+  }
+  printf("frame size %u bytes, window %u frames, %.3f s\n", frame_size, window,
+    r.seconds);
+  printf("sent %" PRIu64 ", received %" PRIu64 ", lost %" PRIu64
+    ", dropped at the tap %" PRIu64 "\n", r.sent, r.received, r.lost,
+    r.dropped);
+  printf("throughput %.0f pps, %.3f Gbps\n", r.pps, r.gbps);
+  printf("latency us: min %.1f", min_us);
+  for(size_t i = 0; i < 4; i++)
+    printf(" %s %.1f", pct_names[i], PercentileMicros(r.latencies, pcts[i]));
+  printf(" max %.1f (%zu samples)\n", max_us, r.latencies.size());
+}
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  uint32_t duration = 10, warmup = 1, frame_size = 1400, window = 256;
+  bool json = false, usage = false;
+  for(int i = 1; i < argc; i++)
+  {
+    if(strncmp(argv[i], "-d=", 3) == 0)
+      duration = (uint32_t)strtoul(argv[i] + 3, nullptr, 10);
+    else if(strncmp(argv[i], "-w=", 3) == 0)
+      warmup = (uint32_t)strtoul(argv[i] + 3, nullptr, 10);
+    else if(strncmp(argv[i], "-s=", 3) == 0)
+      frame_size = (uint32_t)strtoul(argv[i] + 3, nullptr, 10);
+    else if(strncmp(argv[i], "-f=", 3) == 0)
+      window = (uint32_t)strtoul(argv[i] + 3, nullptr, 10);
+    else if(strcmp(argv[i], "-j") == 0)
+      json = true;
+    else
+      usage = true;
+  }
+  if(usage || duration == 0 || window == 0 ||
+    window > MemoryTapDev::kMaxQueued || frame_size < kMinFrameSize ||
+    frame_size > tp.kEthernetSize)
+  {
+    fprintf(stderr, "usage: %s [-d=SEC] [-w=SEC] [-s=BYTES] [-f=FRAMES] [-j]\n"
+      "  the frame size is %u to %u bytes, at most %zu frames in flight\n",
+      argv[0], kMinFrameSize, (uint32_t)tp.kEthernetSize,
+      MemoryTapDev::kMaxQueued);
+    return 2;
+  }
+  int rv = 0;
+  try
+  {
+    rtc::AutoThread main_thread;
+    LoopbackHarness harness(frame_size, window);
+    harness.Connect();
+    LoopbackResults res = harness.Run(std::chrono::seconds(warmup),
+      std::chrono::seconds(duration));
+    PrintResults(res, frame_size, window, json);
+  }
+  catch(exception & e)
+  {
+    fprintf(stderr, "%s\n", e.what());
+    rv = 1;
+  }
+  return rv;
+}
@@ -0,0 +1,137 @@
+/*
+* ipop-project
+* Copyright 2016, University of Florida
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+/*
+Prints the contents of tincan's shared memory stats region, once or at an
+interval, without sending any control to tincan.
+
+  tincan-stats [-i=MS] PATH
+*/
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include "stats_region.h"
+
+using namespace tincan;
+
+static uint64_t
+MonotonicMillis()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint64_t
+Age(
+  uint64_t now,
+  uint64_t updated_ms)
+{
+  return now > updated_ms ? now - updated_ms : 0;
+}
+
+static void
+PrintRegion(
+  const StatsRegionReader & reader)
+{
+  uint64_t now = MonotonicMillis();
+  printf("%-20s %12s %14s %12s %14s %8s %8s %8s %8s %8s\n", "TUNNEL",
+    "TAP FRM IN", "TAP BYTES IN", "TAP FRM OUT", "TAP BYTES OUT", "ERRORS",
+    "DROPPED", "PENDING", "NETQ", "AGE MS");
+  for(uint32_t i = 0; i < reader.TunnelSlots(); i++)
+  {
+    TunnelStatsView tv;
+    if(!reader.ReadTunnel(i, tv))
+      continue;
+    printf("%-20s %12" PRIu64 " %14" PRIu64 " %12" PRIu64 " %14" PRIu64
+      " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n",
+      tv.tunnel_id.c_str(), tv.values[TC_TAP_FRAMES_IN],
+      tv.values[TC_TAP_BYTES_IN], tv.values[TC_TAP_FRAMES_OUT],
+      tv.values[TC_TAP_BYTES_OUT], tv.values[TC_TAP_ERRORS],
+      tv.values[TC_DROPPED], tv.values[TC_PENDING_FRAMES],
+      tv.values[TC_NET_QUEUE], Age(now, tv.values[TC_UPDATED_MS]));
+  }
+  printf("\n%-20s %-20s %6s %12s %14s %12s %14s %8s %8s %8s\n", "TUNNEL",
+    "LINK", "ONLINE", "FRAMES IN", "BYTES IN", "FRAMES OUT", "BYTES OUT",
+    "FAILED", "RTT MS", "AGE MS");
+  for(uint32_t i = 0; i < reader.LinkSlots(); i++)
+  {
+    LinkStatsView lv;
+    if(!reader.ReadLink(i, lv))
+      continue;
+    printf("%-20s %-20s %6s %12" PRIu64 " %14" PRIu64 " %12" PRIu64 " %14"
+      PRIu64 " %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n",
+      lv.tunnel_id.c_str(), lv.link_id.c_str(),
+      lv.values[LC_ONLINE] ? "yes" : "no", lv.values[LC_FRAMES_IN],
+      lv.values[LC_BYTES_IN], lv.values[LC_FRAMES_OUT],
+      lv.values[LC_BYTES_OUT], lv.values[LC_SEND_FAILURES],
+      lv.values[LC_RTT], Age(now, lv.values[LC_UPDATED_MS]));
+  }
+}
+
+int
+main(
+  int argc,
+  char ** argv)
+{
+  uint32_t interval = 0;
+  const char * path = nullptr;
+  for(int i = 1; i < argc; i++)
+  {
+    if(strncmp(argv[i], "-i=", 3) == 0)
+      interval = (uint32_t)strtoul(argv[i] + 3, nullptr, 10);
+    else if(!path && argv[i][0] != '-')
+      path = argv[i];
+    else
+    {
+      path = nullptr;
+      break;
+    }
+  }
+  if(!path)
+  {
+    fprintf(stderr, "usage: %s [-i=MS] PATH\n", argv[0]);
+    return 2;
+  }
+  StatsRegionReader reader;
+  std::string err;
+  if(!reader.Open(path, err))
+  {
+    fprintf(stderr, "%s\n", err.c_str());
+    return 1;
+  }
+  printf("tincan pid %" PRIu32 ", published every %" PRIu32 " ms\n",
+    reader.Header().pid, reader.Header().publish_interval);
+  PrintRegion(reader);
+  while(interval)
+  {
+    timespec ts = { (time_t)(interval / 1000),
+      (long)(interval % 1000) * 1000000 };
+    nanosleep(&ts, nullptr);
+    printf("\n");
+    PrintRegion(reader);
+  }
+  return 0;
+}